@@ -103,9 +103,12 @@ HEADERS += \
     $$PWD/backend/pad_decoder.h \
     $$PWD/backend/eep-protection.h \
     $$PWD/backend/energy_dispersal.h \
+    $$PWD/backend/ensemble-database.h \
     $$PWD/backend/fib-processor.h \
     $$PWD/backend/fic-handler.h \
     $$PWD/backend/msc-handler.h \
+    $$PWD/backend/dqpsk-demapper.h \
+    $$PWD/backend/rs-syndromes.h \
     $$PWD/backend/freq-interleaver.h \
     $$PWD/backend/ofdm-decoder.h \
     $$PWD/backend/ofdm-processor.h \
@@ -133,6 +136,8 @@ HEADERS += \
     $$PWD/various/wavfile.h \
     $$PWD/various/Socket.h \
     $$PWD/various/MathHelper.h \
+    $$PWD/various/workerpool.h \
+    $$PWD/various/cpudispatch.h \
     $$PWD/libs/fec/char.h \
     $$PWD/libs/fec/decode_rs.h \
     $$PWD/libs/fec/encode_rs.h \
@@ -155,9 +160,12 @@ SOURCES += \
     $$PWD/backend/mot_manager.cpp \
     $$PWD/backend/pad_decoder.cpp \
     $$PWD/backend/eep-protection.cpp \
+    $$PWD/backend/ensemble-database.cpp \
     $$PWD/backend/fib-processor.cpp \
     $$PWD/backend/fic-handler.cpp \
     $$PWD/backend/msc-handler.cpp \
+    $$PWD/backend/dqpsk-demapper.cpp \
+    $$PWD/backend/rs-syndromes.cpp \
     $$PWD/backend/freq-interleaver.cpp \
     $$PWD/backend/ofdm-decoder.cpp \
     $$PWD/backend/ofdm-processor.cpp \
@@ -174,6 +182,8 @@ SOURCES += \
     $$PWD/various/fft.cpp \
     $$PWD/various/wavfile.c \
     $$PWD/various/Socket.cpp \
+    $$PWD/various/workerpool.cpp \
+    $$PWD/various/cpudispatch.cpp \
     $$PWD/libs/fec/encode_rs_char.c \
     $$PWD/libs/fec/decode_rs_char.c \
     $$PWD/libs/fec/init_rs_char.c \
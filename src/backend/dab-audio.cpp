@@ -31,9 +31,10 @@
 #include "uep-protection.h"
 #include "profiling.h"
 
-//  As an experiment a version of the backend is created
-//  that will be running in a separate thread. Might be
-//  useful for multicore processors.
+//  The CIFs of a subchannel are decoded as tasks on the worker
+//  pool of the MscHandler, shared by all subchannels. At most one
+//  task per subchannel is scheduled at any time, which keeps the
+//  CIFs in order and the deinterleaver state consistent.
 //
 //  Interleaving is - for reasons of simplicity - done
 //  inline rather than through a special class-object
@@ -44,24 +45,29 @@
 //
 //  fragmentsize == Length * CUSize
 DabAudio::DabAudio(
+        int16_t subChId,
         AudioServiceComponentType dabModus,
         int16_t fragmentSize,
         int16_t bitRate,
         ProtectionSettings protection,
         ProgrammeHandlerInterface& phi,
-        const std::string& dumpFileName) :
+        const std::string& dumpFileName,
+        WorkerPool& workerPool) :
     myProgrammeHandler(phi),
-    mscBuffer(64 * 32768),
+    workerPool(workerPool),
+    subChId(subChId),
     dumpFileName(dumpFileName)
 {
     this->dabModus         = dabModus;
     this->fragmentSize     = fragmentSize;
     this->bitRate          = bitRate;
 
-    outV.resize(bitRate * 24);
+    // One logical frame of 24 ms, packed
+    outV.resize(bitRate * 24 / 8);
     for (int i = 0; i < 16; i ++) {
         interleaveData[i].resize(fragmentSize);
     }
+    tempX.resize(fragmentSize);
 
     using std::make_unique;
 
@@ -77,89 +83,111 @@ DabAudio::DabAudio(
 
     our_dabProcessor = make_unique<DecoderAdapter>(
             myProgrammeHandler, bitRate, dabModus, dumpFileName);
-
-    running = true;
-    ourThread = std::thread(&DabAudio::run, this);
 }
 
 DabAudio::~DabAudio()
 {
+    std::unique_lock<std::mutex> lock(ourMutex);
     running = false;
+    queueNotFull.notify_all();
 
-    if (ourThread.joinable()) {
-        mscDataAvailable.notify_all();
-        ourThread.join();
-    }
+    // The programme handler may go away once we return, wait for a
+    // running task to finish
+    taskFinished.wait(lock, [&]() { return not taskScheduled; });
 }
 
 int32_t DabAudio::process(const softbit_t *v, int16_t cnt)
 {
-    int32_t fr;
+    std::unique_lock<std::mutex> lock(ourMutex);
+
+    if (pendingCIFs.size() >= maxPendingCIFs) {
+        fprintf (stderr, "dab-concurrent: buffer full for subchannel %d\n", subChId);
+        queueNotFull.wait(lock, [&]() {
+                return not running or pendingCIFs.size() < maxPendingCIFs; });
+    }
 
-    if (mscBuffer.GetRingBufferWriteAvailable () < cnt)
-        fprintf (stderr, "dab-concurrent: buffer full\n");
+    if (!running)
+        return 0;
 
-    while ((fr = mscBuffer.GetRingBufferWriteAvailable ()) <= cnt) {
-        if (!running)
-            return 0;
-        std::this_thread::sleep_for(std::chrono::microseconds(1));
+    std::vector<softbit_t> cif;
+    if (not freeCIFs.empty()) {
+        cif = std::move(freeCIFs.back());
+        freeCIFs.pop_back();
     }
+    cif.assign(v, v + cnt);
+    pendingCIFs.push_back(std::move(cif));
 
-    mscBuffer.putDataIntoBuffer(v, cnt);
-    mscDataAvailable.notify_all();
-    return fr;
+    if (not taskScheduled) {
+        taskScheduled = true;
+        workerPool.submit([this]() { processPending(); });
+    }
+
+    return maxPendingCIFs - pendingCIFs.size();
 }
 
-const int16_t interleaveMap[] = {0,8,4,12,2,10,6,14,1,9,5,13,3,11,7,15};
+void DabAudio::flush()
+{
+    std::unique_lock<std::mutex> lock(ourMutex);
+    taskFinished.wait(lock, [&]() { return not taskScheduled; });
+}
 
-void DabAudio::run()
+void DabAudio::processPending()
 {
-    int16_t i;
-    int16_t countforInterleaver = 0;
-    int16_t interleaverIndex    = 0;
-    std::vector<softbit_t> data(fragmentSize);
-    std::vector<softbit_t> tempX(fragmentSize);
-
-    while (running) {
-        std::unique_lock<std::mutex> lock(ourMutex);
-        while (running && mscBuffer.GetRingBufferReadAvailable() <= fragmentSize) {
-            mscDataAvailable.wait(lock);
-        }
-        if (!running)
-            break;
-
-        // mscBuffer is threadsafe to access, no need to keep the lock
+    std::unique_lock<std::mutex> lock(ourMutex);
+
+    while (running and not pendingCIFs.empty()) {
+        auto data = std::move(pendingCIFs.front());
+        pendingCIFs.pop_front();
+        queueNotFull.notify_one();
+
+        // Decoding works on per-subchannel state only accessed
+        // from this task, no need to keep the lock
         lock.unlock();
+        processCIF(data);
+        lock.lock();
 
-        PROFILE(DAGetMSCData);
-        mscBuffer.getDataFromBuffer(data.data(), fragmentSize);
-
-        PROFILE(DADeinterleave);
-        for (i = 0; i < fragmentSize; i ++) {
-            tempX[i] = interleaveData[(interleaverIndex +
-                    interleaveMap[i & 017]) & 017][i];
-            interleaveData[interleaverIndex][i] = data[i];
-        }
-        interleaverIndex = (interleaverIndex + 1) & 0x0F;
-
-        //  only continue when de-interleaver is filled
-        if (countforInterleaver <= 15) {
-            countforInterleaver ++;
-            continue;
-        }
-
-        PROFILE(DADeconvolve);
-        protectionHandler->deconvolve(tempX.data(), fragmentSize, outV.data());
-
-        PROFILE(DADispersal);
-        // and the inline energy dispersal
-        energyDispersal.dedisperse(outV);
-
-        if (our_dabProcessor) {
-            PROFILE(DADecode);
-            our_dabProcessor->addtoFrame(outV.data());
-        }
-        PROFILE(DADone);
+        freeCIFs.push_back(std::move(data));
     }
+
+    taskScheduled = false;
+    taskFinished.notify_all();
 }
 
+const int16_t interleaveMap[] = {0,8,4,12,2,10,6,14,1,9,5,13,3,11,7,15};
+
+void DabAudio::processCIF(const std::vector<softbit_t>& data)
+{
+    int16_t i;
+
+    PROFILE_TRACK("DabAudio subchannel", subChId);
+    PROFILE(DAGetMSCData);
+    if ((int16_t)data.size() < fragmentSize)
+        return;
+
+    PROFILE(DADeinterleave);
+    for (i = 0; i < fragmentSize; i ++) {
+        tempX[i] = interleaveData[(interleaverIndex +
+                interleaveMap[i & 017]) & 017][i];
+        interleaveData[interleaverIndex][i] = data[i];
+    }
+    interleaverIndex = (interleaverIndex + 1) & 0x0F;
+
+    //  only continue when de-interleaver is filled
+    if (countforInterleaver <= 15) {
+        countforInterleaver ++;
+        return;
+    }
+
+    PROFILE(DADeconvolve);
+    protectionHandler->deconvolve(tempX.data(), fragmentSize, outV.data());
+
+    PROFILE(DADispersal);
+    // and the inline energy dispersal
+    energyDispersal.dedisperse(outV);
+
+    if (our_dabProcessor) {
+        PROFILE(DADecode);
+        our_dabProcessor->addtoFrame(outV.data());
+    }
+    PROFILE(DADone);
+}
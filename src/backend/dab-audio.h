@@ -33,9 +33,10 @@
 #include <mutex>
 #include <condition_variable>
 #include <cstdio>
-#include "ringbuffer.h"
+#include <deque>
 #include "energy_dispersal.h"
 #include "radio-controller.h"
+#include "workerpool.h"
 
 class DabProcessor;
 class Protection;
@@ -43,38 +44,56 @@ class Protection;
 class DabAudio : public DabVirtual
 {
     public:
-        DabAudio(AudioServiceComponentType dabModus,
+        DabAudio(int16_t subChId,
+                  AudioServiceComponentType dabModus,
                   int16_t fragmentSize,
                   int16_t bitRate,
                   ProtectionSettings protection,
                   ProgrammeHandlerInterface& phi,
-                  const std::string& dumpFileName);
+                  const std::string& dumpFileName,
+                  WorkerPool& workerPool);
         virtual ~DabAudio(void);
         DabAudio(const DabAudio&) = delete;
         DabAudio& operator=(const DabAudio&) = delete;
 
         int32_t process(const softbit_t *v, int16_t cnt);
+        void flush(void);
 
     protected:
         ProgrammeHandlerInterface& myProgrammeHandler;
 
     private:
-        void    run(void);
-        std::atomic<bool> running;
+        // Maximum number of CIFs waiting to be decoded before
+        // process() blocks
+        static constexpr size_t maxPendingCIFs = 64;
+
+        void    processPending(void);
+        void    processCIF(const std::vector<softbit_t>& data);
+
+        WorkerPool& workerPool;
+        const int16_t subChId;
+        bool running = true;
         AudioServiceComponentType dabModus;
         int16_t fragmentSize;
         int16_t bitRate;
         std::vector<uint8_t> outV;
         std::vector<softbit_t> interleaveData[16];
+        std::vector<softbit_t> tempX;
+        int16_t countforInterleaver = 0;
+        int16_t interleaverIndex = 0;
         EnergyDispersal energyDispersal;
 
-        std::condition_variable  mscDataAvailable;
+        // CIFs are queued here and decoded by one task at a time on
+        // the worker pool, which keeps them in order
         std::mutex               ourMutex;
-        std::thread              ourThread;
+        std::condition_variable  queueNotFull;
+        std::condition_variable  taskFinished;
+        std::deque<std::vector<softbit_t> > pendingCIFs;
+        std::vector<std::vector<softbit_t> > freeCIFs;
+        bool taskScheduled = false;
 
         std::unique_ptr<Protection> protectionHandler;
         std::unique_ptr<DabProcessor> our_dabProcessor;
-        RingBuffer<softbit_t> mscBuffer;
 
         const std::string dumpFileName;
 };
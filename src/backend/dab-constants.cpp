@@ -30,6 +30,7 @@
 #include <iostream>
 #include <exception>
 #include <sstream>
+#include <tuple>
 
 // For Qt translation if Qt is existing
 #ifdef QT_CORE_LIB
@@ -176,6 +177,23 @@ string DabLabel::fig2_label() const
     throw logic_error("invalid extended label charset " + to_string((int)extended_label_charset));
 }
 
+bool DabLabel::operator==(const DabLabel& other) const
+{
+    return std::tie(charset, fig1_label, fig1_flag,
+                segments, segment_count, extended_label_charset,
+                toggle_flag, fig2_rfu) ==
+        std::tie(other.charset, other.fig1_label, other.fig1_flag,
+                other.segments, other.segment_count, other.extended_label_charset,
+                other.toggle_flag, other.fig2_rfu);
+}
+
+bool Service::operator==(const Service& other) const
+{
+    return std::tie(serviceId, serviceLabel, language, programType, provisional) ==
+        std::tie(other.serviceId, other.serviceLabel, other.language,
+                other.programType, other.provisional);
+}
+
 const char* DABConstants::getProgramTypeName(int type)
 {
     const char* typeName = "";
@@ -497,6 +515,31 @@ string Subchannel::protection() const
     return prot;
 }
 
+bool ProtectionSettings::operator==(const ProtectionSettings& other) const
+{
+    return std::tie(shortForm, uepTableIndex, uepLevel, eepProfile, eepLevel) ==
+        std::tie(other.shortForm, other.uepTableIndex, other.uepLevel,
+                other.eepProfile, other.eepLevel);
+}
+
+bool Subchannel::operator==(const Subchannel& other) const
+{
+    return std::tie(subChId, startAddr, length, programmeNotData,
+                protectionSettings, language, fecScheme) ==
+        std::tie(other.subChId, other.startAddr, other.length,
+                other.programmeNotData, other.protectionSettings,
+                other.language, other.fecScheme);
+}
+
+bool ServiceComponent::operator==(const ServiceComponent& other) const
+{
+    return std::tie(TMid, SId, componentNr, componentLabel, ASCTy, PS_flag,
+                subchannelId, SCId, CAflag, DSCTy, DGflag, packetAddress) ==
+        std::tie(other.TMid, other.SId, other.componentNr, other.componentLabel,
+                other.ASCTy, other.PS_flag, other.subchannelId, other.SCId,
+                other.CAflag, other.DSCTy, other.DGflag, other.packetAddress);
+}
+
 TransportMode ServiceComponent::transportMode() const
 {
     if (TMid == 0) {
@@ -115,6 +115,8 @@ struct DabLabel {
     // Common to FIG 1 and FIG 2
     /* If FIG 2 label available, use that one, otherwise take the FIG 1 label */
     std::string utf8_label() const;
+
+    bool operator==(const DabLabel& other) const;
 };
 
 struct Service {
@@ -125,6 +127,11 @@ struct Service {
     DabLabel serviceLabel;
     int16_t  language = 0;
     int16_t  programType = 0; // PTy, FIG0/17
+
+    // Taken from the ensemble database, not yet confirmed by the FIC
+    bool     provisional = false;
+
+    bool operator==(const Service& other) const;
 };
 
 //      The service component describes the actual service
@@ -147,6 +154,8 @@ struct ServiceComponent {
 
     TransportMode transportMode(void) const;
     AudioServiceComponentType audioType(void) const;
+
+    bool operator==(const ServiceComponent& other) const;
 };
 
 enum class EEPProtectionProfile {
@@ -171,6 +180,8 @@ struct ProtectionSettings {
     // when long-form, EEP:
     EEPProtectionProfile eepProfile = EEPProtectionProfile::EEP_A;
     EEPProtectionLevel eepLevel = EEPProtectionLevel::EEP_3;
+
+    bool operator==(const ProtectionSettings& other) const;
 };
 
 struct Subchannel {
@@ -195,6 +206,8 @@ struct Subchannel {
     std::string protection(void) const;
 
     inline bool valid() const { return subChId != -1; }
+
+    bool operator==(const Subchannel& other) const;
 };
 
 #endif
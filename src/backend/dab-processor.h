@@ -31,6 +31,7 @@
 class DabProcessor {
     public:
         virtual ~DabProcessor() = default;
+        // Called with one packed logical frame
         virtual void addtoFrame(uint8_t *) = 0;
 };
 
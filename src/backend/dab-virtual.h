@@ -31,6 +31,8 @@ class DabVirtual {
     public:
         virtual ~DabVirtual() {}
         virtual int32_t process(const softbit_t *v, int16_t cnt) = 0;
+        // Blocks until everything given to process() is decoded
+        virtual void flush(void) = 0;
 };
 #endif
 
@@ -164,6 +164,9 @@ size_t MP2Decoder::DecodeFrame(uint8_t **data) {
 
 	ProcessUntouchedStream(header, body_data, body_bytes);
 
+	if(!decode_audio_requested)
+		return 0;
+
 	size_t frame_len;
 	mpg_result = mpg123_framebyframe_decode(handle, nullptr, data, &frame_len);
 	if(mpg_result != MPG123_OK)
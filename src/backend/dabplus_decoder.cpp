@@ -23,6 +23,7 @@
 SuperframeFilter::SuperframeFilter(SubchannelSinkObserver* observer, bool decode_audio, bool enable_float32) : SubchannelSink(observer, "aac") {
 	this->decode_audio = decode_audio;
 	this->enable_float32 = enable_float32;
+	SetDecodeAudio(decode_audio);
 
 	aac_dec = nullptr;
 
@@ -47,6 +48,17 @@ SuperframeFilter::~SuperframeFilter() {
 }
 
 void SuperframeFilter::Feed(const uint8_t *data, size_t len) {
+	// apply a change of SetDecodeAudio
+	if(decode_audio != decode_audio_requested) {
+		decode_audio = decode_audio_requested;
+		if(!decode_audio) {
+			delete aac_dec;
+			aac_dec = nullptr;
+		} else if(sf_format_set) {
+			ProcessFormat();
+		}
+	}
+
 	// check frame len
 	if(frame_len) {
 		if(frame_len != len) {
@@ -313,7 +325,7 @@ void SuperframeFilter::ProcessUntouchedStream(const uint8_t *data, size_t len) {
 
 
 // --- RSDecoder -----------------------------------------------------------------
-RSDecoder::RSDecoder() {
+RSDecoder::RSDecoder(RSSyndromes::Implementation impl) : syndromes(impl) {
 	rs_handle = init_rs_char(8, 0x11D, 0, 1, 10, 135);
 	if(!rs_handle)
 		throw std::runtime_error("RSDecoder: error while init_rs_char");
@@ -333,8 +345,16 @@ void RSDecoder::DecodeSuperframe(uint8_t *sf, size_t sf_len, int& total_corr_cou
 	total_corr_count = 0;
 	uncorr_errors = false;
 
-	// process all RS packets
+	// check all RS packets at once - on a clean signal, none needs decoding
+	has_errors.resize(subch_index);
+	if(!syndromes.check(sf, subch_index, has_errors.data()))
+		return;
+
+	// process all RS packets with errors
 	for(int i = 0; i < subch_index; i++) {
+		if(!has_errors[i])
+			continue;
+
 		for(int pos = 0; pos < 120; pos++)
 			rs_packet[pos] = sf[pos * subch_index + i];
 
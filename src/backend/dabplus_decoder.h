@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #if !(defined(DABLIN_AAC_FAAD2) ^ defined(DABLIN_AAC_FDKAAC))
 #error "You must select a AAC decoder by defining either DABLIN_AAC_FAAD2 or DABLIN_AAC_FDKAAC!"
@@ -41,6 +42,7 @@ extern "C" {
 #include <fec.h>
 }
 
+#include "rs-syndromes.h"
 #include "subchannel_sink.h"
 #include "tools.h"
 
@@ -76,8 +78,11 @@ private:
 	void *rs_handle;
 	uint8_t rs_packet[120];
 	int corr_pos[10];
+
+	RSSyndromes syndromes;
+	std::vector<uint8_t> has_errors;
 public:
-	RSDecoder();
+	RSDecoder(RSSyndromes::Implementation impl = RSSyndromes::Implementation::Auto);
 	~RSDecoder();
 
 	void DecodeSuperframe(uint8_t *sf, size_t sf_len, int& total_corr_count, bool& uncorr_errors);
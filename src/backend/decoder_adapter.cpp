@@ -39,6 +39,8 @@ DecoderAdapter::DecoderAdapter(ProgrammeHandlerInterface &mr, int16_t bitRate, A
     else
         throw std::runtime_error("DecoderAdapter: Unknown service component");
 
+    encodedAudioExtension = decoder->GetUntouchedStreamFileExtension();
+
     // Open a dump file (XPADxpert) if the user defined it
     if (!dumpFileName.empty()) {
         FILE *fd = fopen(dumpFileName.c_str(), "wb");
@@ -54,22 +56,25 @@ DecoderAdapter::DecoderAdapter(ProgrammeHandlerInterface &mr, int16_t bitRate, A
 
 void DecoderAdapter::addtoFrame(uint8_t *v)
 {
+    // The logical frame is already packed
     const size_t length = 24 * bitRate / 8;
-    std::vector<uint8_t> data(length);
-
-    // Convert 8 bits (stored in one uint8) into one uint8
-    for (size_t i = 0; i < length; i ++) {
-        data[i] = 0;
-        for (int j = 0; j < 8; j ++) {
-            data[i] <<= 1;
-            data[i] |= v[8 * i + j] & 01;
-        }
+
+    // Only do the audio work somebody asked for
+    decoder->SetDecodeAudio(myInterface.wantsDecodedAudio());
+
+    const bool encoded = myInterface.wantsEncodedAudio();
+    if (encoded != forwardingEncodedAudio) {
+        if (encoded)
+            decoder->AddUntouchedStreamConsumer(this);
+        else
+            decoder->RemoveUntouchedStreamConsumer(this);
+        forwardingEncodedAudio = encoded;
     }
 
-    decoder->Feed(data.data(), length);
+    decoder->Feed(v, length);
 
     if (dumpFile) {
-        fwrite(data.data(), length, 1, dumpFile.get());
+        fwrite(v, length, 1, dumpFile.get());
     }
 
     myInterface.onFrameErrors(frameErrorCounter);
@@ -140,6 +145,11 @@ void DecoderAdapter::FECInfo(int total_corr_count, bool uncorr_errors)
     myInterface.onRsErrors(uncorr_errors, total_corr_count);
 }
 
+void DecoderAdapter::ProcessUntouchedStream(const uint8_t *data, size_t len, size_t duration_ms)
+{
+    myInterface.onEncodedAudio(data, len, duration_ms, encodedAudioExtension);
+}
+
 void DecoderAdapter::PADChangeDynamicLabel(const DL_STATE &dl)
 {
     if (dl.raw.empty()) {
@@ -38,7 +38,7 @@
 #include "dab_decoder.h"
 #include "dabplus_decoder.h"
 
-class DecoderAdapter: public DabProcessor, public SubchannelSinkObserver, public PADDecoderObserver
+class DecoderAdapter: public DabProcessor, public SubchannelSinkObserver, public PADDecoderObserver, public UntouchedStreamConsumer
 {
     public:
         DecoderAdapter(ProgrammeHandlerInterface& mr,
@@ -62,11 +62,16 @@ class DecoderAdapter: public DabProcessor, public SubchannelSinkObserver, public
         virtual void PADChangeSlide(const MOT_FILE& slide);
         virtual void PADLengthError(size_t announced_xpad_len, size_t xpad_len);
 
+        // UntouchedStreamConsumer impl
+        virtual void ProcessUntouchedStream(const uint8_t* data, size_t len, size_t duration_ms);
+
     private:
         int16_t bitRate;
         int frameErrorCounter = 0;
         ProgrammeHandlerInterface& myInterface;
         std::unique_ptr<SubchannelSink> decoder;
+        std::string encodedAudioExtension;
+        bool forwardingEncodedAudio = false;
         PADDecoder padDecoder;
 
         struct FILEDeleter{ void operator()(FILE* fd){ if (fd) fclose(fd); }};
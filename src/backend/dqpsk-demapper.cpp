@@ -0,0 +1,240 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cmath>
+#include "dqpsk-demapper.h"
+#include "freq-interleaver.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define DEMAPPER_X86
+#  include <immintrin.h>
+#endif
+
+// armv7 NEON has no division, which we need to be exact with Generic
+#if defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#  define DEMAPPER_NEON
+#  include <arm_neon.h>
+#endif
+
+// All implementations must round in the same places, so the compiler
+// must not fuse the multiplications and additions on its own.
+#if defined(__clang__)
+#  pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#  pragma GCC optimize ("fp-contract=off")
+#endif
+
+static inline void demapCarrier(
+        const DSPCOMPLEX& s, const DSPCOMPLEX& r,
+        softbit_t& bitRe, softbit_t& bitIm)
+{
+    // s * conj(r)
+    const float re = s.real() * r.real() + s.imag() * r.imag();
+    const float im = s.imag() * r.real() - s.real() * r.imag();
+    const float norm = std::fabs(re) + std::fabs(im);
+
+    if (norm > 0) {
+        const float scale = 127.0f / norm;
+        bitRe = -re * scale;
+        bitIm = -im * scale;
+    }
+    else {
+        bitRe = 0;
+        bitIm = 0;
+    }
+}
+
+static void demap_GENERIC(
+        const DSPCOMPLEX *spectrum,
+        const DSPCOMPLEX *reference,
+        const int16_t *carriers,
+        int32_t numBins,
+        softbit_t *bits, int16_t K)
+{
+    for (int32_t j = 0; j < numBins; j++) {
+        const int16_t c = carriers[j];
+        demapCarrier(spectrum[j], reference[j], bits[c], bits[K + c]);
+    }
+}
+
+#ifdef DEMAPPER_X86
+__attribute__((target("avx2")))
+static void demap_AVX2(
+        const DSPCOMPLEX *spectrum,
+        const DSPCOMPLEX *reference,
+        const int16_t *carriers,
+        int32_t numBins,
+        softbit_t *bits, int16_t K)
+{
+    // Splitting real and imaginary parts works within 128-bit lanes,
+    // this is the bin each element ends up with
+    static const int order[8] = { 0, 1, 4, 5, 2, 3, 6, 7 };
+
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 full = _mm256_set1_ps(127.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    alignas(32) int32_t re_out[8];
+    alignas(32) int32_t im_out[8];
+
+    int32_t j = 0;
+    for (; j + 8 <= numBins; j += 8) {
+        const float *sp = reinterpret_cast<const float *>(spectrum + j);
+        const float *rp = reinterpret_cast<const float *>(reference + j);
+        const __m256 s0 = _mm256_loadu_ps(sp);
+        const __m256 s1 = _mm256_loadu_ps(sp + 8);
+        const __m256 r0 = _mm256_loadu_ps(rp);
+        const __m256 r1 = _mm256_loadu_ps(rp + 8);
+
+        const __m256 s_re = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 s_im = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m256 r_re = _mm256_shuffle_ps(r0, r1, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 r_im = _mm256_shuffle_ps(r0, r1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        const __m256 re = _mm256_add_ps(
+                _mm256_mul_ps(s_re, r_re), _mm256_mul_ps(s_im, r_im));
+        const __m256 im = _mm256_sub_ps(
+                _mm256_mul_ps(s_im, r_re), _mm256_mul_ps(s_re, r_im));
+        const __m256 norm = _mm256_add_ps(
+                _mm256_andnot_ps(sign, re), _mm256_andnot_ps(sign, im));
+        const __m256 scale = _mm256_div_ps(full, norm);
+        const __m256 valid = _mm256_cmp_ps(norm, zero, _CMP_GT_OQ);
+
+        const __m256 bit_re = _mm256_and_ps(valid,
+                _mm256_mul_ps(_mm256_xor_ps(re, sign), scale));
+        const __m256 bit_im = _mm256_and_ps(valid,
+                _mm256_mul_ps(_mm256_xor_ps(im, sign), scale));
+        _mm256_store_si256((__m256i *)re_out, _mm256_cvttps_epi32(bit_re));
+        _mm256_store_si256((__m256i *)im_out, _mm256_cvttps_epi32(bit_im));
+
+        for (int k = 0; k < 8; k++) {
+            const int16_t c = carriers[j + order[k]];
+            bits[c] = re_out[k];
+            bits[K + c] = im_out[k];
+        }
+    }
+
+    demap_GENERIC(spectrum + j, reference + j, carriers + j,
+            numBins - j, bits, K);
+}
+#endif
+
+#ifdef DEMAPPER_NEON
+static void demap_NEON(
+        const DSPCOMPLEX *spectrum,
+        const DSPCOMPLEX *reference,
+        const int16_t *carriers,
+        int32_t numBins,
+        softbit_t *bits, int16_t K)
+{
+    const float32x4_t full = vdupq_n_f32(127.0f);
+    int32_t re_out[4];
+    int32_t im_out[4];
+
+    int32_t j = 0;
+    for (; j + 4 <= numBins; j += 4) {
+        const float32x4x2_t s = vld2q_f32(reinterpret_cast<const float *>(spectrum + j));
+        const float32x4x2_t r = vld2q_f32(reinterpret_cast<const float *>(reference + j));
+
+        const float32x4_t re = vaddq_f32(
+                vmulq_f32(s.val[0], r.val[0]), vmulq_f32(s.val[1], r.val[1]));
+        const float32x4_t im = vsubq_f32(
+                vmulq_f32(s.val[1], r.val[0]), vmulq_f32(s.val[0], r.val[1]));
+        const float32x4_t norm = vaddq_f32(vabsq_f32(re), vabsq_f32(im));
+        const float32x4_t scale = vdivq_f32(full, norm);
+        const uint32x4_t valid = vcgtq_f32(norm, vdupq_n_f32(0.0f));
+
+        const float32x4_t bit_re = vmulq_f32(vnegq_f32(re), scale);
+        const float32x4_t bit_im = vmulq_f32(vnegq_f32(im), scale);
+        vst1q_s32(re_out, vandq_s32(vcvtq_s32_f32(bit_re), vreinterpretq_s32_u32(valid)));
+        vst1q_s32(im_out, vandq_s32(vcvtq_s32_f32(bit_im), vreinterpretq_s32_u32(valid)));
+
+        for (int k = 0; k < 4; k++) {
+            const int16_t c = carriers[j + k];
+            bits[c] = re_out[k];
+            bits[K + c] = im_out[k];
+        }
+    }
+
+    demap_GENERIC(spectrum + j, reference + j, carriers + j,
+            numBins - j, bits, K);
+}
+#endif
+
+DQPSKDemapper::DQPSKDemapper(const DABParams& p, Implementation impl) :
+    T_u(p.T_u),
+    K(p.K),
+    impl(dispatch().resolve(impl)),
+    carriers(p.K)
+{
+    // mapIn gives the bins relative to the centre frequency, from
+    // -K/2 to K/2 without 0
+    FrequencyInterleaver interleaver(p);
+    for (int16_t i = 0; i < K; i++) {
+        const int16_t bin = interleaver.mapIn(i);
+        const int32_t j = bin > 0 ? bin - 1 : bin + K;
+        carriers[j] = i;
+    }
+}
+
+void DQPSKDemapper::demap(
+        const DSPCOMPLEX *spectrum,
+        const DSPCOMPLEX *reference,
+        softbit_t *bits) const
+{
+    auto kernel = demap_GENERIC;
+    switch (impl) {
+#ifdef DEMAPPER_X86
+        case Implementation::AVX2:
+            kernel = demap_AVX2;
+            break;
+#endif
+#ifdef DEMAPPER_NEON
+        case Implementation::NEON:
+            kernel = demap_NEON;
+            break;
+#endif
+        default:
+            break;
+    }
+
+    // Positive frequencies, then negative ones
+    const int16_t half = K / 2;
+    kernel(spectrum + 1, reference + 1, carriers.data(), half, bits, K);
+    kernel(spectrum + T_u - half, reference + T_u - half,
+            carriers.data() + half, half, bits, K);
+}
+
+const CPUDispatch& DQPSKDemapper::dispatch()
+{
+    static const CPUDispatch d({
+#ifdef DEMAPPER_X86
+            Implementation::AVX2,
+#endif
+#ifdef DEMAPPER_NEON
+            Implementation::NEON,
+#endif
+            });
+    return d;
+}
@@ -0,0 +1,74 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __DQPSK_DEMAPPER
+#define __DQPSK_DEMAPPER
+
+#include <cstdint>
+#include <vector>
+#include "dab-constants.h"
+#include "cpudispatch.h"
+
+/* Differential demodulation and frequency deinterleaving of the K
+ * useful carriers of an OFDM symbol in one pass.
+ *
+ * The carriers are walked in FFT order, so that the spectra are read
+ * sequentially and can be processed several at a time, and every soft
+ * bit is written to its deinterleaved position through a precomputed
+ * table. The result is the same as demodulating carrier i at the FFT
+ * bin FrequencyInterleaver::mapIn(i) gives.
+ */
+class DQPSKDemapper
+{
+    public:
+        // AVX2 and NEON, besides Generic
+        using Implementation = CPUImplementation;
+
+        DQPSKDemapper(const DABParams& p, Implementation impl = Implementation::Auto);
+
+        // Compute the phase difference of every useful carrier of
+        // spectrum to the same carrier of reference, and write its real
+        // parts to bits[0 .. K) and its imaginary parts to
+        // bits[K .. 2K), scaled to +-127. Carriers without any energy
+        // give 0.
+        void demap(const DSPCOMPLEX *spectrum,
+                const DSPCOMPLEX *reference,
+                softbit_t *bits) const;
+
+        Implementation implementation(void) const { return impl; }
+
+        static const CPUDispatch& dispatch(void);
+
+    private:
+        int32_t T_u;
+        int16_t K;
+        Implementation impl;
+
+        // Carrier index of each useful FFT bin, first for the bins
+        // 1 .. K/2, then for T_u - K/2 .. T_u - 1
+        std::vector<int16_t> carriers;
+};
+
+#endif
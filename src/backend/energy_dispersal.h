@@ -25,34 +25,51 @@
 #ifndef __ENERGY_DISPERSAL
 #define __ENERGY_DISPERSAL
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <vector>
-#include <stdexcept>
 
+// Energy dispersal according to EN 300 401 clause 10.11, on data packed
+// eight bits per byte, most significant bit first. The PRBS is packed
+// the same way once per length, after which removing it is a plain XOR
+// of whole words.
 class EnergyDispersal {
     public:
-        void dedisperse(std::vector<uint8_t>& data)
+        void dedisperse(uint8_t *data, size_t len)
         {
-            if (dispersalVector.size() != data.size()) {
+            if (dispersalVector.size() != len) {
                 std::vector<uint8_t> shiftRegister(9, 1);
 
-                dispersalVector.resize(data.size());
+                dispersalVector.assign(len, 0);
 
-                for (size_t i = 0; i < data.size(); i++) {
+                for (size_t i = 0; i < len * 8; i++) {
                     uint8_t b = shiftRegister[8] ^ shiftRegister[4];
                     for (int j = 8; j > 0; j--)
                         shiftRegister[j] = shiftRegister[j - 1];
                     shiftRegister[0] = b;
-                    dispersalVector[i] ^= b;
+                    dispersalVector[i / 8] |= b << (7 - i % 8);
                 }
             }
 
-            for (size_t i = 0; i < data.size(); i++) {
+            size_t i = 0;
+            for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+                uint64_t d, p;
+                memcpy(&d, data + i, sizeof(d));
+                memcpy(&p, dispersalVector.data() + i, sizeof(p));
+                d ^= p;
+                memcpy(data + i, &d, sizeof(d));
+            }
+            for (; i < len; i++) {
                 data[i] ^= dispersalVector[i];
             }
         }
 
+        void dedisperse(std::vector<uint8_t>& data)
+        {
+            dedisperse(data.data(), data.size());
+        }
+
     private:
         std::vector<uint8_t> dispersalVector;
 };
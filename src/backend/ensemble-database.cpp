@@ -0,0 +1,233 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "ensemble-database.h"
+#include "libs/json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+static json label_to_json(const DabLabel& label)
+{
+    // FIG 1 labels are not necessarily valid UTF-8, keep the raw bytes.
+    // FIG 2 labels are not kept, their segments would get mixed up with
+    // the ones received later.
+    json j;
+    j["charset"] = static_cast<int>(label.charset);
+    j["fig1"] = vector<uint8_t>(label.fig1_label.begin(), label.fig1_label.end());
+    j["fig1_flag"] = label.fig1_flag;
+    return j;
+}
+
+static DabLabel label_from_json(const json& j)
+{
+    DabLabel label;
+    label.setCharset(j.at("charset").get<int>());
+    const auto fig1 = j.at("fig1").get<vector<uint8_t> >();
+    label.fig1_label.assign(fig1.begin(), fig1.end());
+    label.fig1_flag = j.at("fig1_flag").get<uint16_t>();
+    return label;
+}
+
+EnsembleDatabase::EnsembleDatabase(const string& directory) :
+    directory(directory)
+{ }
+
+string EnsembleDatabase::filename(const string& channel) const
+{
+    string name;
+    for (const char c : channel) {
+        if (isalnum(static_cast<unsigned char>(c))) {
+            name += c;
+        }
+    }
+    return directory + "/" + name + ".json";
+}
+
+bool EnsembleDatabase::load(const string& channel, EnsembleConfiguration& config) const
+{
+    ifstream file(filename(channel));
+    if (not file) {
+        return false;
+    }
+
+    try {
+        json j;
+        file >> j;
+
+        EnsembleConfiguration c;
+        c.ensembleId = j.at("ensemble_id").get<uint16_t>();
+        c.ensembleEcc = j.at("ensemble_ecc").get<uint8_t>();
+        c.ensembleLabel = label_from_json(j.at("ensemble_label"));
+
+        for (const auto& js : j.at("services")) {
+            Service s(js.at("id").get<uint32_t>());
+            s.serviceLabel = label_from_json(js.at("label"));
+            s.language = js.at("language").get<int16_t>();
+            s.programType = js.at("programme_type").get<int16_t>();
+            c.services.push_back(s);
+        }
+
+        for (const auto& jc : j.at("components")) {
+            ServiceComponent sc;
+            sc.TMid = jc.at("tmid").get<int8_t>();
+            sc.SId = jc.at("sid").get<uint32_t>();
+            sc.componentNr = jc.at("component_nr").get<int16_t>();
+            sc.componentLabel = label_from_json(jc.at("label"));
+            sc.ASCTy = jc.at("ascty").get<int16_t>();
+            sc.PS_flag = jc.at("ps_flag").get<int16_t>();
+            sc.subchannelId = jc.at("subchannel_id").get<int16_t>();
+            sc.SCId = jc.at("scid").get<uint16_t>();
+            sc.CAflag = jc.at("ca_flag").get<uint8_t>();
+            sc.DSCTy = jc.at("dscty").get<int16_t>();
+            sc.DGflag = jc.at("dg_flag").get<uint8_t>();
+            sc.packetAddress = jc.at("packet_address").get<int16_t>();
+            if (sc.subchannelId < 0 or sc.subchannelId >= 64) {
+                continue;
+            }
+            c.components.push_back(sc);
+        }
+
+        for (const auto& jsub : j.at("subchannels")) {
+            Subchannel sub;
+            sub.subChId = jsub.at("id").get<int32_t>();
+            sub.startAddr = jsub.at("start_address").get<int32_t>();
+            sub.length = jsub.at("length").get<int32_t>();
+            sub.programmeNotData = jsub.at("programme").get<bool>();
+            sub.language = jsub.at("language").get<int16_t>();
+            sub.fecScheme = jsub.at("fec_scheme").get<int16_t>();
+
+            const auto& jp = jsub.at("protection");
+            auto& ps = sub.protectionSettings;
+            ps.shortForm = jp.at("short_form").get<bool>();
+            ps.uepTableIndex = jp.at("uep_table_index").get<int16_t>();
+            ps.uepLevel = jp.at("uep_level").get<int16_t>();
+            ps.eepProfile = static_cast<EEPProtectionProfile>(
+                    jp.at("eep_profile").get<int>());
+            ps.eepLevel = static_cast<EEPProtectionLevel>(
+                    jp.at("eep_level").get<int>());
+
+            if (sub.subChId < 0 or sub.subChId >= 64 or
+                    sub.startAddr < 0 or sub.length <= 0 or
+                    sub.startAddr + sub.length > 864) {
+                continue;
+            }
+            c.subchannels.push_back(sub);
+        }
+
+        config = move(c);
+        return true;
+    }
+    catch (const exception& e) {
+        clog << "EnsembleDatabase: cannot load " << filename(channel) <<
+            ": " << e.what() << endl;
+        return false;
+    }
+}
+
+bool EnsembleDatabase::save(const string& channel, const EnsembleConfiguration& config) const
+{
+    json j;
+    j["ensemble_id"] = config.ensembleId;
+    j["ensemble_ecc"] = config.ensembleEcc;
+    j["ensemble_label"] = label_to_json(config.ensembleLabel);
+
+    j["services"] = json::array();
+    for (const auto& s : config.services) {
+        json js;
+        js["id"] = s.serviceId;
+        js["label"] = label_to_json(s.serviceLabel);
+        js["language"] = s.language;
+        js["programme_type"] = s.programType;
+        j["services"].push_back(js);
+    }
+
+    j["components"] = json::array();
+    for (const auto& sc : config.components) {
+        json jc;
+        jc["tmid"] = sc.TMid;
+        jc["sid"] = sc.SId;
+        jc["component_nr"] = sc.componentNr;
+        jc["label"] = label_to_json(sc.componentLabel);
+        jc["ascty"] = sc.ASCTy;
+        jc["ps_flag"] = sc.PS_flag;
+        jc["subchannel_id"] = sc.subchannelId;
+        jc["scid"] = sc.SCId;
+        jc["ca_flag"] = sc.CAflag;
+        jc["dscty"] = sc.DSCTy;
+        jc["dg_flag"] = sc.DGflag;
+        jc["packet_address"] = sc.packetAddress;
+        j["components"].push_back(jc);
+    }
+
+    j["subchannels"] = json::array();
+    for (const auto& sub : config.subchannels) {
+        const auto& ps = sub.protectionSettings;
+        json jsub;
+        jsub["id"] = sub.subChId;
+        jsub["start_address"] = sub.startAddr;
+        jsub["length"] = sub.length;
+        jsub["programme"] = sub.programmeNotData;
+        jsub["language"] = sub.language;
+        jsub["fec_scheme"] = sub.fecScheme;
+        jsub["protection"] = {
+            {"short_form", ps.shortForm},
+            {"uep_table_index", ps.uepTableIndex},
+            {"uep_level", ps.uepLevel},
+            {"eep_profile", static_cast<int>(ps.eepProfile)},
+            {"eep_level", static_cast<int>(ps.eepLevel)} };
+        j["subchannels"].push_back(jsub);
+    }
+
+    // Write to a temporary file first, so that a crash never leaves a
+    // truncated file behind
+    const auto name = filename(channel);
+    const auto tmpname = name + ".tmp";
+    {
+        ofstream file(tmpname);
+        file << j.dump(1) << endl;
+        if (not file) {
+            clog << "EnsembleDatabase: cannot write " << tmpname << endl;
+            file.close();
+            remove(tmpname.c_str());
+            return false;
+        }
+    }
+
+    if (rename(tmpname.c_str(), name.c_str()) != 0) {
+        // Windows does not replace existing files
+        remove(name.c_str());
+        if (rename(tmpname.c_str(), name.c_str()) != 0) {
+            clog << "EnsembleDatabase: cannot replace " << name << endl;
+            remove(tmpname.c_str());
+            return false;
+        }
+    }
+    return true;
+}
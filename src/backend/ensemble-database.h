@@ -0,0 +1,69 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef ENSEMBLE_DATABASE_H
+#define ENSEMBLE_DATABASE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dab-constants.h"
+
+// What the FIC told us about an ensemble: enough to list the services
+// and to start decoding one of them.
+struct EnsembleConfiguration {
+    uint16_t ensembleId = 0;
+    uint8_t ensembleEcc = 0;
+    DabLabel ensembleLabel;
+    std::vector<Service> services;
+    std::vector<ServiceComponent> components;
+    std::vector<Subchannel> subchannels;
+};
+
+/* Last known configuration of the ensemble on every channel, so that
+ * the services can be listed and played right after tuning, instead
+ * of only once enough of the FIC was received.
+ *
+ * Each channel is kept in its own JSON file in the directory, which
+ * gets replaced atomically on save.
+ */
+class EnsembleDatabase {
+    public:
+        explicit EnsembleDatabase(const std::string& directory);
+
+        // Returns false if nothing is known about the channel, or if the
+        // file cannot be read
+        bool load(const std::string& channel, EnsembleConfiguration& config) const;
+
+        // Returns false if the file cannot be written
+        bool save(const std::string& channel, const EnsembleConfiguration& config) const;
+
+    private:
+        std::string filename(const std::string& channel) const;
+
+        std::string directory;
+};
+
+#endif
@@ -25,6 +25,7 @@
  */
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <iomanip>
 #include <cstring>
 
@@ -32,13 +33,20 @@
 #include "charsets.h"
 #include "MathHelper.h"
 
+// How long the FIC has to confirm the services from the ensemble
+// database, counted from the first FIG 0/2 received
+static const std::chrono::seconds provisionalTimeout(10);
+
+// Shared by all FIBProcessors, so that versions never repeat after a retune
+static std::atomic<uint64_t> nextSnapshotVersion(1);
+
 FIBProcessor::FIBProcessor(RadioControllerInterface& mr) :
     myRadioInterface(mr)
 {
     clearEnsemble();
 }
 
-//  FIB's are segments of 256 bits. When here, we already
+//  FIB's are segments of 32 bytes. When here, we already
 //  passed the crc and we start unpacking into FIGs
 //  This is merely a dispatcher
 void FIBProcessor::processFIB(uint8_t *p, uint16_t fib)
@@ -65,6 +73,7 @@ void FIBProcessor::processFIB(uint8_t *p, uint16_t fib)
                 break;
 
             case 7:
+                publishSnapshot();
                 return;
 
             default:
@@ -74,8 +83,9 @@ void FIBProcessor::processFIB(uint8_t *p, uint16_t fib)
         //  Thanks to Ronny Kunze, who discovered that I used
         //  a p rather than a d
         processedBytes += getBits_5 (d, 3) + 1;
-        d = p + processedBytes * 8;
+        d = p + processedBytes;
     }
+    publishSnapshot();
 }
 //
 //  Handle ensemble is all through FIG0
@@ -122,6 +132,12 @@ void FIBProcessor::FIG0Extension0 (uint8_t *d)
     uint16_t eId  = getBits(d, 16, 16);
 
     if (ensembleId != eId) {
+        // The ensemble database was wrong about this channel
+        if (haveProvisionalServices) {
+            dropProvisionalServices();
+            ensembleLabel = DabLabel();
+        }
+
         ensembleId = eId;
         myRadioInterface.onNewEnsemble(ensembleId);
     }
@@ -288,6 +304,15 @@ int16_t FIBProcessor::HandleFIG0Extension2(
     // This avoids that misdecoded services appear and stay in the list.
     using namespace std::chrono;
     const auto now = steady_clock::now();
+    if (haveProvisionalServices) {
+        if (timeFirstServiceSignalled == steady_clock::time_point()) {
+            timeFirstServiceSignalled = now;
+        }
+        else if (timeFirstServiceSignalled + provisionalTimeout < now) {
+            dropProvisionalServices();
+        }
+    }
+
     if (timeLastServiceDecrement + seconds(1) < now) {
 
         auto it = serviceRepeatCount.begin();
@@ -321,10 +346,21 @@ int16_t FIBProcessor::HandleFIG0Extension2(
         serviceRepeatCount[SId]++;
     }
 
-    if (findServiceId(SId) == nullptr and serviceRepeatCount[SId] >= 2) {
+    Service *service = findServiceId(SId);
+    if (service == nullptr and serviceRepeatCount[SId] >= 2) {
         services.emplace_back(SId);
         myRadioInterface.onServiceDetected(SId);
     }
+    else if (service and service->provisional and serviceRepeatCount[SId] >= 2) {
+        // The components from the database get replaced by the ones
+        // signalled below
+        service->provisional = false;
+        components.erase(std::remove_if(components.begin(), components.end(),
+                    [&](const ServiceComponent& c) {
+                        return c.SId == SId;
+                    }
+                    ), components.end());
+    }
 
     numberofComponents = getBits_4(d, lOffset + 4);
     lOffset += 8;
@@ -520,7 +556,7 @@ void FIBProcessor::FIG0Extension10(uint8_t *fig)
         dateTime.seconds =  0;  // handle overflow
 
     dateTime.minutes = getBits_6(fig, offset + 26);
-    if (fig [offset + 20] == 1) {
+    if (getBits_1(fig, offset + 20) == 1) {
         dateTime.seconds = getBits_6(fig, offset + 32);
     }
 
@@ -963,14 +999,8 @@ static void handle_ext_label_data_field(const uint8_t *f, uint8_t len_bytes,
 // UTF-8 or UCS2 Labels
 void FIBProcessor::process_FIG2(uint8_t *d)
 {
-    // In order to reuse code with etisnoop, convert
-    // the bit-vector into a byte-vector
-    std::vector<uint8_t> fig_bytes;
-    for (size_t i = 0; i < 30; i++) {
-        fig_bytes.push_back(getBits_8(d, 8*i));
-    }
-
-    uint8_t *f = fig_bytes.data();
+    // The FIG is byte-aligned, which lets us reuse code with etisnoop
+    const uint8_t *f = d;
 
     const uint8_t figlen = f[0] & 0x1F;
     f++;
@@ -1260,6 +1290,21 @@ void FIBProcessor::dropService(uint32_t SId)
     std::clog << ss.str() << std::endl;
 }
 
+void FIBProcessor::dropProvisionalServices()
+{
+    std::vector<uint32_t> provisionalServices;
+    for (const auto& s : services) {
+        if (s.provisional) {
+            provisionalServices.push_back(s.serviceId);
+        }
+    }
+
+    for (const auto SId : provisionalServices) {
+        dropService(SId);
+    }
+    haveProvisionalServices = false;
+}
+
 void FIBProcessor::clearEnsemble()
 {
     std::lock_guard<std::mutex> lock(mutex);
@@ -1267,20 +1312,105 @@ void FIBProcessor::clearEnsemble()
     subChannels.resize(64);
     services.clear();
     serviceRepeatCount.clear();
+    haveProvisionalServices = false;
     timeLastServiceDecrement = std::chrono::steady_clock::now();
     timeLastFCT0Frame = std::chrono::system_clock::now();
+    publishSnapshot();
 }
 
-std::vector<Service> FIBProcessor::getServiceList() const
+void FIBProcessor::publishSnapshot()
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    return services;
+    const auto current = std::atomic_load(&snapshot);
+    if (current and
+            current->ensembleId == ensembleId and
+            current->ensembleEcc == ensembleEcc and
+            current->ensembleLabel == ensembleLabel and
+            current->services == services and
+            current->components == components and
+            current->subChannels == subChannels) {
+        return;
+    }
+
+    auto next = std::make_shared<EnsembleSnapshot>();
+    next->version = nextSnapshotVersion++;
+    next->ensembleId = ensembleId;
+    next->ensembleEcc = ensembleEcc;
+    next->ensembleLabel = ensembleLabel;
+    next->services = services;
+    next->components = components;
+    next->subChannels = subChannels;
+    std::atomic_store(&snapshot, std::shared_ptr<const EnsembleSnapshot>(std::move(next)));
 }
 
-Service FIBProcessor::getService(uint32_t sId) const
+void FIBProcessor::loadEnsemble(const EnsembleConfiguration& config)
 {
     std::lock_guard<std::mutex> lock(mutex);
+    ensembleId = config.ensembleId;
+    ensembleEcc = config.ensembleEcc;
+    ensembleLabel = config.ensembleLabel;
+    myRadioInterface.onNewEnsemble(ensembleId);
+    myRadioInterface.onSetEnsembleLabel(ensembleLabel);
+
+    for (const auto& sub : config.subchannels) {
+        if (not subChannels.at(sub.subChId).valid()) {
+            subChannels[sub.subChId] = sub;
+        }
+    }
+
+    for (const auto& s : config.services) {
+        if (findServiceId(s.serviceId) != nullptr) {
+            continue;
+        }
+
+        services.push_back(s);
+        services.back().provisional = true;
+        for (const auto& c : config.components) {
+            if (c.SId == s.serviceId) {
+                components.push_back(c);
+            }
+        }
+        myRadioInterface.onServiceDetected(s.serviceId);
+    }
+
+    haveProvisionalServices = true;
+    timeFirstServiceSignalled = std::chrono::steady_clock::time_point();
+    publishSnapshot();
+}
+
+EnsembleConfiguration FIBProcessor::getEnsembleConfiguration() const
+{
+    const auto current = getSnapshot();
+
+    EnsembleConfiguration config;
+    config.ensembleId = current->ensembleId;
+    config.ensembleEcc = current->ensembleEcc;
+    config.ensembleLabel = current->ensembleLabel;
 
+    std::vector<bool> subchannelUsed(current->subChannels.size());
+    for (const auto& s : current->services) {
+        if (s.provisional) {
+            continue;
+        }
+
+        config.services.push_back(s);
+        for (const auto& c : current->components) {
+            if (c.SId == s.serviceId) {
+                config.components.push_back(c);
+                subchannelUsed.at(c.subchannelId) = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < current->subChannels.size(); i++) {
+        if (subchannelUsed[i] and current->subChannels[i].valid()) {
+            config.subchannels.push_back(current->subChannels[i]);
+        }
+    }
+    return config;
+}
+
+Service EnsembleSnapshot::getService(uint32_t sId) const
+{
     auto srv = std::find_if(services.begin(), services.end(),
                 [&](const Service& s) {
                     return s.serviceId == sId;
@@ -1294,10 +1424,9 @@ Service FIBProcessor::getService(uint32_t sId) const
     }
 }
 
-std::list<ServiceComponent> FIBProcessor::getComponents(const Service& s) const
+std::list<ServiceComponent> EnsembleSnapshot::getComponents(const Service& s) const
 {
     std::list<ServiceComponent> c;
-    std::lock_guard<std::mutex> lock(mutex);
     for (const auto& component : components) {
         if (component.SId == s.serviceId) {
             c.push_back(component);
@@ -1307,28 +1436,49 @@ std::list<ServiceComponent> FIBProcessor::getComponents(const Service& s) const
     return c;
 }
 
-Subchannel FIBProcessor::getSubchannel(const ServiceComponent& sc) const
+Subchannel EnsembleSnapshot::getSubchannel(const ServiceComponent& sc) const
 {
-    std::lock_guard<std::mutex> lock(mutex);
     return subChannels.at(sc.subchannelId);
 }
 
+std::shared_ptr<const EnsembleSnapshot> FIBProcessor::getSnapshot() const
+{
+    return std::atomic_load(&snapshot);
+}
+
+std::vector<Service> FIBProcessor::getServiceList() const
+{
+    return getSnapshot()->services;
+}
+
+Service FIBProcessor::getService(uint32_t sId) const
+{
+    return getSnapshot()->getService(sId);
+}
+
+std::list<ServiceComponent> FIBProcessor::getComponents(const Service& s) const
+{
+    return getSnapshot()->getComponents(s);
+}
+
+Subchannel FIBProcessor::getSubchannel(const ServiceComponent& sc) const
+{
+    return getSnapshot()->getSubchannel(sc);
+}
+
 uint16_t FIBProcessor::getEnsembleId() const
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    return ensembleId;
+    return getSnapshot()->ensembleId;
 }
 
 uint8_t FIBProcessor::getEnsembleEcc() const
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    return ensembleEcc;
+    return getSnapshot()->ensembleEcc;
 }
 
 DabLabel FIBProcessor::getEnsembleLabel() const
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    return ensembleLabel;
+    return getSnapshot()->ensembleLabel;
 }
 
 std::chrono::system_clock::time_point FIBProcessor::getTimeLastFCT0Frame() const
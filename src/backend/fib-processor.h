@@ -30,11 +30,36 @@
 #include <unordered_map>
 #include <chrono>
 #include <array>
+#include <memory>
 #include <mutex>
 #include <cstdint>
 #include <cstdio>
 #include "msc-handler.h"
 #include "radio-controller.h"
+#include "ensemble-database.h"
+
+/* Immutable copy of what the FIC told us about the ensemble. A new one
+ * gets published after every FIB that changed something, so that readers
+ * see a consistent view without ever waiting for the FIC decoder.
+ */
+struct EnsembleSnapshot {
+    // Increases with every snapshot published by any FIBProcessor, so that
+    // a reader can tell whether anything changed since it last looked,
+    // even across retunes
+    uint64_t version = 0;
+
+    uint16_t ensembleId = 0;
+    uint8_t ensembleEcc = 0;
+    DabLabel ensembleLabel;
+    std::vector<Service> services;
+    std::vector<ServiceComponent> components;
+    std::vector<Subchannel> subChannels; // Indexed by SubChId
+
+    /* Returns a service with sid 0 in case it is missing */
+    Service getService(uint32_t sId) const;
+    std::list<ServiceComponent> getComponents(const Service& s) const;
+    Subchannel getSubchannel(const ServiceComponent& sc) const;
+};
 
 class FIBProcessor {
     public:
@@ -44,7 +69,15 @@ class FIBProcessor {
         void processFIB(uint8_t *p, uint16_t fib);
         void clearEnsemble();
 
-        // Called from the frontend
+        // Fill in the configuration last seen on this channel, usually
+        // right after clearEnsemble(). The services are provisional
+        // until the FIC signals them. They get dropped if it does not
+        // do so soon, or if it turns out to be another ensemble.
+        void loadEnsemble(const EnsembleConfiguration& config);
+
+        // Called from the frontend. None of these take the lock the FIC
+        // decoder holds, they all read the latest snapshot.
+        std::shared_ptr<const EnsembleSnapshot> getSnapshot() const;
         uint16_t getEnsembleId() const;
         uint8_t getEnsembleEcc() const;
         DabLabel getEnsembleLabel() const;
@@ -54,6 +87,10 @@ class FIBProcessor {
         Subchannel getSubchannel(const ServiceComponent& sc) const;
         std::chrono::system_clock::time_point getTimeLastFCT0Frame() const;
 
+        // The services confirmed by the FIC, and what is needed to
+        // decode them
+        EnsembleConfiguration getEnsembleConfiguration() const;
+
     private:
         RadioControllerInterface& myRadioInterface;
         Service *findServiceId(uint32_t serviceId);
@@ -84,7 +121,12 @@ class FIBProcessor {
                 int16_t ps_flag,
                 int16_t CAflag);
 
+        // Publish a new snapshot if the ensemble changed since the last one.
+        // Call with the mutex held.
+        void publishSnapshot(void);
+
         void dropService(uint32_t SId);
+        void dropProvisionalServices(void);
 
         void process_FIG0(uint8_t *);
         void process_FIG1(uint8_t *);
@@ -132,6 +174,13 @@ class FIBProcessor {
         std::unordered_map<uint32_t, uint8_t> serviceRepeatCount;
         std::chrono::steady_clock::time_point timeLastServiceDecrement;
         std::chrono::system_clock::time_point timeLastFCT0Frame;
+
+        // Only accessed through std::atomic_load and std::atomic_store
+        std::shared_ptr<const EnsembleSnapshot> snapshot;
+
+        bool haveProvisionalServices = false;
+        // Time of the first FIG 0/2 after loadEnsemble()
+        std::chrono::steady_clock::time_point timeFirstServiceSignalled;
 };
 
 #endif
@@ -26,6 +26,7 @@
 #include "fic-handler.h"
 #include "msc-handler.h"
 #include "protTables.h"
+#include "protection.h"
 
 //  The 3072 bits of the serial motherword shall be split into
 //  24 blocks of 128 bits each.
@@ -36,7 +37,7 @@
 //  The last 24 bits shall be subjected to puncturing
 //  according to the table X
 
-uint8_t PI_X [24] = {
+const int8_t PI_X [24] = {
     1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0,
     1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0
 };
@@ -53,22 +54,12 @@ FicHandler::FicHandler(RadioControllerInterface& mr) :
     Viterbi(768),
     fibProcessor(mr),
     myRadioInterface(mr),
-    bitBuffer_out(768),
-    ofdm_input(2304),
-    viterbiBlock(3072 + 24)
+    bitBuffer_out(768 / 8),
+    ofdm_input(2304)
 {
-    PI_15 = getPCodes(15 - 1);
-    PI_16 = getPCodes(16 - 1);
-    std::vector<uint8_t> shiftRegister(9, 1);
-
-    for (int i = 0; i < 768; i++) {
-        PRBS[i] = shiftRegister[8] ^ shiftRegister[4];
-        for (int j = 8; j > 0; j--) {
-            shiftRegister[j] = shiftRegister[j - 1];
-        }
-
-        shiftRegister[0] = PRBS[i];
-    }
+    appendPuncturing(21 * 128, getPCodes(16 - 1));
+    appendPuncturing(3 * 128, getPCodes(15 - 1));
+    appendPuncturing(24, PI_X, 24);
 }
 
 /**
@@ -135,77 +126,30 @@ void FicHandler::processFicBlock(const softbit_t *data, int16_t blkno)
 /**
  * \brief processFicInput
  * we have a vector of 2304 (0 .. 2303) soft bits that has
- * to be de-punctured and de-conv-ed into a block of 768 bits
- * In this approach we first create the full 3072 block (i.e.
- * we first depuncture, and then we apply the deconvolution
- * In the next coding step, we will combine this function with the
- * one above
+ * to be de-punctured and de-conv-ed into a block of 768 bits,
+ * packed into 96 bytes
  */
 void FicHandler::processFicInput(const softbit_t *ficblock, int16_t ficno)
 {
-    int16_t input_counter = 0;
-    int16_t i, k;
-    int32_t local         = 0;
-
-    memset(viterbiBlock.data(), 0, viterbiBlock.size() * sizeof(*viterbiBlock.data()));
-
-    /**
-     * a block of 2304 bits is considered to be a codeword
-     * In the first step we have 21 blocks with puncturing according to PI_16
-     * each 128 bit block contains 4 subblocks of 32 bits
-     * on which the given puncturing is applied
-     */
-    for (i = 0; i < 21; i ++) {
-        for (k = 0; k < 32 * 4; k ++) {
-            if (PI_16 [k % 32] != 0) {
-                viterbiBlock[local] = ficblock[input_counter ++];
-            }
-            local ++;
-        }
-    }
-
-    /**
-     * In the second step
-     * we have 3 blocks with puncturing according to PI_15
-     * each 128 bit block contains 4 subblocks of 32 bits
-     * on which the given puncturing is applied
-     */
-    for (i = 0; i < 3; i ++) {
-        for (k = 0; k < 32 * 4; k ++) {
-            if (PI_15 [k % 32] != 0) {
-                viterbiBlock[local] = ficblock[input_counter ++];
-            }
-            local++;
-        }
-    }
+    int16_t i;
 
     /**
-     * we have a final block of 24 bits  with puncturing according to PI_X
-     * This block constitutes the 6 * 4 bits of the register itself.
+     * The puncturing follows the table set up in the constructor:
+     * 21 blocks of 128 bits punctured according to PI_16,
+     * 3 blocks punctured according to PI_15 and the final
+     * 24 bits of the register punctured according to PI_X.
+     * Depuncturing and deconvolution are according to the DAB
+     * standard section 11.2
      */
-    for (k = 0; k < 24; k ++) {
-        if (PI_X [k] != 0) {
-            viterbiBlock[local] = ficblock[input_counter++];
-        }
-        local ++;
-    }
-
-    /**
-     * Now we have the full word ready for deconvolution
-     * deconvolution is according to DAB standard section 11.2
-     */
-    deconvolve(viterbiBlock.data(), bitBuffer_out.data());
+    deconvolvePunctured(ficblock, bitBuffer_out.data());
 
     /**
      * if everything worked as planned, we now have a
      * 768 bit vector containing three FIB's
      *
      * first step: energy dispersal according to the DAB standard
-     * We use a predefined vector PRBS
      */
-    for (i = 0; i < 768; i ++) {
-        bitBuffer_out[i] ^= PRBS[i];
-    }
+    energyDispersal.dedisperse(bitBuffer_out);
 
     /**
      * each of the fib blocks is protected by a crc
@@ -213,8 +157,8 @@ void FicHandler::processFicInput(const softbit_t *ficblock, int16_t ficno)
      * we keep track of the successrate
      */
     for (i = ficno * 3; i < ficno * 3 + 3; i ++) {
-        uint8_t *p = &bitBuffer_out[(i % 3) * 256];
-        const bool crcvalid = check_CRC_bits(p, 256);
+        uint8_t *p = &bitBuffer_out[(i % 3) * 32];
+        const bool crcvalid = check_crc_bytes(p, 30);
         myRadioInterface.onFIBDecodeSuccess(crcvalid, p);
         if (crcvalid) {
             fibProcessor.processFIB(p, ficno);
@@ -32,6 +32,7 @@
 #include <cstdio>
 #include <cstdint>
 #include "viterbi.h"
+#include "energy_dispersal.h"
 #include "fib-processor.h"
 #include "radio-controller.h"
 
@@ -49,15 +50,12 @@ class FicHandler: public Viterbi
     private:
         RadioControllerInterface& myRadioInterface;
         void        processFicInput(const softbit_t *ficblock, int16_t ficno);
-        const int8_t *PI_15;
-        const int8_t *PI_16;
         std::vector<uint8_t> bitBuffer_out;
         std::vector<softbit_t> ofdm_input;
-        std::vector<softbit_t> viterbiBlock;
         int16_t     index = 0;
         int16_t     bitsperBlock = 2 * 1536;
         int16_t     ficno = 0;
-        uint8_t     PRBS[768];
+        EnergyDispersal energyDispersal;
 
         // Saturating up/down-counter in range [0, 10] corresponding
         // to the number of FICs with correct CRC
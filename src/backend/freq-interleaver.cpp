@@ -85,7 +85,7 @@ FrequencyInterleaver::FrequencyInterleaver(const DABParams& param)
 
 //  according to the standard, the map is a function from
 //  0 .. 1535->-768 .. 768 (with exclusion of {0})
-int16_t FrequencyInterleaver::mapIn(int16_t n)
+int16_t FrequencyInterleaver::mapIn(int16_t n) const
 {
     return permTable[n];
 }
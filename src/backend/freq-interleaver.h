@@ -38,7 +38,7 @@ class FrequencyInterleaver
 {
     public:
         FrequencyInterleaver(const DABParams& param);
-        int16_t mapIn(int16_t);
+        int16_t mapIn(int16_t) const;
 
     private:
         std::vector<int16_t> permTable;
@@ -76,12 +76,14 @@ bool MscHandler::addSubchannel(
     SelectedStream s(handler, ascty, dumpFileName, sub);
 
     s.dabHandler = std::make_shared<DabAudio>(
+                sub.subChId,
                 ascty,
                 sub.length * CUSize,
                 sub.bitrate(),
                 sub.protectionSettings,
                 handler,
-                dumpFileName);
+                dumpFileName,
+                workerPool);
 
      /* TODO dealing with data
       s.dabHandler = std::make_shared<DabData>(radioInterface,
@@ -97,6 +99,7 @@ bool MscHandler::addSubchannel(
       */
 
     streams.push_back(std::move(s));
+    updateCifRanges();
 
     work_to_be_done = true;
     return true;
@@ -113,6 +116,7 @@ bool MscHandler::removeSubchannel(const Subchannel& sub)
 
     if (it != streams.end()) {
         streams.erase(it);
+        updateCifRanges();
         return true;
     }
 
@@ -135,8 +139,24 @@ void MscHandler::processMscBlock(const softbit_t *fbits, int16_t blkno)
 
     int16_t currentblk = (blkno - 4) % numberofblocksperCIF;
 
-    //  and the normal operation is:
-    memcpy(&cifVector[currentblk * bitsperBlock], fbits, bitsperBlock * sizeof(softbit_t));
+    if (currentblk == 0) {
+        for (auto& stream : streams) {
+            stream.waitForCIFStart = false;
+        }
+    }
+
+    //  Only copy the parts of the block the selected subchannels
+    //  occupy
+    const int32_t blkBegin = currentblk * bitsperBlock;
+    const int32_t blkEnd = blkBegin + bitsperBlock;
+    for (const auto& range : cifRanges) {
+        const int32_t begin = std::max(range.first, blkBegin);
+        const int32_t end = std::min(range.second, blkEnd);
+        if (begin < end) {
+            memcpy(&cifVector[begin], fbits + (begin - blkBegin),
+                    (end - begin) * sizeof(softbit_t));
+        }
+    }
 
     if (currentblk < numberofblocksperCIF - 1)
         return;
@@ -146,6 +166,10 @@ void MscHandler::processMscBlock(const softbit_t *fbits, int16_t blkno)
     cifCount = (cifCount + 1) & 03;
 
     for (auto& stream : streams) {
+        if (stream.waitForCIFStart) {
+            continue;
+        }
+
         softbit_t *myBegin = &cifVector[stream.subCh.startAddr * CUSize];
 
         if (stream.dabHandler) {
@@ -157,10 +181,43 @@ void MscHandler::processMscBlock(const softbit_t *fbits, int16_t blkno)
     }
 }
 
+void MscHandler::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& stream : streams) {
+        stream.dabHandler->flush();
+    }
+}
+
 void MscHandler::stopProcessing()
 {
     std::lock_guard<std::mutex> lock(mutex);
     work_to_be_done = false;
     streams.clear();
+    cifRanges.clear();
+}
+
+void MscHandler::updateCifRanges()
+{
+    std::vector<std::pair<int32_t, int32_t> > ranges;
+    for (const auto& stream : streams) {
+        const int32_t begin = stream.subCh.startAddr * CUSize;
+        const int32_t end = std::min<int32_t>(
+                begin + stream.subCh.length * CUSize, cifVector.size());
+        if (begin < end) {
+            ranges.emplace_back(begin, end);
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+
+    cifRanges.clear();
+    for (const auto& range : ranges) {
+        if (not cifRanges.empty() and range.first <= cifRanges.back().second) {
+            cifRanges.back().second = std::max(cifRanges.back().second, range.second);
+        }
+        else {
+            cifRanges.push_back(range);
+        }
+    }
 }
 
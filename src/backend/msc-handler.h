@@ -33,6 +33,7 @@
 #include <mutex>
 #include <list>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <cstdio>
 #include <cstdint>
@@ -40,6 +41,7 @@
 #include "dab-constants.h"
 #include "ringbuffer.h"
 #include "radio-controller.h"
+#include "workerpool.h"
 
 class DabVirtual;
 
@@ -59,10 +61,16 @@ class MscHandler
 
         bool removeSubchannel(const Subchannel& sub);
 
+        // Wait until the selected streams decoded all CIFs received so far
+        void flush(void);
+
     private:
         friend class OfdmDecoder;
         void processMscBlock(const softbit_t *fbits, int16_t blkno);
 
+        // Recompute cifRanges from the selected streams
+        void updateCifRanges(void);
+
         struct SelectedStream {
             SelectedStream(
                 ProgrammeHandlerInterface& handler,
@@ -81,9 +89,16 @@ class MscHandler
             const Subchannel subCh;
 
             std::shared_ptr<DabVirtual> dabHandler;
+
+            // Streams selected in the middle of a CIF miss its first
+            // blocks, they get data from the next CIF on
+            bool waitForCIFStart = true;
         };
 
         std::mutex mutex;
+
+        // Shared by the decoders of all selected streams, must outlive them
+        WorkerPool workerPool;
         std::list<SelectedStream> streams;
 
         const int16_t bitsperBlock;
@@ -91,6 +106,11 @@ class MscHandler
         bool show_crcErrors;
 
         std::vector<softbit_t> cifVector;
+
+        // Ranges of soft bits [first, second) in the CIF covered by the
+        // selected streams, sorted and merged. Only these get copied
+        // into cifVector.
+        std::vector<std::pair<int32_t, int32_t> > cifRanges;
         int16_t cifCount = 0; // msc blocks in CIF
         int16_t blkCount = 0;
         bool work_to_be_done = false;
@@ -28,6 +28,7 @@
  */
 
 #include <cstddef>
+#include <algorithm>
 #include "ofdm-decoder.h"
 #include "various/profiling.h"
 #include <iostream>
@@ -43,7 +44,8 @@ OfdmDecoder::OfdmDecoder(
         const DABParams& p,
         RadioControllerInterface& mr,
         FicHandler& ficHandler,
-        MscHandler& mscHandler) :
+        MscHandler& mscHandler,
+        size_t numThreads) :
     params(p),
     radioInterface(mr),
     ficHandler(ficHandler),
@@ -52,37 +54,56 @@ OfdmDecoder::OfdmDecoder(
     phaseReference(params.T_u),
     fft_handler(p.T_u),
     interleaver(p),
-    ibits(2 * params.K)
+    demapper(p),
+    ibits(2 * params.K),
+    numThreads(std::max<size_t>(numThreads, 1))
 {
     T_g = params.T_s - params.T_u;
     fft_buffer = fft_handler.getVector();
 
+    if (this->numThreads > 1) {
+        for (size_t i = 1; i < this->numThreads; i++) {
+            chunkFFTs.emplace_back(new fft::Forward(params.T_u));
+        }
+        frameSpectra.resize(params.L * params.T_u);
+        frameBits.resize(params.L * 2 * params.K);
+        workerPool.reset(new WorkerPool(this->numThreads - 1));
+    }
+
     /**
      * When implemented in a thread, the thread controls the
      * reading in of the data and processing the data through
      * functions for handling symbol 0, FIC symbols and MSC symbols.
      */
+    running = true;
     thread = std::thread(&OfdmDecoder::workerthread, this);
 }
 
 OfdmDecoder::~OfdmDecoder()
 {
-    running = false;
-    pending_symbols_cv.notify_all();
-    if (thread.joinable()) {
-        thread.join();
-    }
+    stop();
 }
 
 void OfdmDecoder::reset()
 {
-    running = false;
+    stop();
+
+    running = true;
+    thread = std::thread(&OfdmDecoder::workerthread, this);
+}
+
+void OfdmDecoder::stop()
+{
+    {
+        // Under the lock, so that no waiter checks running before it
+        // changes and misses the notification
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
     pending_symbols_cv.notify_all();
     if (thread.joinable()) {
         thread.join();
     }
-
-    thread = std::thread(&OfdmDecoder::workerthread, this);
 }
 
 /**
@@ -94,36 +115,42 @@ void OfdmDecoder::workerthread()
 {
     int currentSym = 0;
 
-    running = true;
+    PROFILE_THREAD_NAME("OFDM decoder");
 
+    std::unique_lock<std::mutex> lock(mutex);
     while (running) {
-        std::unique_lock<std::mutex> lock(mutex);
-        pending_symbols_cv.wait_for(lock, std::chrono::milliseconds(100));
-
-        if (currentSym == 0) {
-            constellationPoints.clear();
-            constellationPoints.reserve(
-                    (params.L-1) * params.K / constellationDecimation);
-        }
+        pending_symbols_cv.wait(lock, [this]() {
+                return num_pending_symbols > 0 or not running; });
 
         while (num_pending_symbols > 0 && running) {
+            if (currentSym == 0) {
+                constellationPoints.resize(
+                        (params.L-1) * params.K / constellationDecimation);
+            }
 
-            if (currentSym == 0)
-                processPRS();
-            else
-                decodeDataSymbol(currentSym);
-
-            currentSym = (currentSym + 1) % (params.L);
-            num_pending_symbols -= 1;
+            if (workerPool and currentSym == 0 and
+                    num_pending_symbols == params.L) {
+                decodeFrameParallel();
+                num_pending_symbols = 0;
+            }
+            else {
+                if (currentSym == 0)
+                    processPRS();
+                else
+                    decodeDataSymbol(currentSym);
+
+                currentSym = (currentSym + 1) % (params.L);
+                num_pending_symbols -= 1;
+            }
 
             if (currentSym == 0) {
                 radioInterface.onConstellationPoints(
                         std::move(constellationPoints));
-                constellationPoints.clear();
-                constellationPoints.reserve(
-                        (params.L-1) * params.K / constellationDecimation);
             }
         }
+
+        // Let pushAllSymbols() hand over the next frame
+        pending_symbols_cv.notify_all();
     }
 
     std::clog << "OFDM-decoder:" <<  "closing down now" << std::endl;
@@ -133,9 +160,24 @@ void OfdmDecoder::pushAllSymbols(std::vector<std::vector<DSPCOMPLEX> >&& syms)
 {
     std::unique_lock<std::mutex> lock(mutex);
 
+    // Wait until the previous frame is decoded, so that none is lost
+    // when the input comes faster than real time
+    pending_symbols_cv.wait(lock, [this]() {
+            return num_pending_symbols == 0 or not running; });
+
     pending_symbols = std::move(syms);
     num_pending_symbols = pending_symbols.size();
-    pending_symbols_cv.notify_one();
+    pending_symbols_cv.notify_all();
+}
+
+void OfdmDecoder::flush()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        pending_symbols_cv.wait(lock, [this]() {
+                return num_pending_symbols == 0 or not running; });
+    }
+    mscHandler.flush();
 }
 
 /**
@@ -191,44 +233,120 @@ void OfdmDecoder::decodeDataSymbol(int32_t sym_ix)
      */
 
     PROFILE(Deinterleaver);
+    demodulate(fft_buffer, phaseReference.data(), sym_ix, ibits.data());
+
     /**
-     * Note that from here on, we are only interested in the
-     * K useful carriers of the FFT output
+     * The carriers of a symbol are the reference for the
+     * carriers on the same position in the next symbol
      */
-    for (int16_t i = 0; i < params.K; i ++) {
+    memcpy(phaseReference.data(), fft_buffer, params.T_u * sizeof (DSPCOMPLEX));
+
+    dispatch(ibits.data(), sym_ix);
+}
+
+void OfdmDecoder::demodulate(
+        const DSPCOMPLEX *spectrum,
+        const DSPCOMPLEX *reference,
+        int32_t sym_ix, softbit_t *bits)
+{
+    /**
+     * decoding is computing the phase difference between
+     * carriers with the same index in subsequent symbols.
+     */
+    demapper.demap(spectrum, reference, bits);
+
+    DSPCOMPLEX *points = &constellationPoints[
+        (sym_ix - 1) * params.K / constellationDecimation];
+    for (int16_t i = 0; i < params.K; i += constellationDecimation) {
         int16_t index = interleaver.mapIn(i);
         if (index < 0)
             index += params.T_u;
-        /**
-         * decoding is computing the phase difference between
-         * carriers with the same index in subsequent symbols.
-         * The carrier of a symbols is the reference for the carrier
-         * on the same position in the next symbols
-         */
-        const DSPCOMPLEX r1 = fft_buffer[index] * conj (phaseReference[index]);
-        phaseReference[index] = fft_buffer[index];
-        const DSPFLOAT ab1 = 127.0f / l1_norm(r1);
-        /// split the real and the imaginary part and scale it
-
-        ibits[i]            = -real (r1) * ab1;
-        ibits[params.K + i] = -imag (r1) * ab1;
-
-        if (i % constellationDecimation == 0) {
-            constellationPoints.push_back(r1);
-        }
+        *points++ = spectrum[index] * conj (reference[index]);
     }
+}
 
+void OfdmDecoder::dispatch(const softbit_t *bits, int32_t sym_ix)
+{
     if (sym_ix < 4) {
         PROFILE(FICHandler);
-        ficHandler.processFicBlock(ibits.data(), sym_ix);
+        ficHandler.processFicBlock(bits, sym_ix);
     }
     else {
         PROFILE(MSCHandler);
-        mscHandler.processMscBlock(ibits.data(), sym_ix);
+        mscHandler.processMscBlock(bits, sym_ix);
     }
     PROFILE(SymbolProcessed);
 }
 
+void OfdmDecoder::decodeFrameParallel()
+{
+    const int32_t T_u = params.T_u;
+
+    // The FFT of every symbol, the PRS included, goes into frameSpectra
+    // where it serves as reference for the next symbol
+    forEachChunk(0, params.L, [&](size_t chunk, int32_t first, int32_t last) {
+            fft::Forward& fft = chunk == 0 ? fft_handler : *chunkFFTs[chunk - 1];
+            DSPCOMPLEX *buffer = fft.getVector();
+            for (int32_t sym_ix = first; sym_ix < last; sym_ix++) {
+                PROFILE(ProcessSymbol);
+                const int32_t offset = sym_ix == 0 ? 0 : T_g;
+                memcpy(buffer, pending_symbols[sym_ix].data() + offset,
+                        T_u * sizeof (DSPCOMPLEX));
+                fft.do_FFT();
+                memcpy(&frameSpectra[sym_ix * T_u], buffer,
+                        T_u * sizeof (DSPCOMPLEX));
+            }
+        });
+
+    forEachChunk(1, params.L, [&](size_t, int32_t first, int32_t last) {
+            for (int32_t sym_ix = first; sym_ix < last; sym_ix++) {
+                PROFILE(Deinterleaver);
+                demodulate(&frameSpectra[sym_ix * T_u],
+                        &frameSpectra[(sym_ix - 1) * T_u],
+                        sym_ix, &frameBits[sym_ix * 2 * params.K]);
+            }
+        });
+
+    snr = 0.7 * snr + 0.3 * get_snr(frameSpectra.data(), 1);
+    if (++snrCount > 10) {
+        radioInterface.onSNR(snr);
+        snrCount = 0;
+    }
+
+    for (int32_t sym_ix = 1; sym_ix < params.L; sym_ix++) {
+        dispatch(&frameBits[sym_ix * 2 * params.K], sym_ix);
+    }
+}
+
+void OfdmDecoder::forEachChunk(int32_t first, int32_t last,
+        const std::function<void(size_t, int32_t, int32_t)>& f)
+{
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t num_running = numThreads - 1;
+
+    const int32_t count = last - first;
+    auto chunk_begin = [&](size_t chunk) {
+        return first + static_cast<int32_t>(count * chunk / numThreads);
+    };
+
+    for (size_t chunk = 1; chunk < numThreads; chunk++) {
+        workerPool->submit([&, chunk]() {
+                f(chunk, chunk_begin(chunk), chunk_begin(chunk + 1));
+
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (--num_running == 0) {
+                    done_cv.notify_one();
+                }
+            });
+    }
+
+    f(0, chunk_begin(0), chunk_begin(1));
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&]() { return num_running == 0; });
+}
+
 /**
  * for the snr we have a full T_u wide vector, with in the middle
  * K carriers.
@@ -25,6 +25,8 @@
 #define __OFDM_DECODER
 
 #include <cstddef>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <thread>
 #include <condition_variable>
@@ -34,9 +36,11 @@
 #include "fft.h"
 #include "dab-constants.h"
 #include "freq-interleaver.h"
+#include "dqpsk-demapper.h"
 #include "radio-controller.h"
 #include "fic-handler.h"
 #include "msc-handler.h"
+#include "various/workerpool.h"
 
 class OfdmDecoder
 {
@@ -45,10 +49,16 @@ class OfdmDecoder
                 const DABParams& p,
                 RadioControllerInterface& mr,
                 FicHandler& ficHandler,
-                MscHandler& mscHandler);
+                MscHandler& mscHandler,
+                size_t numThreads = 1);
         ~OfdmDecoder();
+        // Hand over the symbols of one frame, blocks while the decoder
+        // is still busy with the previous one
         void    pushAllSymbols(std::vector<std::vector<DSPCOMPLEX> >&& sym);
         void    reset();
+        // Wait until the symbols handed over are decoded, including
+        // the subchannels
+        void    flush();
     private:
         int16_t get_snr(DSPCOMPLEX *, uint8_t method);
 
@@ -65,14 +75,37 @@ class OfdmDecoder
 
         std::thread thread;
         void workerthread(void);
+        void stop(void);
         void processPRS();
         void decodeDataSymbol(int32_t n);
 
+        // Differential demodulation of the carriers of symbol sym_ix
+        // against those of the previous symbol, and frequency
+        // deinterleaving into bits
+        void demodulate(const DSPCOMPLEX *spectrum,
+                const DSPCOMPLEX *reference,
+                int32_t sym_ix, softbit_t *bits);
+
+        // Hand the bits of a symbol over to the FIC or MSC handler
+        void dispatch(const softbit_t *bits, int32_t sym_ix);
+
+        // With more than one thread, the FFTs of a whole frame are done
+        // in parallel, then all data symbols are demodulated in parallel,
+        // and the bits are handed over in order.
+        void decodeFrameParallel(void);
+
+        // Split [first, last) into one chunk per thread and call f for
+        // each of them, the chunk index selects the FFT plan to use.
+        // Returns once all chunks are done.
+        void forEachChunk(int32_t first, int32_t last,
+                const std::function<void(size_t, int32_t, int32_t)>& f);
+
         int32_t T_g;
         std::vector<DSPCOMPLEX> phaseReference;
         fft::Forward fft_handler;
         DSPCOMPLEX   *fft_buffer;
         FrequencyInterleaver interleaver;
+        DQPSKDemapper demapper;
 
         std::vector<softbit_t> ibits;
         int16_t snrCount = 0;
@@ -87,6 +120,21 @@ class OfdmDecoder
         static const size_t constellationDecimation = 96;
     private:
         std::vector<DSPCOMPLEX> constellationPoints;
+
+        const size_t numThreads;
+
+        // One FFT plan for every chunk but the first, which uses
+        // fft_handler
+        std::vector<std::unique_ptr<fft::Forward> > chunkFFTs;
+
+        // Spectra of all L symbols and bits of all data symbols of the
+        // frame, for the parallel demodulation
+        std::vector<DSPCOMPLEX> frameSpectra;
+        std::vector<softbit_t> frameBits;
+
+        // numThreads - 1 workers, the decoder thread runs the first chunk
+        // itself
+        std::unique_ptr<WorkerPool> workerPool;
 };
 
 #endif
@@ -33,6 +33,8 @@
 #include <cstddef>
 #include "ofdm-processor.h"
 #include "various/profiling.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 //
 #define SEARCH_RANGE        (2 * 36)
@@ -68,9 +70,8 @@ OFDMProcessor::OFDMProcessor(
     T_u(params.T_u),
     T_s(params.T_s),
     T_F(params.T_F),
-    oscillatorTable(INPUT_RATE),
     phaseRef(params, rro.fftPlacementMethod),
-    ofdmDecoder(params, ri, fic, msc),
+    ofdmDecoder(params, ri, fic, msc, rro.demodulatorThreads),
     fft_handler(params.T_u),
     fft_buffer(fft_handler.getVector())
 {
@@ -89,10 +90,6 @@ OFDMProcessor::OFDMProcessor(
      * the decoded symbols
      */
 
-    for (int i = 0; i < INPUT_RATE; i ++)
-        oscillatorTable[i] = DSPCOMPLEX(cos(2.0 * M_PI * i / INPUT_RATE),
-                sin(2.0 * M_PI * i / INPUT_RATE));
-
     //  and for the correlation
     refArg.resize(CORRELATION_LENGTH);
     for (int i = 0; i < CORRELATION_LENGTH; i ++)  {
@@ -125,7 +122,7 @@ void OFDMProcessor::restart()
     fineCorrector      = 0;
     syncBufferIndex    = 0;
     sLevel             = 0;
-    localPhase         = 0;
+    nco.reset();
     input.restart();
     running            = true;
     threadHandle       = std::thread(&OFDMProcessor::run, this);
@@ -135,86 +132,153 @@ class InputFailure { };
 class NotRunningAnymore { };
 
 /**
- * \brief getSample
- * Profiling shows that getting a sample, together
- * with the frequency shift, is a real performance killer.
- * we therefore distinguish between getting a single sample
- * and getting a vector full of samples
+ * \brief readSamples
+ * Get n samples from the input device, blocking until they
+ * are available.
  */
-
-DSPCOMPLEX OFDMProcessor::getSample(int32_t phase)
+void OFDMProcessor::readSamples(DSPCOMPLEX *v, int32_t n)
 {
-    DSPCOMPLEX temp;
-    if (!running)
-        throw NotRunningAnymore();
-    /// bufferContent is an indicator for the value of ...->Samples ()
-    if (bufferContent == 0) {
-        bufferContent = input.getSamplesToRead ();
-        while ((bufferContent == 0) && running) {
-            if (not input.is_ok()) {
-                throw InputFailure();
-            }
-            std::this_thread::sleep_for(std::chrono::microseconds(10));
+    while (n > 0) {
+        if (!running)
+            throw NotRunningAnymore();
+        if (n > bufferContent) {
             bufferContent = input.getSamplesToRead ();
+            while ((bufferContent < n) && running) {
+                if (not input.is_ok()) {
+                    throw InputFailure();
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+                bufferContent = input.getSamplesToRead();
+            }
         }
+        if (!running)
+            throw NotRunningAnymore();
+        //
+        //  so here, bufferContent >= n
+        const int32_t read = input.getSamples (v, n);
+
+        //  The input may still deliver less, e.g. after a reset. Ask it
+        //  again for the rest, rather than mixing what is in v.
+        bufferContent = read < n ? 0 : bufferContent - read;
+        v += read;
+        n -= read;
     }
+}
 
-    if (!running)
-        throw NotRunningAnymore();
-    //
-    //  so here, bufferContent > 0
-    input.getSamples (&temp, 1);
-    bufferContent --;
+static inline int32_t wrapPhase(int64_t phase)
+{
+    phase %= INPUT_RATE;
+    return phase < 0 ? phase + INPUT_RATE : phase;
+}
 
-    //
-    //  OK, we have a sample!!
-    //  first: adjust frequency. We need Hz accuracy
-    localPhase  -= phase;
-    localPhase  = (localPhase + INPUT_RATE) % INPUT_RATE;
-    temp        *= oscillatorTable[localPhase];
-    sLevel      = 0.00001 * l1_norm(temp) + (1 - 0.00001) * sLevel;
-#define N   5
-    sampleCnt   ++;
-    if (++ sampleCnt > INPUT_RATE / N) {
-        radioInterface.onFrequencyCorrectorChange(
-                fineCorrector, coarseCorrector);
-        sampleCnt = 0;
-    }
-    return temp;
+/**
+ * \brief NCO::mix
+ * Profiling shows that the frequency shift is a real performance
+ * killer when done sample per sample with a table lookup each.
+ * The phasors of NCO_LANES consecutive samples are therefore taken from
+ * the oscillator table and then advanced by a constant rotation, which
+ * lets the compiler vectorise the loop. They are re-anchored on the
+ * table every NCO_ANCHOR samples to keep rounding errors from
+ * accumulating.
+ */
+#define NCO_LANES   8
+#define NCO_ANCHOR  256
+
+NCO::NCO() :
+    oscillatorTable(INPUT_RATE)
+{
+    for (int i = 0; i < INPUT_RATE; i ++)
+        oscillatorTable[i] = DSPCOMPLEX(cos(2.0 * M_PI * i / INPUT_RATE),
+                sin(2.0 * M_PI * i / INPUT_RATE));
 }
 
-void OFDMProcessor::getSamples(DSPCOMPLEX *v, int16_t n, int32_t phase)
+float NCO::mix(DSPCOMPLEX *v, int32_t n, int32_t phase, float *envelope)
 {
-    int32_t     i;
-
-    if (!running)
-        throw NotRunningAnymore();
-    if (n > bufferContent) {
-        bufferContent = input.getSamplesToRead ();
-        while ((bufferContent < n) && running) {
-            if (not input.is_ok()) {
-                throw InputFailure();
+    if (n <= 0)
+        return 0;
+
+    // std::complex guarantees the layout of an array of two floats
+    float *f = reinterpret_cast<float *>(v);
+    float level[NCO_LANES] = {};
+
+    const DSPCOMPLEX step =
+        oscillatorTable[wrapPhase(-(int64_t)NCO_LANES * phase)];
+    const float step_r = real(step);
+    const float step_i = imag(step);
+
+    for (int32_t start = 0; start < n; start += NCO_ANCHOR) {
+        const int32_t end = std::min(n, start + NCO_ANCHOR);
+        float p_r[NCO_LANES];
+        float p_i[NCO_LANES];
+        for (int k = 0; k < NCO_LANES; k++) {
+            const auto& p = oscillatorTable[
+                wrapPhase(localPhase - (int64_t)(start + k + 1) * phase)];
+            p_r[k] = real(p);
+            p_i[k] = imag(p);
+        }
+
+        int32_t i = start;
+        for (; i + NCO_LANES <= end; i += NCO_LANES) {
+            float env[NCO_LANES];
+            for (int k = 0; k < NCO_LANES; k++) {
+                const float x_r = f[2 * (i + k)];
+                const float x_i = f[2 * (i + k) + 1];
+                const float y_r = x_r * p_r[k] - x_i * p_i[k];
+                const float y_i = x_r * p_i[k] + x_i * p_r[k];
+                f[2 * (i + k)] = y_r;
+                f[2 * (i + k) + 1] = y_i;
+                env[k] = std::fabs(y_r) + std::fabs(y_i);
+                level[k] += env[k];
+
+                const float n_r = p_r[k] * step_r - p_i[k] * step_i;
+                p_i[k] = p_r[k] * step_i + p_i[k] * step_r;
+                p_r[k] = n_r;
+            }
+            if (envelope) {
+                std::copy(env, env + NCO_LANES, envelope + i);
+            }
+        }
+
+        for (int k = 0; i < end; i++, k++) {
+            v[i] *= DSPCOMPLEX(p_r[k], p_i[k]);
+            const float env = l1_norm(v[i]);
+            level[k] += env;
+            if (envelope) {
+                envelope[i] = env;
             }
-            std::this_thread::sleep_for(std::chrono::microseconds(10));
-            bufferContent = input.getSamplesToRead();
         }
     }
-    if (!running)
-        throw NotRunningAnymore();
-    //
-    //  so here, bufferContent >= n
-    n = input.getSamples (v, n);
-    bufferContent -= n;
-
-    //  OK, we have samples!!
-    //  first: adjust frequency. We need Hz accuracy
-    for (i = 0; i < n; i ++) {
-        localPhase  -= phase;
-        localPhase   = (localPhase + INPUT_RATE) % INPUT_RATE;
-        v[i]    *= oscillatorTable[localPhase];
-        sLevel   = 0.00001 * l1_norm(v[i]) + (1 - 0.00001) * sLevel;
+
+    localPhase = wrapPhase(localPhase - (int64_t)n * phase);
+
+    float sum = 0;
+    for (int k = 0; k < NCO_LANES; k++) {
+        sum += level[k];
     }
+    return sum;
+}
 
+/**
+ * \brief mixSamples
+ * Shift the frequency of n samples, see NCO::mix().
+ * The long term level sLevel is updated once per block with the
+ * mean L1 norm, which is equivalent to the former per-sample IIR with
+ * the same time constant. If envelope is given, the L1 norm of every
+ * mixed sample is stored into it.
+ */
+#define LEVEL_ALPHA 0.00001
+
+void OFDMProcessor::mixSamples(DSPCOMPLEX *v, int32_t n, int32_t phase,
+        float *envelope)
+{
+    if (n <= 0)
+        return;
+
+    const float sum = nco.mix(v, n, phase, envelope);
+    const float decay = std::pow(1 - LEVEL_ALPHA, n);
+    sLevel = decay * sLevel + (1 - decay) * (sum / n);
+
+#define N   5
     sampleCnt += n;
     if (sampleCnt > INPUT_RATE / N) {
         radioInterface.onFrequencyCorrectorChange(
@@ -223,6 +287,91 @@ void OFDMProcessor::getSamples(DSPCOMPLEX *v, int16_t n, int32_t phase)
     }
 }
 
+/**
+ * \brief getSamples
+ * Get n frequency corrected samples, first from the samples
+ * left over by the null search, then from the input.
+ */
+void OFDMProcessor::getSamples(DSPCOMPLEX *v, int32_t n, int32_t phase,
+        float *envelope)
+{
+    const int32_t fromLookahead = std::min<int32_t>(n,
+            lookahead.size() - lookaheadPos);
+    if (fromLookahead > 0) {
+        std::copy(lookahead.begin() + lookaheadPos,
+                lookahead.begin() + lookaheadPos + fromLookahead, v);
+        if (envelope) {
+            std::copy(lookaheadEnvelope.begin() + lookaheadPos,
+                    lookaheadEnvelope.begin() + lookaheadPos + fromLookahead,
+                    envelope);
+        }
+        lookaheadPos += fromLookahead;
+    }
+
+    const int32_t remaining = n - fromLookahead;
+    if (remaining > 0) {
+        readSamples(v + fromLookahead, remaining);
+        mixSamples(v + fromLookahead, remaining, phase,
+                envelope ? envelope + fromLookahead : nullptr);
+    }
+}
+
+/**
+ * \brief resetMixer
+ * Drop the lookahead, which was mixed for the frequency of a sync that
+ * is gone, and start the NCO over.
+ */
+void OFDMProcessor::resetMixer()
+{
+    lookahead.clear();
+    lookaheadEnvelope.clear();
+    lookaheadPos = 0;
+    nco.reset();
+}
+
+/**
+ * \brief findLevelTransition
+ * Walk along the signal until the sum over the last 50 envelope values
+ * drops below (findDip) or rises above (!findDip) factor * sLevel.
+ * Samples are read and mixed in whole chunks, the ones after the
+ * transition stay in the lookahead buffer for the next getSamples().
+ * Returns false if no transition was found within maxSamples.
+ */
+bool OFDMProcessor::findLevelTransition(bool findDip, float factor,
+        int32_t maxSamples, int32_t phase,
+        float *envBuffer, int32_t envBufferMask,
+        float& currentStrength)
+{
+    const int32_t chunkSize = T_u / 4;
+    int32_t counter = 0;
+
+    auto searching = [&]() {
+        const bool below = currentStrength / 50 < factor * sLevel;
+        return findDip ? not below : below;
+    };
+
+    while (searching()) {
+        if (lookaheadPos == lookahead.size()) {
+            lookahead.resize(chunkSize);
+            lookaheadEnvelope.resize(chunkSize);
+            lookaheadPos = 0;
+            readSamples(lookahead.data(), chunkSize);
+            mixSamples(lookahead.data(), chunkSize, phase,
+                    lookaheadEnvelope.data());
+        }
+
+        envBuffer [syncBufferIndex] = lookaheadEnvelope[lookaheadPos++];
+        //  update the levels
+        currentStrength += envBuffer [syncBufferIndex] -
+            envBuffer [(syncBufferIndex - 50) & envBufferMask];
+        syncBufferIndex = (syncBufferIndex + 1) & envBufferMask;
+        counter ++;
+        if (counter > maxSamples) { // hopeless
+            return false;
+        }
+    }
+    return true;
+}
 
 /***
  *    \brief run
@@ -236,7 +385,6 @@ void OFDMProcessor::run()
 {
     int32_t startIndex;
     int32_t i;
-    int32_t counter;
     float currentStrength;
     constexpr int32_t syncBufferSize  = 32768;
     constexpr int32_t syncBufferMask  = syncBufferSize - 1;
@@ -245,16 +393,21 @@ void OFDMProcessor::run()
     std::vector<DSPCOMPLEX> ofdmBuffer(params.L * params.T_s);
     std::vector<std::vector<DSPCOMPLEX> > allSymbols;
 
+    PROFILE_THREAD_NAME("OFDM processor");
+
+    resetMixer();
+
     try {
 
         //Initing:
         /// first, we need samples to get a reasonable sLevel
         sLevel   = 0;
-        for (i = 0; i < T_F / 2; i ++) {
-            l1_norm(getSample (0));
+        for (i = 0; i < T_F / 2; i += T_s) {
+            getSamples(ofdmBuffer.data(), std::min(T_s, T_F / 2 - i), 0);
         }
 notSynced:
         PROFILE(NotSynced);
+        resetMixer();
         if (scanMode && ++attempts > 5) {
             radioInterface.onSignalPresence(false);
             scanMode  = false;
@@ -266,9 +419,8 @@ notSynced:
         //  read in T_s samples for a next attempt;
         syncBufferIndex = 0;
         currentStrength  = 0;
+        getSamples(ofdmBuffer.data(), 50, 0, envBuffer);
         for (i = 0; i < 50; i ++) {
-            DSPCOMPLEX sample         = getSample (0);
-            envBuffer [syncBufferIndex]   = l1_norm(sample);
             currentStrength           += envBuffer [syncBufferIndex];
             syncBufferIndex ++;
         }
@@ -280,42 +432,23 @@ notSynced:
         /**
          * here we start looking for the null level, i.e. a dip
          */
-        counter  = 0;
         radioInterface.onSyncChange(false);
-        while (currentStrength / 50  > 0.50 * sLevel) {
-            DSPCOMPLEX sample =
-                getSample (coarseCorrector + fineCorrector);
-            envBuffer [syncBufferIndex] = l1_norm(sample);
-            //  update the levels
-            currentStrength += envBuffer [syncBufferIndex] -
-                envBuffer [(syncBufferIndex - 50) & syncBufferMask];
-            syncBufferIndex = (syncBufferIndex + 1) & syncBufferMask;
-            counter ++;
-            if (counter > T_F) { // hopeless
-                //           fprintf (stderr, "%f %f\n", currentStrength / 50, sLevel);
-                goto notSynced;
-            }
+        if (not findLevelTransition(true, 0.50, T_F,
+                    coarseCorrector + fineCorrector,
+                    envBuffer, syncBufferMask, currentStrength)) {
+            goto notSynced;
         }
         /**
          * It seemed we found a dip that started app 65/100 * 50 samples earlier.
          * We now start looking for the end of the null period.
          */
-        counter  = 0;
         //SyncOnEndNull:
         PROFILE(SyncOnEndNull);
-        while (currentStrength / 50 < 0.75 * sLevel) {
-            DSPCOMPLEX sample = getSample (coarseCorrector + fineCorrector);
-            envBuffer [syncBufferIndex] = l1_norm(sample);
-            //  update the levels
-            currentStrength += envBuffer [syncBufferIndex] -
-                envBuffer [(syncBufferIndex - 50) & syncBufferMask];
-            syncBufferIndex = (syncBufferIndex + 1) & syncBufferMask;
-            counter   ++;
-            //
-            if (counter > T_null + 50) { // hopeless
-                std::clog << "ofdm-processor: " << "SyncOnEndNull failed" << std::endl;
-                goto notSynced;
-            }
+        if (not findLevelTransition(false, 0.75, T_null + 50,
+                    coarseCorrector + fineCorrector,
+                    envBuffer, syncBufferMask, currentStrength)) {
+            std::clog << "ofdm-processor: " << "SyncOnEndNull failed" << std::endl;
+            goto notSynced;
         }
         /**
          * The end of the null period is identified, probably about 40
@@ -473,8 +606,6 @@ SyncOnPhase:
          * samples ahead
          * Here we just check the fineCorrector
          */
-        counter  = 0;
-
         if (fineCorrector > params.carrierDiff / 2) {
             coarseCorrector += params.carrierDiff;
             fineCorrector -= params.carrierDiff;
@@ -495,6 +626,9 @@ SyncOnPhase:
     catch (const InputFailure&) {
         std::clog << "OFDM-processor: input not ok, closing down" << std::endl;
         running = false; //Needed before onInputFailure, because subsequent calls will call OFDMProcessor::stop()
+        // A recording decoded faster than real time still has frames
+        // in flight, they must be complete before we report the end
+        ofdmDecoder.flush();
         radioInterface.onInputFailure();
     }
     running = false;
@@ -48,6 +48,29 @@
 #include "fic-handler.h"
 #include "msc-handler.h"
 
+/* The frequency shift of the input samples, a phase accumulator over a
+ * table of INPUT_RATE phasors. Every call continues where the previous
+ * one ended, so that sample i of a call gets the phasor at
+ * localPhase - (i + 1) * phase, exactly as when mixing sample by sample.
+ */
+class NCO
+{
+    public:
+        NCO();
+
+        // Shift the n samples of v by -phase Hz. If envelope is given,
+        // store the L1 norm of every mixed sample into it. Returns the
+        // sum of the L1 norms.
+        float mix(DSPCOMPLEX *v, int32_t n, int32_t phase,
+                float *envelope = nullptr);
+
+        void reset(void) { localPhase = 0; }
+
+    private:
+        std::vector<DSPCOMPLEX> oscillatorTable;
+        int32_t localPhase = 0;
+};
+
 class OFDMProcessor
 {
 // Identifier "interface" is already defined in the w32api header basetype.h
@@ -89,9 +112,7 @@ class OFDMProcessor
         int32_t T_F;
         int32_t coarseSyncCounter = 0;
 
-        std::vector<DSPCOMPLEX> oscillatorTable;
-
-        int32_t localPhase = 0;
+        NCO nco;
 
         float sLevel = 0;
         int32_t sampleCnt = 0;
@@ -112,11 +133,25 @@ class OFDMProcessor
 
         int32_t bufferContent = 0;
 
+        // Samples that were read and mixed during the null search,
+        // but lie after the detected end of the null symbol.
+        std::vector<DSPCOMPLEX> lookahead;
+        std::vector<float> lookaheadEnvelope;
+        size_t lookaheadPos = 0;
+        void resetMixer(void);
+
         fft::Forward fft_handler;
         DSPCOMPLEX *fft_buffer; // of size T_u
 
-        DSPCOMPLEX getSample(int32_t);
-        void getSamples(DSPCOMPLEX *, int16_t, int32_t);
+        void readSamples(DSPCOMPLEX *v, int32_t n);
+        void mixSamples(DSPCOMPLEX *v, int32_t n, int32_t phase,
+                float *envelope = nullptr);
+        void getSamples(DSPCOMPLEX *v, int32_t n, int32_t phase,
+                float *envelope = nullptr);
+        bool findLevelTransition(bool findDip, float factor,
+                int32_t maxSamples, int32_t phase,
+                float *envBuffer, int32_t envBufferMask,
+                float& currentStrength);
         void run(void);
         int16_t processPRS(DSPCOMPLEX *v, const FreqsyncMethod& freqsyncMethod);
         int16_t getMiddle(DSPCOMPLEX *);
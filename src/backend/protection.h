@@ -27,12 +27,13 @@
 #include <cstdint>
 #include "dab-constants.h"
 
-extern uint8_t PI_X[];
+extern const int8_t PI_X[];
 
 class Protection
 {
     public:
         virtual ~Protection() = default;
+        // The output is packed, eight bits per byte
         virtual bool deconvolve(const softbit_t *, int32_t, uint8_t *) = 0;
 };
 #endif
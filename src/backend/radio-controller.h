@@ -108,7 +108,7 @@ class RadioControllerInterface {
 
         virtual void onDateTimeUpdate(const dab_date_time_t& dateTime) = 0;
 
-        /* For every FIB, tell if the CRC check passed. fib points to a bit-vector with 256 bits of FIB data  */
+        /* For every FIB, tell if the CRC check passed. fib points to the 32 bytes of FIB data  */
         virtual void onFIBDecodeSuccess(bool crcCheckOk, const uint8_t* fib) = 0;
 
         /* When a new channel impulse response vector was calculated */
@@ -168,6 +168,23 @@ class ProgrammeHandlerInterface {
          * and effective X-PAD length.
          */
         virtual void onPADLengthError(size_t announced_xpad_len, size_t xpad_len) = 0;
+
+        /* Return false while nobody needs onNewAudio(), to skip the
+         * audio decoding. The PAD is decoded anyway. Asked for every
+         * frame. */
+        virtual bool wantsDecodedAudio(void) { return true; }
+
+        /* Return true to get the audio as broadcast through
+         * onEncodedAudio(). Asked for every frame. */
+        virtual bool wantsEncodedAudio(void) { return false; }
+
+        /* An audio frame as broadcast, without decoding: an MP2 frame
+         * for DAB, or an AAC access unit in a LATM/LOAS frame for DAB+.
+         * extension is "mp2" or "aac", duration_ms the playing time of
+         * the frame. */
+        virtual void onEncodedAudio(const uint8_t *data, size_t len,
+                size_t duration_ms, const std::string& extension) {
+            (void)data; (void)len; (void)duration_ms; (void)extension; }
 };
 
 enum class DeviceParam {
@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 // see OFDMProcessor::processPRS() for more information about these methods
 enum class FreqsyncMethod { GetMiddle = 0, CorrelatePRS = 1, PatternOfZeros = 2 };
 
@@ -82,6 +84,9 @@ struct RadioReceiverOptions {
     // Has no effect when coarse corrector is disabled.
     FreqsyncMethod freqsyncMethod = FreqsyncMethod::PatternOfZeros;
 
-    double audioBufferSeconds;
+    // Number of threads demodulating the OFDM symbols of a frame. More
+    // than one lets multi-core machines with a slow FFT keep up. Only
+    // taken into account when the receiver is created.
+    size_t demodulatorThreads = 1;
 };
 
@@ -131,10 +131,10 @@ bool RadioReceiver::addServiceToDecode(ProgrammeHandlerInterface& handler,
 
 bool RadioReceiver::removeServiceToDecode(const Service& s)
 {
-    const auto comps = ficHandler.fibProcessor.getComponents(s);
-    for (const auto& sc : comps) {
+    const auto snapshot = ficHandler.fibProcessor.getSnapshot();
+    for (const auto& sc : snapshot->getComponents(s)) {
         if (sc.transportMode() == TransportMode::Audio) {
-            const auto& subch = ficHandler.fibProcessor.getSubchannel(sc);
+            const auto& subch = snapshot->getSubchannel(sc);
             if (subch.valid()) {
                 return mscHandler.removeSubchannel(subch);
             }
@@ -146,10 +146,10 @@ bool RadioReceiver::removeServiceToDecode(const Service& s)
 bool RadioReceiver::playProgramme(ProgrammeHandlerInterface& handler,
         const Service& s, const std::string& dumpFileName, bool unique)
 {
-    const auto comps = ficHandler.fibProcessor.getComponents(s);
-    for (const auto& sc : comps) {
+    const auto snapshot = ficHandler.fibProcessor.getSnapshot();
+    for (const auto& sc : snapshot->getComponents(s)) {
         if (sc.transportMode() == TransportMode::Audio) {
-            const auto& subch = ficHandler.fibProcessor.getSubchannel(sc);
+            const auto& subch = snapshot->getSubchannel(sc);
 
             if (subch.valid()) {
                 if (unique) {
@@ -169,6 +169,11 @@ bool RadioReceiver::playProgramme(ProgrammeHandlerInterface& handler,
     return false;
 }
 
+std::shared_ptr<const EnsembleSnapshot> RadioReceiver::getEnsembleSnapshot(void) const
+{
+    return ficHandler.fibProcessor.getSnapshot();
+}
+
 uint16_t RadioReceiver::getEnsembleId(void) const
 {
     return ficHandler.fibProcessor.getEnsembleId();
@@ -189,6 +194,16 @@ std::vector<Service> RadioReceiver::getServiceList(void) const
     return ficHandler.fibProcessor.getServiceList();
 }
 
+void RadioReceiver::loadEnsemble(const EnsembleConfiguration& config)
+{
+    ficHandler.fibProcessor.loadEnsemble(config);
+}
+
+EnsembleConfiguration RadioReceiver::getEnsembleConfiguration(void) const
+{
+    return ficHandler.fibProcessor.getEnsembleConfiguration();
+}
+
 Service RadioReceiver::getService(uint32_t sId) const
 {
     return ficHandler.fibProcessor.getService(sId);
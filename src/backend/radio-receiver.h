@@ -80,11 +80,23 @@ class RadioReceiver {
 
         bool removeServiceToDecode(const Service& s);
 
+        /* Everything known about the ensemble, as one consistent view.
+         * Cheaper than the getters below when several of them are
+         * needed, and its version tells if anything changed. */
+        std::shared_ptr<const EnsembleSnapshot> getEnsembleSnapshot(void) const;
+
         uint16_t getEnsembleId(void) const;
         uint8_t getEnsembleEcc(void) const;
         DabLabel getEnsembleLabel(void) const;
         std::vector<Service> getServiceList(void) const;
 
+        /* Announce the services from a previous visit of the channel
+         * until the FIC confirms them. Call after restart(). */
+        void loadEnsemble(const EnsembleConfiguration& config);
+
+        /* The confirmed part of the ensemble, for the ensemble database */
+        EnsembleConfiguration getEnsembleConfiguration(void) const;
+
         /* Returns a service with sid 0 in case it is missing */
         // TODO use std::optional<Service> once using C++17 makes sense
         Service getService(uint32_t sId) const;
@@ -0,0 +1,250 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "rs-syndromes.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define SYNDROMES_X86
+#  include <immintrin.h>
+#endif
+
+// vqtbl1q_u8 only exists on AArch64
+#if defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#  define SYNDROMES_NEON
+#  include <arm_neon.h>
+#endif
+
+// Codewords handled by one call of a kernel
+static constexpr size_t lanes = 16;
+
+/* Multiplication by alpha^j in GF(2^8) with the field generator
+ * polynomial x^8 + x^4 + x^3 + x^2 + 1 of the DAB+ outer code, the same
+ * init_rs_char(8, 0x11D, 0, 1, 10, 135) uses. As the multiplication is
+ * linear, x * alpha^j = (x & 0x0F) * alpha^j ^ (x & 0xF0) * alpha^j,
+ * which the SIMD kernels look up in two tables of 16 entries. */
+struct GFTables {
+    uint8_t mul[RSSyndromes::numRoots][256];
+    alignas(16) uint8_t low[RSSyndromes::numRoots][lanes];
+    alignas(16) uint8_t high[RSSyndromes::numRoots][lanes];
+
+    GFTables() {
+        for (int x = 0; x < 256; x++) {
+            uint8_t y = x;
+            for (size_t j = 0; j < RSSyndromes::numRoots; j++) {
+                mul[j][x] = y;
+                y = (y << 1) ^ ((y & 0x80) ? 0x1D : 0);
+            }
+        }
+
+        for (size_t j = 0; j < RSSyndromes::numRoots; j++) {
+            for (size_t n = 0; n < 16; n++) {
+                low[j][n] = mul[j][n];
+                high[j][n] = mul[j][n << 4];
+            }
+        }
+    }
+};
+
+static const GFTables& gfTables()
+{
+    static const GFTables tables;
+    return tables;
+}
+
+/* The kernels compute the syndromes of the codewords in the 16 columns
+ * starting at col, with the Horner scheme decode_rs_char uses:
+ * s_j = s_j * alpha^j + r[pos] for pos = 0 .. 119. They return a mask
+ * with bit l set if any syndrome of codeword l is not zero. */
+static uint32_t check_GENERIC(const uint8_t *col, size_t stride)
+{
+    const GFTables& gf = gfTables();
+    uint32_t mask = 0;
+
+    for (size_t l = 0; l < lanes; l++) {
+        uint8_t s[RSSyndromes::numRoots] = {};
+        for (size_t pos = 0; pos < RSSyndromes::codewordLength; pos++) {
+            const uint8_t r = col[pos * stride + l];
+            s[0] ^= r;
+            for (size_t j = 1; j < RSSyndromes::numRoots; j++) {
+                s[j] = gf.mul[j][s[j]] ^ r;
+            }
+        }
+
+        uint8_t any = 0;
+        for (size_t j = 0; j < RSSyndromes::numRoots; j++) {
+            any |= s[j];
+        }
+        if (any) {
+            mask |= 1u << l;
+        }
+    }
+    return mask;
+}
+
+#ifdef SYNDROMES_X86
+__attribute__((target("ssse3")))
+static uint32_t check_SSSE3(const uint8_t *col, size_t stride)
+{
+    const GFTables& gf = gfTables();
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+
+    __m128i s[RSSyndromes::numRoots];
+    for (size_t j = 0; j < RSSyndromes::numRoots; j++) {
+        s[j] = _mm_setzero_si128();
+    }
+
+    for (size_t pos = 0; pos < RSSyndromes::codewordLength; pos++) {
+        const __m128i r = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(col + pos * stride));
+        s[0] = _mm_xor_si128(s[0], r);
+
+        for (size_t j = 1; j < RSSyndromes::numRoots; j++) {
+            const __m128i low = _mm_load_si128(
+                    reinterpret_cast<const __m128i *>(gf.low[j]));
+            const __m128i high = _mm_load_si128(
+                    reinterpret_cast<const __m128i *>(gf.high[j]));
+            const __m128i s_low = _mm_and_si128(s[j], nibble);
+            const __m128i s_high = _mm_and_si128(_mm_srli_epi16(s[j], 4), nibble);
+            s[j] = _mm_xor_si128(r, _mm_xor_si128(
+                        _mm_shuffle_epi8(low, s_low),
+                        _mm_shuffle_epi8(high, s_high)));
+        }
+    }
+
+    __m128i any = s[0];
+    for (size_t j = 1; j < RSSyndromes::numRoots; j++) {
+        any = _mm_or_si128(any, s[j]);
+    }
+    const __m128i zero = _mm_cmpeq_epi8(any, _mm_setzero_si128());
+    return ~_mm_movemask_epi8(zero) & 0xFFFF;
+}
+#endif
+
+#ifdef SYNDROMES_NEON
+static uint32_t check_NEON(const uint8_t *col, size_t stride)
+{
+    const GFTables& gf = gfTables();
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+
+    uint8x16_t s[RSSyndromes::numRoots];
+    for (size_t j = 0; j < RSSyndromes::numRoots; j++) {
+        s[j] = vdupq_n_u8(0);
+    }
+
+    for (size_t pos = 0; pos < RSSyndromes::codewordLength; pos++) {
+        const uint8x16_t r = vld1q_u8(col + pos * stride);
+        s[0] = veorq_u8(s[0], r);
+
+        for (size_t j = 1; j < RSSyndromes::numRoots; j++) {
+            const uint8x16_t low = vld1q_u8(gf.low[j]);
+            const uint8x16_t high = vld1q_u8(gf.high[j]);
+            s[j] = veorq_u8(r, veorq_u8(
+                        vqtbl1q_u8(low, vandq_u8(s[j], nibble)),
+                        vqtbl1q_u8(high, vshrq_n_u8(s[j], 4))));
+        }
+    }
+
+    uint8x16_t any = s[0];
+    for (size_t j = 1; j < RSSyndromes::numRoots; j++) {
+        any = vorrq_u8(any, s[j]);
+    }
+
+    uint8_t any_out[lanes];
+    vst1q_u8(any_out, any);
+
+    uint32_t mask = 0;
+    for (size_t l = 0; l < lanes; l++) {
+        if (any_out[l]) {
+            mask |= 1u << l;
+        }
+    }
+    return mask;
+}
+#endif
+
+RSSyndromes::RSSyndromes(Implementation impl) :
+    impl(dispatch().resolve(impl))
+{
+}
+
+size_t RSSyndromes::check(const uint8_t *sf, size_t num_codewords,
+        uint8_t *has_errors) const
+{
+    auto kernel = check_GENERIC;
+    switch (impl) {
+#ifdef SYNDROMES_X86
+        case Implementation::SSSE3:
+            kernel = check_SSSE3;
+            break;
+#endif
+#ifdef SYNDROMES_NEON
+        case Implementation::NEON:
+            kernel = check_NEON;
+            break;
+#endif
+        default:
+            break;
+    }
+
+    size_t num_errors = 0;
+    for (size_t i = 0; i < num_codewords; i += lanes) {
+        const size_t n = std::min(lanes, num_codewords - i);
+
+        uint32_t mask;
+        if (n == lanes) {
+            mask = kernel(sf + i, num_codewords);
+        }
+        else {
+            // The kernels always read 16 columns, the last row of the
+            // superframe does not have them
+            uint8_t tail[codewordLength * lanes] = {};
+            for (size_t pos = 0; pos < codewordLength; pos++) {
+                memcpy(tail + pos * lanes, sf + pos * num_codewords + i, n);
+            }
+            mask = kernel(tail, lanes);
+        }
+
+        for (size_t l = 0; l < n; l++) {
+            has_errors[i + l] = (mask >> l) & 1;
+            num_errors += has_errors[i + l];
+        }
+    }
+    return num_errors;
+}
+
+const CPUDispatch& RSSyndromes::dispatch()
+{
+    static const CPUDispatch d({
+#ifdef SYNDROMES_X86
+            Implementation::SSSE3,
+#endif
+#ifdef SYNDROMES_NEON
+            Implementation::NEON,
+#endif
+            });
+    return d;
+}
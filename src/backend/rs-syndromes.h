@@ -0,0 +1,66 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef __RS_SYNDROMES
+#define __RS_SYNDROMES
+
+#include <cstddef>
+#include <cstdint>
+#include "cpudispatch.h"
+
+/* Syndromes of the RS(120, 110) codewords of a DAB+ superframe, see
+ * ETSI TS 102 563 clause 6.
+ *
+ * The codewords are interleaved: byte pos of codeword i is at
+ * sf[pos * N + i] for N codewords. The same byte of all codewords thus
+ * lies side by side, and the syndromes of 16 codewords are computed at
+ * once. Only the codewords with a syndrome other than zero need the
+ * full decoder, which on a clean signal is none of them.
+ */
+class RSSyndromes
+{
+    public:
+        // SSSE3 and NEON, besides Generic
+        using Implementation = CPUImplementation;
+
+        static constexpr size_t codewordLength = 120;
+        static constexpr size_t numRoots = 10;
+
+        RSSyndromes(Implementation impl = Implementation::Auto);
+
+        // Set has_errors[i] to 1 if codeword i of the num_codewords in sf
+        // has any syndrome other than zero, and to 0 otherwise. Returns
+        // the number of codewords with errors.
+        size_t check(const uint8_t *sf, size_t num_codewords,
+                uint8_t *has_errors) const;
+
+        Implementation implementation(void) const { return impl; }
+
+        static const CPUDispatch& dispatch(void);
+
+    private:
+        Implementation impl;
+};
+
+#endif
@@ -20,6 +20,7 @@
 #define SUBCHANNEL_SINK_H_
 
 #include <stdint.h>
+#include <atomic>
 #include <mutex>
 #include <set>
 #include <string>
@@ -75,6 +76,9 @@ protected:
 	std::mutex uscs_mutex;
 	std::set<UntouchedStreamConsumer*> uscs;
 
+	// may be changed from any thread - the decoder picks it up with the next frame
+	std::atomic<bool> decode_audio_requested;
+
 	void ForwardUntouchedStream(const uint8_t *data, size_t len, size_t duration_ms) {
 		// mutex must already be locked!
 		for(UntouchedStreamConsumer* usc : uscs)
@@ -82,7 +86,7 @@ protected:
 	}
 public:
 	SubchannelSink(SubchannelSinkObserver* observer, std::string untouched_stream_file_extension) :
-		observer(observer), untouched_stream_file_extension(untouched_stream_file_extension) {}
+		observer(observer), untouched_stream_file_extension(untouched_stream_file_extension), decode_audio_requested(true) {}
 	virtual ~SubchannelSink() {}
 
 	virtual void Feed(const uint8_t *data, size_t len) = 0;
@@ -95,6 +99,8 @@ public:
 		std::lock_guard<std::mutex> lock(uscs_mutex);
 		uscs.erase(consumer);
 	}
+	// skip the audio decoding (but not the PAD), e.g. if only the untouched stream is needed
+	void SetDecodeAudio(bool decode_audio) {decode_audio_requested = decode_audio;}
 };
 
 #endif /* SUBCHANNEL_SINK_H_ */
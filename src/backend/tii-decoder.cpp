@@ -20,13 +20,14 @@
  */
 #include <array>
 #include <algorithm>
+#include <bitset>
 #include <stdexcept>
 #include <iostream>
 #include "tii-decoder.h"
 
 using namespace std;
 
-static const int tii_pattern[70][8] = { // {{{
+static constexpr int tii_pattern[70][8] = { // {{{
     {0,0,0,0,1,1,1,1},
     {0,0,0,1,0,1,1,1},
     {0,0,0,1,1,0,1,1},
@@ -98,6 +99,33 @@ static const int tii_pattern[70][8] = { // {{{
     {1,1,1,0,1,0,0,0},
     {1,1,1,1,0,0,0,0} }; // }}}
 
+// The carrier pairs of comb c are 1 + 2c + 48b for b from 0 to 7, and
+// the pattern selects four of these eight groups. Patterns are kept
+// as bitsets of the selected groups, built at compile time.
+static constexpr int num_combs = 24;
+static constexpr int num_patterns = 70;
+static constexpr int num_groups = 8;
+
+struct PatternGroups {
+    uint8_t groups[num_patterns];
+
+    constexpr PatternGroups() : groups() {
+        for (int p = 0; p < num_patterns; p++) {
+            for (int b = 0; b < num_groups; b++) {
+                if (tii_pattern[p][b]) {
+                    groups[p] |= (1 << b);
+                }
+            }
+        }
+    }
+};
+
+static constexpr PatternGroups pattern_groups;
+
+// Range of delays in samples we look for, relative to the main signal
+static const int min_delay = -4;
+static const int max_delay = 500;
+
 bool operator==(const CombPattern& lhs, const CombPattern& rhs)
 {
     return lhs.comb == rhs.comb and lhs.pattern == rhs.pattern;
@@ -108,18 +136,17 @@ std::vector<carrier_t> CombPattern::generateCarriers() const
     std::vector<carrier_t> carriers;
     carriers.reserve(32);
 
-    for (carrier_t k = 0; k < 384; k++) {
-        for (int b = 0; b < 8; b++) {
-            if (k == 1 + 2*comb + 48*b and tii_pattern[pattern][b]) {
-                carriers.push_back(k - 769);
-                carriers.push_back(k - 769 + 1);
-                carriers.push_back(k - 385);
-                carriers.push_back(k - 385 + 1);
-                carriers.push_back(k);
-                carriers.push_back(k + 1);
-                carriers.push_back(k + 384);
-                carriers.push_back(k + 384 + 1);
-            }
+    for (int b = 0; b < num_groups; b++) {
+        if (pattern_groups.groups[pattern] & (1 << b)) {
+            const carrier_t k = 1 + 2*comb + 48*b;
+            carriers.push_back(k - 769);
+            carriers.push_back(k - 769 + 1);
+            carriers.push_back(k - 385);
+            carriers.push_back(k - 385 + 1);
+            carriers.push_back(k);
+            carriers.push_back(k + 1);
+            carriers.push_back(k + 384);
+            carriers.push_back(k + 384 + 1);
         }
     }
 
@@ -138,25 +165,14 @@ TIIDecoder::TIIDecoder(const DABParams& params, RadioControllerInterface& ri) :
     m_radioInterface(ri),
     m_params(params),
     m_fft_null(params.T_u),
-    m_fft_prs(params.T_u)
+    m_fft_prs(params.T_u),
+    m_ifft_delay(params.T_u)
 {
     if (m_params.dabMode != 1) {
         clog << "TII decoder does not support mode " << m_params.dabMode << endl;
         return;
     }
 
-    for (int c = 0; c < 24; c++) {
-        for (int p = 0; p < 70; p++) {
-            for (carrier_t k = 0; k < 384; k++) {
-                for (int b = 0; b < 8; b++) {
-                    if (k == 1 + 2*c + 48*b and tii_pattern[p][b]) {
-                        m_cp_per_carrier[k].emplace(c, p);
-                    }
-                }
-            }
-        }
-    }
-
     m_thread = thread(&TIIDecoder::run, this);
 }
 
@@ -285,29 +301,35 @@ void TIIDecoder::run()
             }
         }
 
-        unordered_map<CombPattern, int> cp_count;
+        // Every detected carrier pair belongs to one group of one comb
+        array<bitset<num_groups>, num_combs> groups_per_comb;
         for (const carrier_t k : carriers) {
-            if (m_cp_per_carrier.count(k)) {
-                for (const auto& cps : m_cp_per_carrier[k]) {
-                    cp_count[cps]++;
-                }
-            }
+            const int comb = ((k - 1) % 48) / 2;
+            const int group = (k - 1) / 48;
+            groups_per_comb[comb].set(group);
         }
 
-        size_t num_likely_cps = 0;
-        for (const auto& cp : cp_count) {
-            if (cp.second >= 4) {
-                num_likely_cps++;
+        // A comb/pattern is likely present if at least four of its
+        // groups were detected
+        vector<CombPattern> likely_cps;
+        for (int c = 0; c < num_combs; c++) {
+            if (groups_per_comb[c].count() < 4) {
+                continue;
+            }
+
+            for (int p = 0; p < num_patterns; p++) {
+                const bitset<num_groups> pattern(pattern_groups.groups[p]);
+                if ((groups_per_comb[c] & pattern).count() >= 4) {
+                    likely_cps.emplace_back(c, p);
+                }
             }
         }
 
         // Sometimes the number of likely CPs is huge because
         // the threshold is wrong. Skip these cases.
-        if (num_likely_cps < 10) {
-            for (const auto& cp : cp_count) {
-                if (cp.second >= 4) {
-                    analyse_phase(cp.first);
-                }
+        if (likely_cps.size() < 10) {
+            for (const auto& cp : likely_cps) {
+                analyse_phase(cp);
             }
         }
 
@@ -324,61 +346,88 @@ void TIIDecoder::analyse_phase(const CombPattern& cp)
     const complexf *n = m_fft_null.getVector();
     const complexf *p = m_fft_prs.getVector();
 
-    auto k_to_ix = [](carrier_t k) -> int {
+    const int fft_size = m_params.T_u;
+    auto k_to_ix = [fft_size](carrier_t k) -> int {
         if (k < 0)
-            return 2048 + k;
+            return fft_size + k;
         else
             return k; };
 
+    auto& meas = m_error_per_correction[cp];
+    if (meas.correlation_per_delay.empty()) {
+        meas.correlation_per_delay.resize(max_delay - min_delay);
+    }
+
+    // A delay d rotates carrier k by exp(-2j pi d k / N) in the null symbol
+    // with respect to the PRS. Instead of trying every delay, we put the
+    // phase difference of each carrier into its bin and get the
+    // correlation with all delays from one inverse FFT:
+    //   x[d] = sum_k exp(j (arg(null_k) - arg(prs_k))) exp(2j pi d k / N)
+    // The real part is the sum of the cosines of the remaining phase
+    // errors, which is largest at the delay that lines them up best.
+    complexf *x = m_ifft_delay.getVector();
+    fill(x, x + fft_size, complexf(0, 0));
+
+    vector<carrier_phase_t> carrier_phases(carriers.size());
+
     // Both TII carriers take the phase from the first PRS frequency of the pair.
     // This assumes carriers is sorted.
-    vector<float> phases_prs(carriers.size());
-
     for (size_t i = 0; i < carriers.size(); i += 2) {
-        const int ix = k_to_ix(carriers[i]);
+        const complexf prs = p[k_to_ix(carriers[i])];
+        const float prs_phase = arg(prs);
+        const complexf prs_unit = (prs == complexf(0, 0)) ?
+            complexf(0, 0) : conj(prs) / abs(prs);
 
-        phases_prs[i] = arg(p[ix]);
-        phases_prs[i+1] = arg(p[ix]);
+        for (size_t j = i; j < i + 2; j++) {
+            const int ix = k_to_ix(carriers[j]);
+            const float null_mag = abs(n[ix]);
+            if (null_mag > 0) {
+                x[ix] = n[ix] / null_mag * prs_unit;
+            }
+            carrier_phases[j] = {carriers[j], n[ix], prs_phase};
+        }
     }
 
-    auto& meas = m_error_per_correction[cp];
-
-    for (int err = -4; err < 500; err++) {
-        float abs_err = 0;
+    m_ifft_delay.do_IFFT();
 
-        for (size_t j = 0; j < carriers.size(); j++) {
-            const int ix = k_to_ix(carriers[j]);
-            constexpr float pi = M_PI;
-            complexf rotator = polar(1.0f, 2.0f * pi * err * carriers[j] / 2048.0f);
-            float delta = arg(n[ix] * rotator) - phases_prs[j];
-            abs_err += abs(delta);
-        }
-        meas.error_per_correction[err] += abs_err;
+    for (int d = min_delay; d < max_delay; d++) {
+        const int ix = (d < 0) ? fft_size + d : d;
+        meas.correlation_per_delay[d - min_delay] += x[ix].real();
     }
 
+    meas.carriers.push_back(move(carrier_phases));
     meas.num_measurements++;
 
     if (meas.num_measurements >= 5) {
-        auto best = min_element(
-                meas.error_per_correction.begin(),
-                meas.error_per_correction.end(),
-                [](const pair<float, int>& lhs,
-                    const pair<float, int>& rhs) {
-                return lhs.second < rhs.second;
-                });
-
-        if (best != meas.error_per_correction.end()) {
-            tii_measurement_t m;
-            m.error = best->second;
-            m.delay_samples = best->first;
-            m.comb = cp.comb;
-            m.pattern = cp.pattern;
-
-            m_radioInterface.onTIIMeasurement(move(m));
+        auto best = max_element(
+                meas.correlation_per_delay.begin(),
+                meas.correlation_per_delay.end());
+        const int delay = min_delay +
+            distance(meas.correlation_per_delay.begin(), best);
+
+        // Report the same sum of absolute phase errors as a search over all
+        // delays would have found, but only for the best one
+        float error = 0;
+        for (const auto& carrier_phases : meas.carriers) {
+            for (const auto& c : carrier_phases) {
+                constexpr float pi = M_PI;
+                complexf rotator = polar(1.0f, 2.0f * pi * delay * c.k / (float)fft_size);
+                float delta = arg(c.null * rotator) - c.prs_phase;
+                error += abs(delta);
+            }
         }
 
-        meas.error_per_correction.clear();
+        tii_measurement_t m;
+        m.error = error;
+        m.delay_samples = delay;
+        m.comb = cp.comb;
+        m.pattern = cp.pattern;
+
+        m_radioInterface.onTIIMeasurement(move(m));
+
+        fill(meas.correlation_per_delay.begin(),
+                meas.correlation_per_delay.end(), 0.0f);
+        meas.carriers.clear();
         meas.num_measurements = 0;
     }
 }
-
@@ -21,7 +21,6 @@
 #include <cstddef>
 #include "dab-constants.h"
 #include <unordered_map>
-#include <unordered_set>
 #include <list>
 #include <vector>
 #include <mutex>
@@ -82,9 +81,6 @@ class TIIDecoder {
         std::vector<complexf> m_null;
         std::vector<complexf> m_prs;
 
-        std::unordered_map<carrier_t, std::unordered_set<CombPattern> >
-            m_cp_per_carrier;
-
         enum class State { Idle, NullPrsReady, Abort };
 
         std::thread m_thread;
@@ -95,8 +91,23 @@ class TIIDecoder {
         fft::Forward m_fft_null;
         fft::Forward m_fft_prs;
 
+        // Correlates the TII carriers against all delays at once
+        fft::Backward m_ifft_delay;
+
+        struct carrier_phase_t {
+            carrier_t k;
+            complexf null;
+            float prs_phase;
+        };
+
         struct cp_error_measurement_t {
-            std::unordered_map<float, uint64_t> error_per_correction;
+            // Sum over the measurements of the cosine of the phase error,
+            // from min_delay onwards
+            std::vector<float> correlation_per_delay;
+
+            // The carriers of every measurement, to calculate the phase
+            // error at the best delay
+            std::vector<std::vector<carrier_phase_t> > carriers;
             size_t num_measurements = 0;
         };
 
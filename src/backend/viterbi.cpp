@@ -20,6 +20,8 @@
  */
 #include    <stdio.h>
 #include    <stdlib.h>
+#include    <algorithm>
+#include    <stdexcept>
 #include    "viterbi.h"
 #include    <cstring>
 
@@ -29,6 +31,16 @@
 #  include <windows.h>
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define VITERBI_X86
+#  include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define VITERBI_NEON
+#  include <arm_neon.h>
+#endif
+
 //  It took a while to discover that the polynomes we used
 //  in our own "straightforward" implementation was bitreversed!!
 //  The official one is on top.
@@ -119,11 +131,260 @@ void renormalize(COMPUTETYPE* X, COMPUTETYPE threshold)
     }
 }
 
+/* The SIMD variants below compute exactly the same butterflies as
+ * BFLY() and update_viterbi_blk_GENERIC(), only several states at a
+ * time. The renormalisation keeps the path metrics well below 2^15,
+ * which allows us to use the signed 16-bit compare and min instructions
+ * on the unsigned COMPUTETYPE metrics.
+ *
+ * Branchtab[j * NUMSTATES/2 + i] holds the expected symbol j of butterfly
+ * i, so each row of the table maps onto contiguous vectors.
+ */
+#ifdef VITERBI_X86
+__attribute__((target("sse2")))
+static void update_viterbi_blk_SSE2(
+        struct v *vp,
+        const COMPUTETYPE *Branchtab,
+        const COMPUTETYPE *syms,
+        int16_t nbits)
+{
+    decision_t *d = vp->decisions;
+    const __m128i *bt = (const __m128i *)Branchtab;
+    const __m128i max = _mm_set1_epi16(RATE * 255);
+
+    for (int32_t s = 0; s < nbits; s++) {
+        const __m128i *old_m = (const __m128i *)vp->old_metrics->t;
+        __m128i *new_m = (__m128i *)vp->new_metrics->t;
+        const __m128i sym0 = _mm_set1_epi16(syms[s * RATE + 0]);
+        const __m128i sym1 = _mm_set1_epi16(syms[s * RATE + 1]);
+        const __m128i sym2 = _mm_set1_epi16(syms[s * RATE + 2]);
+        const __m128i sym3 = _mm_set1_epi16(syms[s * RATE + 3]);
+        uint32_t mask[4];
+
+        // Four groups of eight butterflies
+        for (int g = 0; g < 4; g++) {
+            __m128i metric = _mm_xor_si128(_mm_load_si128(&bt[g]), sym0);
+            metric = _mm_add_epi16(metric, _mm_xor_si128(_mm_load_si128(&bt[4 + g]), sym1));
+            metric = _mm_add_epi16(metric, _mm_xor_si128(_mm_load_si128(&bt[8 + g]), sym2));
+            metric = _mm_add_epi16(metric, _mm_xor_si128(_mm_load_si128(&bt[12 + g]), sym3));
+            const __m128i m_metric = _mm_sub_epi16(max, metric);
+
+            const __m128i a = _mm_load_si128(&old_m[g]);
+            const __m128i b = _mm_load_si128(&old_m[4 + g]);
+            const __m128i m0 = _mm_add_epi16(a, metric);
+            const __m128i m1 = _mm_add_epi16(b, m_metric);
+            const __m128i m2 = _mm_add_epi16(a, m_metric);
+            const __m128i m3 = _mm_add_epi16(b, metric);
+
+            const __m128i d0 = _mm_cmpgt_epi16(m0, m1);
+            const __m128i d1 = _mm_cmpgt_epi16(m2, m3);
+            const __m128i s0 = _mm_min_epi16(m0, m1);
+            const __m128i s1 = _mm_min_epi16(m2, m3);
+
+            // New states 2i and 2i+1 are interleaved
+            _mm_store_si128(&new_m[2 * g], _mm_unpacklo_epi16(s0, s1));
+            _mm_store_si128(&new_m[2 * g + 1], _mm_unpackhi_epi16(s0, s1));
+
+            const __m128i dec = _mm_packs_epi16(
+                    _mm_unpacklo_epi16(d0, d1),
+                    _mm_unpackhi_epi16(d0, d1));
+            mask[g] = (uint32_t)_mm_movemask_epi8(dec);
+        }
+
+        d[s].w[0] = mask[0] | (mask[1] << 16);
+        d[s].w[1] = mask[2] | (mask[3] << 16);
+
+        if (vp->new_metrics->t[0] > RENORMALIZE_THRESHOLD) {
+            __m128i min = new_m[0];
+            for (int k = 1; k < NUMSTATES / 8; k++) {
+                min = _mm_min_epi16(min, new_m[k]);
+            }
+            min = _mm_min_epi16(min, _mm_srli_si128(min, 8));
+            min = _mm_min_epi16(min, _mm_srli_si128(min, 4));
+            min = _mm_min_epi16(min, _mm_srli_si128(min, 2));
+            min = _mm_set1_epi16(_mm_extract_epi16(min, 0));
+            for (int k = 0; k < NUMSTATES / 8; k++) {
+                new_m[k] = _mm_sub_epi16(new_m[k], min);
+            }
+        }
+
+        metric_t *tmp = vp->old_metrics;
+        vp->old_metrics = vp->new_metrics;
+        vp->new_metrics = tmp;
+    }
+}
+
+__attribute__((target("avx2")))
+static void update_viterbi_blk_AVX2(
+        struct v *vp,
+        const COMPUTETYPE *Branchtab,
+        const COMPUTETYPE *syms,
+        int16_t nbits)
+{
+    decision_t *d = vp->decisions;
+    const __m256i max = _mm256_set1_epi16(RATE * 255);
+
+    for (int32_t s = 0; s < nbits; s++) {
+        const COMPUTETYPE *old_m = vp->old_metrics->t;
+        COMPUTETYPE *new_m = vp->new_metrics->t;
+        const __m256i sym0 = _mm256_set1_epi16(syms[s * RATE + 0]);
+        const __m256i sym1 = _mm256_set1_epi16(syms[s * RATE + 1]);
+        const __m256i sym2 = _mm256_set1_epi16(syms[s * RATE + 2]);
+        const __m256i sym3 = _mm256_set1_epi16(syms[s * RATE + 3]);
+
+        // Two groups of sixteen butterflies
+        for (int g = 0; g < 2; g++) {
+            const COMPUTETYPE *bt = Branchtab + 16 * g;
+            __m256i metric = _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)(bt)), sym0);
+            metric = _mm256_add_epi16(metric, _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)(bt + NUMSTATES / 2)), sym1));
+            metric = _mm256_add_epi16(metric, _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)(bt + NUMSTATES)), sym2));
+            metric = _mm256_add_epi16(metric, _mm256_xor_si256(
+                    _mm256_loadu_si256((const __m256i *)(bt + 3 * NUMSTATES / 2)), sym3));
+            const __m256i m_metric = _mm256_sub_epi16(max, metric);
+
+            const __m256i a = _mm256_loadu_si256((const __m256i *)(old_m + 16 * g));
+            const __m256i b = _mm256_loadu_si256((const __m256i *)(old_m + NUMSTATES / 2 + 16 * g));
+            const __m256i m0 = _mm256_add_epi16(a, metric);
+            const __m256i m1 = _mm256_add_epi16(b, m_metric);
+            const __m256i m2 = _mm256_add_epi16(a, m_metric);
+            const __m256i m3 = _mm256_add_epi16(b, metric);
+
+            const __m256i d0 = _mm256_cmpgt_epi16(m0, m1);
+            const __m256i d1 = _mm256_cmpgt_epi16(m2, m3);
+            const __m256i s0 = _mm256_min_epi16(m0, m1);
+            const __m256i s1 = _mm256_min_epi16(m2, m3);
+
+            // unpack works within 128-bit lanes, the permutes restore
+            // the state order
+            const __m256i lo = _mm256_unpacklo_epi16(s0, s1);
+            const __m256i hi = _mm256_unpackhi_epi16(s0, s1);
+            _mm256_storeu_si256((__m256i *)(new_m + 32 * g),
+                    _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)(new_m + 32 * g + 16),
+                    _mm256_permute2x128_si256(lo, hi, 0x31));
+
+            // ... whereas the lane-wise pack puts the decisions
+            // back in order by itself
+            const __m256i dec = _mm256_packs_epi16(
+                    _mm256_unpacklo_epi16(d0, d1),
+                    _mm256_unpackhi_epi16(d0, d1));
+            d[s].w[g] = (uint32_t)_mm256_movemask_epi8(dec);
+        }
+
+        if (new_m[0] > RENORMALIZE_THRESHOLD) {
+            __m256i *nm = (__m256i *)new_m;
+            __m256i min256 = _mm256_loadu_si256(&nm[0]);
+            for (int k = 1; k < NUMSTATES / 16; k++) {
+                min256 = _mm256_min_epi16(min256, _mm256_loadu_si256(&nm[k]));
+            }
+            __m128i min = _mm_min_epi16(
+                    _mm256_castsi256_si128(min256),
+                    _mm256_extracti128_si256(min256, 1));
+            min = _mm_min_epi16(min, _mm_srli_si128(min, 8));
+            min = _mm_min_epi16(min, _mm_srli_si128(min, 4));
+            min = _mm_min_epi16(min, _mm_srli_si128(min, 2));
+            min256 = _mm256_set1_epi16(_mm_extract_epi16(min, 0));
+            for (int k = 0; k < NUMSTATES / 16; k++) {
+                _mm256_storeu_si256(&nm[k], _mm256_sub_epi16(
+                            _mm256_loadu_si256(&nm[k]), min256));
+            }
+        }
+
+        metric_t *tmp = vp->old_metrics;
+        vp->old_metrics = vp->new_metrics;
+        vp->new_metrics = tmp;
+    }
+}
+#endif
+
+#ifdef VITERBI_NEON
+static void update_viterbi_blk_NEON(
+        struct v *vp,
+        const COMPUTETYPE *Branchtab,
+        const COMPUTETYPE *syms,
+        int16_t nbits)
+{
+    static const uint8_t bitweights[16] =
+        { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t weights = vld1q_u8(bitweights);
+    const int16_t *bt = (const int16_t *)Branchtab;
+    decision_t *d = vp->decisions;
+    const int16x8_t max = vdupq_n_s16(RATE * 255);
+
+    for (int32_t s = 0; s < nbits; s++) {
+        const int16_t *old_m = (const int16_t *)vp->old_metrics->t;
+        int16_t *new_m = (int16_t *)vp->new_metrics->t;
+        const int16x8_t sym0 = vdupq_n_s16(syms[s * RATE + 0]);
+        const int16x8_t sym1 = vdupq_n_s16(syms[s * RATE + 1]);
+        const int16x8_t sym2 = vdupq_n_s16(syms[s * RATE + 2]);
+        const int16x8_t sym3 = vdupq_n_s16(syms[s * RATE + 3]);
+        uint32_t mask[4];
+
+        // Four groups of eight butterflies
+        for (int g = 0; g < 4; g++) {
+            int16x8_t metric = veorq_s16(vld1q_s16(bt + 8 * g), sym0);
+            metric = vaddq_s16(metric, veorq_s16(vld1q_s16(bt + NUMSTATES / 2 + 8 * g), sym1));
+            metric = vaddq_s16(metric, veorq_s16(vld1q_s16(bt + NUMSTATES + 8 * g), sym2));
+            metric = vaddq_s16(metric, veorq_s16(vld1q_s16(bt + 3 * NUMSTATES / 2 + 8 * g), sym3));
+            const int16x8_t m_metric = vsubq_s16(max, metric);
+
+            const int16x8_t a = vld1q_s16(old_m + 8 * g);
+            const int16x8_t b = vld1q_s16(old_m + NUMSTATES / 2 + 8 * g);
+            const int16x8_t m0 = vaddq_s16(a, metric);
+            const int16x8_t m1 = vaddq_s16(b, m_metric);
+            const int16x8_t m2 = vaddq_s16(a, m_metric);
+            const int16x8_t m3 = vaddq_s16(b, metric);
+
+            const uint16x8_t d0 = vcgtq_s16(m0, m1);
+            const uint16x8_t d1 = vcgtq_s16(m2, m3);
+
+            const int16x8x2_t surv = vzipq_s16(vminq_s16(m0, m1), vminq_s16(m2, m3));
+            vst1q_s16(new_m + 16 * g, surv.val[0]);
+            vst1q_s16(new_m + 16 * g + 8, surv.val[1]);
+
+            // There is no movemask on NEON, add up the weighted bits instead
+            const uint16x8x2_t dz = vzipq_u16(d0, d1);
+            const uint8x16_t dec = vandq_u8(weights,
+                    vcombine_u8(vmovn_u16(dz.val[0]), vmovn_u16(dz.val[1])));
+            uint8x8_t p = vpadd_u8(vget_low_u8(dec), vget_high_u8(dec));
+            p = vpadd_u8(p, p);
+            p = vpadd_u8(p, p);
+            mask[g] = vget_lane_u8(p, 0) | (vget_lane_u8(p, 1) << 8);
+        }
+
+        d[s].w[0] = mask[0] | (mask[1] << 16);
+        d[s].w[1] = mask[2] | (mask[3] << 16);
+
+        if (vp->new_metrics->t[0] > RENORMALIZE_THRESHOLD) {
+            int16x8_t min8 = vld1q_s16(new_m);
+            for (int k = 1; k < NUMSTATES / 8; k++) {
+                min8 = vminq_s16(min8, vld1q_s16(new_m + 8 * k));
+            }
+            int16x4_t min = vmin_s16(vget_low_s16(min8), vget_high_s16(min8));
+            min = vpmin_s16(min, min);
+            min = vpmin_s16(min, min);
+            min8 = vdupq_lane_s16(min, 0);
+            for (int k = 0; k < NUMSTATES / 8; k++) {
+                vst1q_s16(new_m + 8 * k, vsubq_s16(vld1q_s16(new_m + 8 * k), min8));
+            }
+        }
+
+        metric_t *tmp = vp->old_metrics;
+        vp->old_metrics = vp->new_metrics;
+        vp->new_metrics = tmp;
+    }
+}
+#endif
+
 //  The main use of the viterbi decoder is in handling the FIC blocks
 //  There are (in mode 1) 3 ofdm blocks, giving 4 FIC blocks
 //  There all have a predefined length. In that case we use the
 //  "fast" (i.e. spiral) code, otherwise we use the generic code
-Viterbi::Viterbi(int16_t wordlength)
+Viterbi::Viterbi(int16_t wordlength, Implementation impl) :
+    impl(impl)
 {
     int polys[RATE] = POLYS;
     int16_t i, state;
@@ -139,19 +400,13 @@ Viterbi::Viterbi(int16_t wordlength)
     // By doubling the size, the problem disappears. It is not solved though
     // and not further investigation.
 #ifdef __MINGW32__
-    size    = 2 * ((wordlength + (K - 1)) / 8 + 1 + 16) & ~0xF;
-    data    = (uint8_t *)_aligned_malloc (size, 16);
     size    = 2 * (RATE * (wordlength + (K - 1)) * sizeof(COMPUTETYPE) + 16) & ~0xF;
     symbols = (COMPUTETYPE *)_aligned_malloc (size, 16);
     size    = 2 * (wordlength + (K - 1)) * sizeof (decision_t);
     size    = (size + 16) & ~0xF;
     vp. decisions = (decision_t  *)_aligned_malloc (size, DECISIONALIGN);
 #else
-    if (posix_memalign ((void**)&data, 16,
-                (wordlength + (K - 1))/ 8 + 1)){
-        printf("Allocation of data array failed\n");
-    }
-        if (posix_memalign ((void**)&symbols, 16,
+    if (posix_memalign ((void**)&symbols, 16,
                 RATE * (wordlength + (K - 1)) * sizeof(COMPUTETYPE))){
         printf("Allocation of symbols array failed\n");
     }
@@ -170,6 +425,8 @@ Viterbi::Viterbi(int16_t wordlength)
         }
     }
 
+    this->impl = dispatch().resolve(impl);
+
     init_viterbi (&vp, 0);
 }
 
@@ -178,29 +435,13 @@ Viterbi::~Viterbi()
 {
 #ifdef  __MINGW32__
     _aligned_free (vp. decisions);
-    _aligned_free (data);
     _aligned_free (symbols);
 #else
     free (vp. decisions);
-    free (data);
     free (symbols);
 #endif
 }
 
-static int maskTable[] = {128, 64, 32, 16, 8, 4, 2, 1};
-
-static inline
-uint8_t getbit (uint8_t v, int32_t o)
-{
-    return  (v & maskTable[o]) ? 1 : 0;
-}
-
-//static
-//uint8_t getbit (uint8_t v, int32_t o) {
-//uint8_t   mask    = 1 << (7 - o);
-//  return  (v & mask) ? 1 : 0;
-//}
-
 // depends: POLYS, RATE, COMPUTETYPE
 //  encode was only used for testing purposes
 //void encode (/*const*/ unsigned char *bytes, COMPUTETYPE *symbols, int nbits) {
@@ -224,24 +465,80 @@ uint8_t getbit (uint8_t v, int32_t o)
 //  Note that our DAB environment maps the softbits to -127 .. 127
 //  we have to map that onto 0 .. 255
 
+static inline COMPUTETYPE toSymbol(softbit_t s)
+{
+    int16_t temp = ((int16_t)s) + 127;
+    if (temp < 0) temp = 0;
+    if (temp > 255) temp = 255;
+    return temp;
+}
+
 void Viterbi::deconvolve(softbit_t *input, uint8_t *output)
 {
     uint32_t    i;
 
-    init_viterbi (&vp, 0);
     for (i = 0; i < (uint16_t)(frameBits + (K - 1)) * RATE; i ++) {
-        int16_t temp = ((int16_t)input[i]) + 127;
-        if (temp < 0) temp = 0;
-        if (temp > 255) temp = 255;
-        symbols[i] = temp;
+        symbols[i] = toSymbol(input[i]);
     }
 
-    update_viterbi_blk_GENERIC (&vp, symbols, frameBits + (K - 1));
+    decodeSymbols(output);
+}
 
-    chainback_viterbi (&vp, data, frameBits, 0);
+void Viterbi::appendPuncturing(int32_t numBits, const int8_t *pi,
+        int16_t piLength)
+{
+    if (puncturingLength + numBits > (frameBits + (K - 1)) * RATE) {
+        throw std::logic_error("Viterbi: puncturing longer than the block");
+    }
 
-    for (i = 0; i < (uint16_t)frameBits; i ++)
-        output[i] = getbit (data[i >> 3], i & 07);
+    for (int32_t i = 0; i < numBits; i++) {
+        if (pi[i % piLength] != 0) {
+            puncturing.push_back(puncturingLength);
+        }
+        puncturingLength++;
+    }
+}
+
+void Viterbi::deconvolvePunctured(const softbit_t *input, uint8_t *output)
+{
+    // Punctured bits are erasures, i.e. soft bit 0
+    std::fill(symbols, symbols + (frameBits + (K - 1)) * RATE, toSymbol(0));
+
+    const size_t n = puncturing.size();
+    const uint32_t *positions = puncturing.data();
+    for (size_t i = 0; i < n; i++) {
+        symbols[positions[i]] = toSymbol(input[i]);
+    }
+
+    decodeSymbols(output);
+}
+
+void Viterbi::decodeSymbols(uint8_t *output)
+{
+    init_viterbi (&vp, 0);
+
+    switch (impl) {
+#ifdef VITERBI_X86
+        case Implementation::SSE2:
+            update_viterbi_blk_SSE2 (&vp, Branchtab, symbols, frameBits + (K - 1));
+            break;
+        case Implementation::AVX2:
+            update_viterbi_blk_AVX2 (&vp, Branchtab, symbols, frameBits + (K - 1));
+            break;
+#endif
+#ifdef VITERBI_NEON
+        case Implementation::NEON:
+            update_viterbi_blk_NEON (&vp, Branchtab, symbols, frameBits + (K - 1));
+            break;
+#endif
+        default:
+            update_viterbi_blk_GENERIC (&vp, symbols, frameBits + (K - 1));
+            break;
+    }
+
+    // The chainback assembles the bits into bytes anyway, let it write
+    // them to the caller
+    chainback_viterbi (&vp, output, frameBits, 0);
 }
 
 /* C-language butterfly */
@@ -353,3 +650,16 @@ void Viterbi::init_viterbi(struct v *p, int16_t starting_state)
     vp->old_metrics-> t[starting_state & (NUMSTATES-1)] = 0;
 }
 
+const CPUDispatch& Viterbi::dispatch()
+{
+    static const CPUDispatch d({
+#ifdef VITERBI_X86
+            Implementation::AVX2,
+            Implementation::SSE2,
+#endif
+#ifdef VITERBI_NEON
+            Implementation::NEON,
+#endif
+            });
+    return d;
+}
@@ -3,8 +3,10 @@
 /*
  *  Viterbi.h according to the SPIRAL project
  */
+#include    <vector>
 #include    "dab-constants.h"
 #include    "MathHelper.h"
+#include    "cpudispatch.h"
 
 //  For our particular viterbi decoder, we have
 #define RATE    4
@@ -38,13 +40,41 @@ struct v {
 class Viterbi
 {
     public:
-        Viterbi(int16_t);
+        // Implementations of the 64-state butterfly: SSE2, AVX2, NEON
+        using Implementation = CPUImplementation;
+
+        Viterbi(int16_t wordlength, Implementation impl = Implementation::Auto);
         ~Viterbi(void);
         Viterbi(const Viterbi& other) = delete;
         Viterbi& operator=(const Viterbi& other) = delete;
+        // Decode (wordlength + 6) * 4 soft bits into wordlength / 8
+        // bytes, most significant bit first
         void deconvolve(softbit_t *input, uint8_t *output);
 
+        // Same for a punctured block, see appendPuncturing(). Reads one
+        // soft bit per position that is not punctured.
+        void deconvolvePunctured(const softbit_t *input, uint8_t *output);
+
+        Implementation implementation(void) const { return impl; }
+
+        static const CPUDispatch& dispatch(void);
+
+    protected:
+        // Describe the puncturing, in the order of the mother code: the
+        // next numBits bits are kept where pi[i % piLength] is not zero.
+        // The positions that are kept are computed once here, so that
+        // depuncturing is a single pass over the received soft bits.
+        void appendPuncturing(int32_t numBits, const int8_t *pi,
+                int16_t piLength = 32);
+
     private:
+        void decodeSymbols(uint8_t *output);
+
+        // Position in symbols of every soft bit that is not punctured
+        std::vector<uint32_t> puncturing;
+        int32_t puncturingLength = 0;
+
+        Implementation impl;
         struct v    vp;
         COMPUTETYPE Branchtab   [NUMSTATES / 2 * RATE] __attribute__ ((aligned (16)));
         //  int parityb     (uint8_t);
@@ -64,7 +94,6 @@ class Viterbi
 
         void BFLY( int i, int s, COMPUTETYPE * syms, struct v * vp, decision_t * d);
 
-        uint8_t *data;
         COMPUTETYPE *symbols;
         int16_t frameBits;
 };
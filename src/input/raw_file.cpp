@@ -59,10 +59,11 @@ static inline int64_t getMyTime(void)
 #define INPUT_FRAMEBUFFERSIZE 8 * 32768
 
 CRAWFile::CRAWFile(RadioControllerInterface& radioController,
-        bool throttle, bool rewind) :
+        bool throttle, bool rewind, bool synchronous) :
     radioController(radioController),
     throttle(throttle),
     autoRewind(rewind),
+    synchronous(synchronous),
     fileName(""),
     fileFormat(CRAWFileFormat::Unknown),
     IQByteSize(1),
@@ -104,6 +105,9 @@ bool CRAWFile::restart(void)
 
 bool CRAWFile::is_ok()
 {
+    if (synchronous and endReached) {
+        return false;
+    }
     return readerOK;
 }
 
@@ -181,7 +185,9 @@ void CRAWFile::setFileName(const std::string& fileName,
     readerOK = true;
     readerPausing = true;
     currPos = 0;
-    thread = std::thread(&CRAWFile::run, this);
+    if (not synchronous) {
+        thread = std::thread(&CRAWFile::run, this);
+    }
 }
 
 void CRAWFile::setFileHandle(int handle, const std::string& fileFormat)
@@ -201,7 +207,9 @@ void CRAWFile::setFileHandle(int handle, const std::string& fileFormat)
     readerOK = true;
     readerPausing = true;
     currPos = 0;
-    thread = std::thread(&CRAWFile::run, this);
+    if (not synchronous) {
+        thread = std::thread(&CRAWFile::run, this);
+    }
 }
 
 std::string CRAWFile::getFileName() const
@@ -215,6 +223,11 @@ int32_t CRAWFile::getSamples(DSPCOMPLEX* V, int32_t size)
     if (filePointer == nullptr)
         return 0;
 
+    if (synchronous) {
+        fillBuffers();
+        return convertSamples(SampleBuffer, V, size);
+    }
+
     while ((int32_t)(SampleBuffer.GetRingBufferReadAvailable()) < IQByteSize * size)
         if (readerPausing)
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -238,9 +251,35 @@ std::vector<DSPCOMPLEX> CRAWFile::getSpectrumSamples(int size)
 
 int32_t CRAWFile::getSamplesToRead(void)
 {
+    if (synchronous) {
+        fillBuffers();
+        return SampleBuffer.GetRingBufferReadAvailable() / IQByteSize;
+    }
+
     return SampleBuffer.GetRingBufferReadAvailable() / 2;
 }
 
+/*
+ *	Synchronous mode: top up the sample buffer from the file, in the
+ *	thread of the caller.
+ */
+void CRAWFile::fillBuffers(void)
+{
+    const int32_t bufferSize = 32768;
+    syncReadBuffer.resize(bufferSize);
+
+    while (not readerPausing and not endReached and
+            SampleBuffer.WriteSpace() >= bufferSize) {
+        const int32_t t = readBuffer(syncReadBuffer.data(), bufferSize);
+        if (t <= 0) {
+            break;
+        }
+        SampleBuffer.putDataIntoBuffer(syncReadBuffer.data(), t);
+        SpectrumSampleBuffer.putDataIntoBuffer(syncReadBuffer.data(), t);
+        putIntoRecordBuffer(*syncReadBuffer.data(), t);
+    }
+}
+
 void CRAWFile::run(void)
 {
     int32_t t;
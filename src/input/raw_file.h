@@ -46,9 +46,14 @@ enum class CRAWFileFormat {U8, S8, S16LE, S16BE, COMPLEXF, Unknown};
 
 class CRAWFile : public CVirtualInput {
 public:
+    // With synchronous set, there is no reader thread: the file is read
+    // by the thread consuming the samples, as fast as it consumes them,
+    // and throttle is ignored. Without rewind, is_ok() then returns false
+    // at the end of the file.
     CRAWFile(RadioControllerInterface& radioController,
             bool throttle = true,
-            bool rewind = true);
+            bool rewind = true,
+            bool synchronous = false);
     ~CRAWFile(void);
 
     // Interface methods
@@ -76,21 +81,27 @@ public:
 
     bool endWasReached() const { return endReached; }
 
+    // Number of I/Q pairs read from the file so far
+    int64_t getSamplesRead() const { return currPos / IQByteSize; }
+
 private:
     RadioControllerInterface& radioController;
     bool throttle;
     bool autoRewind;
+    bool synchronous;
     std::string fileName;
     CRAWFileFormat fileFormat;
     uint8_t IQByteSize = 2;
 
     void run(void);
+    void fillBuffers(void);
     int32_t readBuffer(uint8_t*, int32_t);
     int32_t convertSamples(RingBuffer<uint8_t>& Buffer, DSPCOMPLEX* V, int32_t size);
     void setFileFormat(const std::string& fileFormat);
 
     RingBuffer<uint8_t> SampleBuffer;
     RingBuffer<uint8_t> SpectrumSampleBuffer;
+    std::vector<uint8_t> syncReadBuffer;
     FILE* filePointer = nullptr;
     bool readerOK = false;
     bool readerPausing = false;
@@ -36,6 +36,19 @@
 
 #include "radio-receiver.h"
 #include "raw_file.h"
+#include "viterbi.h"
+#include "eep-protection.h"
+#include "uep-protection.h"
+#include "protTables.h"
+#include "energy_dispersal.h"
+#include "ofdm-decoder.h"
+#include "ofdm-processor.h"
+#include "dqpsk-demapper.h"
+#include "dabplus_decoder.h"
+#include "rs-syndromes.h"
+#include "fft.h"
+#include "ensemble-database.h"
+#include "fib-processor.h"
 
 class TestRadioInterface : public RadioControllerInterface {
     public:
@@ -80,6 +93,22 @@ public:
     virtual void onPADLengthError(size_t announced_xpad_len, size_t xpad_len) override { (void)announced_xpad_len; (void) xpad_len;}
 };
 
+// Construct Kernel(args..., impl) for every implementation the CPU
+// supports, and run check on it. The first one is always Generic.
+template <class Kernel, class Check, class... Args>
+static void checkImplementations(Check check, const Args&... args)
+{
+    for (const auto impl : Kernel::dispatch().supported()) {
+        Kernel kernel(args..., impl);
+        QCOMPARE(kernel.implementation(), impl);
+        check(kernel);
+        if (QTest::currentTestFailed()) {
+            qWarning("Implementation %s failed", cpuImplementationName(impl));
+            return;
+        }
+    }
+}
+
 class BackendTests : public QObject
 {
     Q_OBJECT
@@ -93,6 +122,18 @@ private slots:
     void cleanupTestCase() {}
     void testTuneToService();
     void testDLS();
+    void testViterbiImplementations();
+    void testDepuncturing();
+    void testPackedBits();
+    void testNCO();
+    void testParallelDemodulation();
+    void testDQPSKDemapper();
+    void testSharedFFTPlans();
+    void testEnsembleDatabase();
+    void testEnsembleSnapshot();
+    void testRSSyndromes();
+    void benchmarkRSDecoder_data();
+    void benchmarkRSDecoder();
 
 private:
     void runRadio(const std::string &rawFileName,
@@ -192,6 +233,593 @@ void BackendTests::testDLS()
     QCOMPARE(isOK, true);
 }
 
+void BackendTests::testViterbiImplementations()
+{
+    // Every SIMD butterfly must be bit-exact with the generic one, both on
+    // clean and on noisy input where the metrics get renormalised.
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> noise(-127, 127);
+
+    // FIC block and the smallest and largest EEP subchannels
+    for (const int16_t wordlength : {768, 24 * 8, 24 * 384}) {
+        std::vector<softbit_t> input((wordlength + 6) * 4);
+        std::vector<uint8_t> expected(wordlength / 8);
+        std::vector<uint8_t> output(wordlength / 8);
+
+        for (int run = 0; run < 50; run++) {
+            for (auto& sb : input) {
+                const int n = noise(gen);
+                sb = (run % 2 == 0) ? (n > 0 ? 100 : -100) : n;
+            }
+
+            Viterbi generic(wordlength, Viterbi::Implementation::Generic);
+            generic.deconvolve(input.data(), expected.data());
+
+            checkImplementations<Viterbi>([&](Viterbi& viterbi) {
+                    viterbi.deconvolve(input.data(), output.data());
+                    QVERIFY(output == expected);
+                }, wordlength);
+        }
+    }
+}
+
+void BackendTests::testDepuncturing()
+{
+    // The position table of every protection profile must give the same
+    // output as depuncturing the mother code block by block, as
+    // described in EN 300 401 clause 11, and then deconvolving it
+    struct Profile {
+        const char *name;
+        int16_t bitRate;
+        std::shared_ptr<Protection> protection;
+        // (L, PI) pairs, followed by the 24 bits of the tail
+        std::vector<std::pair<int16_t, int16_t> > blocks;
+    };
+
+    const std::vector<Profile> profiles = {
+        { "EEP-1A 32", 32, std::make_shared<EEPProtection>(32, true, 1),
+            { {21, 24}, {3, 23} } },
+        { "EEP-2A 8", 8, std::make_shared<EEPProtection>(8, true, 2),
+            { {5, 13}, {1, 12} } },
+        { "EEP-4A 64", 64, std::make_shared<EEPProtection>(64, true, 4),
+            { {29, 3}, {19, 2} } },
+        { "EEP-1B 64", 64, std::make_shared<EEPProtection>(64, false, 1),
+            { {45, 10}, {3, 9} } },
+        { "EEP-4B 32", 32, std::make_shared<EEPProtection>(32, false, 4),
+            { {21, 2}, {3, 1} } },
+        { "UEP 32/5", 32, std::make_shared<UEPProtection>(32, 5),
+            { {3, 5}, {4, 3}, {17, 2} } },
+        { "UEP 48/1", 48, std::make_shared<UEPProtection>(48, 1),
+            { {3, 24}, {5, 18}, {25, 13}, {3, 18} } },
+        { "UEP 64/3", 64, std::make_shared<UEPProtection>(64, 3),
+            { {6, 16}, {12, 8}, {27, 6}, {3, 9} } },
+    };
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> noise(-127, 127);
+
+    for (const auto& profile : profiles) {
+        const int16_t wordlength = 24 * profile.bitRate;
+        std::vector<softbit_t> input(wordlength * 4 + 24);
+        std::vector<softbit_t> block(wordlength * 4 + 24);
+        std::vector<uint8_t> expected(wordlength / 8);
+        std::vector<uint8_t> output(wordlength / 8);
+        Viterbi reference(wordlength);
+
+        for (int run = 0; run < 10; run++) {
+            for (auto& sb : input) {
+                sb = noise(gen);
+            }
+
+            std::fill(block.begin(), block.end(), 0);
+            size_t in = 0;
+            size_t out = 0;
+            for (const auto& b : profile.blocks) {
+                const int8_t *pi = getPCodes(b.second - 1);
+                for (int32_t j = 0; j < b.first * 128; j++, out++) {
+                    if (pi[j % 32] != 0) {
+                        block[out] = input[in++];
+                    }
+                }
+            }
+            for (int32_t j = 0; j < 24; j++, out++) {
+                if (PI_X[j] != 0) {
+                    block[out] = input[in++];
+                }
+            }
+            QCOMPARE(out, block.size());
+
+            reference.deconvolve(block.data(), expected.data());
+            profile.protection->deconvolve(input.data(), in, output.data());
+            QVERIFY2(output == expected, profile.name);
+        }
+    }
+}
+
+void BackendTests::testPackedBits()
+{
+    // The packed energy dispersal must apply the PRBS of EN 300 401
+    // clause 10.11 bit by bit, also for lengths that are not a multiple
+    // of the word size
+    for (const size_t len : {96, 24 * 8 / 8, 24 * 35 / 8}) {
+        std::vector<uint8_t> data(len, 0);
+        EnergyDispersal dispersal;
+        dispersal.dedisperse(data);
+
+        std::vector<uint8_t> shiftRegister(9, 1);
+        for (size_t i = 0; i < len * 8; i++) {
+            const uint8_t prbs = shiftRegister[8] ^ shiftRegister[4];
+            for (int j = 8; j > 0; j--) {
+                shiftRegister[j] = shiftRegister[j - 1];
+            }
+            shiftRegister[0] = prbs;
+            QCOMPARE((data[i / 8] >> (7 - i % 8)) & 1, (int)prbs);
+        }
+
+        // Applying it twice restores the data
+        dispersal.dedisperse(data);
+        QVERIFY(std::all_of(data.begin(), data.end(),
+                    [](uint8_t b) { return b == 0; }));
+    }
+
+    // The FIB parser reads fields at arbitrary bit offsets
+    const uint8_t fib[] = { 0x05, 0xa0, 0xff, 0x3c, 0x81 };
+    QCOMPARE(getBits_3(fib, 0), (uint16_t)0);
+    QCOMPARE(getBits_5(fib, 3), (uint16_t)5);
+    QCOMPARE(getBits_1(fib, 8), (uint16_t)1);
+    QCOMPARE(getBits_6(fib, 13), (uint16_t)0x07);
+    QCOMPARE(getBits(fib, 4, 16), (uint32_t)0x5a0f);
+    QCOMPARE(getBits(fib, 6, 32), (uint32_t)0x683fcf20);
+}
+
+void BackendTests::testNCO()
+{
+    // Mixing block-wise must give the same rotation as advancing the
+    // phase sample by sample, also across calls of odd lengths and with
+    // changing frequencies, as the synchronisation does
+    std::mt19937 gen(42);
+    std::normal_distribution<float> noise;
+    NCO nco;
+    int32_t localPhase = 0;
+
+    const std::vector<std::pair<int32_t, int32_t> > calls = {
+        {1, 0}, {50, 0}, {512, 1234}, {7, -1234}, {2048, 35000},
+        {255, -35001}, {257, 17}, {2552, -2}, {8, INPUT_RATE - 1},
+    };
+
+    for (const auto& call : calls) {
+        const int32_t n = call.first;
+        const int32_t phase = call.second;
+        std::vector<DSPCOMPLEX> input(n);
+        for (auto& x : input) {
+            x = DSPCOMPLEX(noise(gen), noise(gen));
+        }
+
+        std::vector<DSPCOMPLEX> expected(n);
+        float expected_sum = 0;
+        for (int32_t i = 0; i < n; i++) {
+            localPhase -= phase;
+            localPhase = (localPhase % INPUT_RATE + INPUT_RATE) % INPUT_RATE;
+            const double arg = 2.0 * M_PI * localPhase / INPUT_RATE;
+            expected[i] = input[i] * DSPCOMPLEX(cos(arg), sin(arg));
+            expected_sum += l1_norm(expected[i]);
+        }
+
+        auto output = input;
+        std::vector<float> envelope(n);
+        const float sum = nco.mix(output.data(), n, phase, envelope.data());
+
+        for (int32_t i = 0; i < n; i++) {
+            QVERIFY2(std::abs(output[i] - expected[i]) <
+                    1e-4 * std::abs(input[i]) + 1e-6,
+                    ("phase " + std::to_string(phase) +
+                     ", sample " + std::to_string(i)).c_str());
+            QCOMPARE(envelope[i], l1_norm(output[i]));
+        }
+        QVERIFY(std::fabs(sum - expected_sum) < 1e-3 * expected_sum);
+    }
+}
+
+void BackendTests::testParallelDemodulation()
+{
+    // Demodulating a frame on several threads must give the same
+    // constellation and FIBs as the sequential decoder
+    class RecordingInterface : public TestRadioInterface {
+        public:
+            virtual void onFIBDecodeSuccess(bool crcCheckOk, const uint8_t* fib) override {
+                (void)crcCheckOk;
+                fibs.insert(fibs.end(), fib, fib + 32);
+            }
+
+            virtual void onConstellationPoints(std::vector<DSPCOMPLEX>&& data) override {
+                std::lock_guard<std::mutex> lock(mutex);
+                constellation = std::move(data);
+                frameDone = true;
+                cv.notify_one();
+            }
+
+            void waitForFrame() {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return frameDone; });
+                frameDone = false;
+            }
+
+            std::vector<uint8_t> fibs;
+            std::vector<DSPCOMPLEX> constellation;
+
+        private:
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool frameDone = false;
+    };
+
+    const DABParams params(1);
+    std::mt19937 gen(42);
+    std::normal_distribution<float> noise;
+    std::vector<std::vector<std::vector<DSPCOMPLEX> > > frames(3);
+    for (auto& frame : frames) {
+        frame.resize(params.L, std::vector<DSPCOMPLEX>(params.T_s));
+        for (auto& symbol : frame) {
+            for (auto& sample : symbol) {
+                sample = DSPCOMPLEX(noise(gen), noise(gen));
+            }
+        }
+    }
+
+    std::vector<std::vector<DSPCOMPLEX> > constellations[2];
+    std::vector<uint8_t> fibs[2];
+    const size_t numThreads[2] = {1, 3};
+    for (size_t i = 0; i < 2; i++) {
+        RecordingInterface radioInterface;
+        FicHandler ficHandler(radioInterface);
+        MscHandler mscHandler(params, false);
+        OfdmDecoder decoder(params, radioInterface,
+                ficHandler, mscHandler, numThreads[i]);
+
+        for (auto frame : frames) {
+            decoder.pushAllSymbols(std::move(frame));
+            radioInterface.waitForFrame();
+            constellations[i].push_back(radioInterface.constellation);
+        }
+        fibs[i] = radioInterface.fibs;
+    }
+
+    QCOMPARE(constellations[1].size(), frames.size());
+    QCOMPARE(constellations[0][0].size(),
+            (size_t)((params.L - 1) * params.K / OfdmDecoder::constellationDecimation));
+    QVERIFY(constellations[0] == constellations[1]);
+    QCOMPARE(fibs[0].size(), frames.size() * 12 * 32);
+    QVERIFY(fibs[0] == fibs[1]);
+}
+
+void BackendTests::testDQPSKDemapper()
+{
+    // The demapper must give the same bits as demodulating carrier i at
+    // the bin the frequency interleaver maps it to, and every SIMD
+    // implementation the same as the generic one
+    std::mt19937 gen(42);
+    std::normal_distribution<float> noise;
+
+    for (const int mode : {1, 2, 3, 4}) {
+        const DABParams params(mode);
+        FrequencyInterleaver interleaver(params);
+        std::vector<DSPCOMPLEX> spectrum(params.T_u);
+        std::vector<DSPCOMPLEX> reference(params.T_u);
+        std::vector<softbit_t> expected(2 * params.K);
+        std::vector<softbit_t> output(2 * params.K);
+
+        for (int run = 0; run < 10; run++) {
+            for (int32_t j = 0; j < params.T_u; j++) {
+                spectrum[j] = DSPCOMPLEX(noise(gen), noise(gen));
+                reference[j] = DSPCOMPLEX(noise(gen), noise(gen));
+            }
+
+            for (int16_t i = 0; i < params.K; i++) {
+                int16_t index = interleaver.mapIn(i);
+                if (index < 0)
+                    index += params.T_u;
+                const DSPCOMPLEX r1 = spectrum[index] * conj(reference[index]);
+                const DSPFLOAT ab1 = 127.0f / l1_norm(r1);
+                expected[i] = -real(r1) * ab1;
+                expected[params.K + i] = -imag(r1) * ab1;
+            }
+
+            // A carrier without energy must not give garbage
+            const int16_t silent = interleaver.mapIn(run) < 0 ?
+                params.T_u + interleaver.mapIn(run) : interleaver.mapIn(run);
+            spectrum[silent] = 0;
+            expected[run] = 0;
+            expected[params.K + run] = 0;
+
+            checkImplementations<DQPSKDemapper>([&](DQPSKDemapper& demapper) {
+                    demapper.demap(spectrum.data(), reference.data(), output.data());
+                    QVERIFY(output == expected);
+                }, params);
+        }
+    }
+}
+
+void BackendTests::testSharedFFTPlans()
+{
+    // FFT objects of the same size share their plan, but each of them
+    // must still transform its own buffer
+    const int32_t size = 256;
+    fft::Forward impulse(size);
+    fft::Forward constant(size);
+    fft::Backward inverse(size);
+
+    impulse.getVector()[1] = 1;
+    for (int32_t i = 0; i < size; i++) {
+        constant.getVector()[i] = 1;
+        inverse.getVector()[i] = 1;
+    }
+
+    impulse.do_FFT();
+    constant.do_FFT();
+    inverse.do_IFFT();
+
+    for (int32_t k = 0; k < size; k++) {
+        const DSPCOMPLEX expected = std::polar(1.0f, (float)(-2 * M_PI * k / size));
+        QVERIFY(std::abs(impulse.getVector()[k] - expected) < 1e-4);
+        QVERIFY(std::abs(constant.getVector()[k] - DSPCOMPLEX(k == 0 ? size : 0)) < 1e-3);
+        QVERIFY(std::abs(inverse.getVector()[k] - DSPCOMPLEX(k == 0 ? 1 : 0)) < 1e-4);
+    }
+}
+
+void BackendTests::testEnsembleDatabase()
+{
+    EnsembleConfiguration config;
+    config.ensembleId = 0x4fff;
+    config.ensembleEcc = 0xe1;
+    config.ensembleLabel.fig1_label = "Test Ensemble   ";
+    config.ensembleLabel.fig1_flag = 0xff00;
+
+    Service service(0x4daa);
+    service.serviceLabel.fig1_label = "Test Service    ";
+    service.programType = 10;
+    config.services.push_back(service);
+
+    ServiceComponent component;
+    component.SId = service.serviceId;
+    component.ASCTy = 0x3f;
+    component.PS_flag = 1;
+    component.subchannelId = 5;
+    config.components.push_back(component);
+
+    Subchannel subchannel;
+    subchannel.subChId = 5;
+    subchannel.startAddr = 84;
+    subchannel.length = 72;
+    subchannel.protectionSettings.eepLevel = EEPProtectionLevel::EEP_2;
+    config.subchannels.push_back(subchannel);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    EnsembleDatabase database(directory.path().toStdString());
+
+    EnsembleConfiguration loaded;
+    QVERIFY(not database.load("12C", loaded));
+    QVERIFY(database.save("12C", config));
+    QVERIFY(database.load("12C", loaded));
+
+    QCOMPARE(loaded.ensembleId, config.ensembleId);
+    QCOMPARE(loaded.ensembleEcc, config.ensembleEcc);
+    QCOMPARE(loaded.ensembleLabel.fig1_label, config.ensembleLabel.fig1_label);
+    QCOMPARE(loaded.ensembleLabel.fig1_flag, config.ensembleLabel.fig1_flag);
+    QCOMPARE(loaded.services.size(), (size_t)1);
+    QCOMPARE(loaded.services[0].serviceId, service.serviceId);
+    QCOMPARE(loaded.services[0].serviceLabel.fig1_label, service.serviceLabel.fig1_label);
+    QCOMPARE(loaded.services[0].programType, service.programType);
+    QCOMPARE(loaded.components.size(), (size_t)1);
+    QCOMPARE(loaded.components[0].SId, component.SId);
+    QCOMPARE(loaded.components[0].ASCTy, component.ASCTy);
+    QCOMPARE(loaded.components[0].subchannelId, component.subchannelId);
+    QCOMPARE(loaded.subchannels.size(), (size_t)1);
+    QCOMPARE(loaded.subchannels[0].startAddr, subchannel.startAddr);
+    QCOMPARE(loaded.subchannels[0].length, subchannel.length);
+    QVERIFY(loaded.subchannels[0].protectionSettings.eepLevel == EEPProtectionLevel::EEP_2);
+
+    // The services from the database are listed right away, but are not
+    // written back before the FIC confirmed them
+    TestRadioInterface testRadioInterface;
+    FIBProcessor fibProcessor(testRadioInterface);
+    fibProcessor.loadEnsemble(loaded);
+
+    const auto services = fibProcessor.getServiceList();
+    QCOMPARE(services.size(), (size_t)1);
+    QVERIFY(services[0].provisional);
+    QCOMPARE(fibProcessor.getEnsembleId(), config.ensembleId);
+    QCOMPARE(fibProcessor.getComponents(services[0]).size(), (size_t)1);
+    QCOMPARE(fibProcessor.getSubchannel(component).startAddr, subchannel.startAddr);
+    QVERIFY(fibProcessor.getEnsembleConfiguration().services.empty());
+}
+
+void BackendTests::testEnsembleSnapshot()
+{
+    TestRadioInterface testRadioInterface;
+    FIBProcessor fibProcessor(testRadioInterface);
+
+    const auto empty = fibProcessor.getSnapshot();
+    QVERIFY(empty->services.empty());
+    QCOMPARE(empty->subChannels.size(), (size_t)64);
+
+    // A FIB carrying nothing but the end marker changes nothing
+    std::vector<uint8_t> fib(32, 0xff);
+    fibProcessor.processFIB(fib.data(), 0);
+    QCOMPARE(fibProcessor.getSnapshot(), empty);
+
+    EnsembleConfiguration config;
+    config.ensembleId = 0x4fff;
+    config.services.emplace_back(0x4daa);
+    fibProcessor.loadEnsemble(config);
+
+    // Readers holding the old snapshot keep seeing the old ensemble
+    const auto loaded = fibProcessor.getSnapshot();
+    QVERIFY(loaded->version > empty->version);
+    QCOMPARE(loaded->services.size(), (size_t)1);
+    QCOMPARE(loaded->ensembleId, config.ensembleId);
+    QVERIFY(empty->services.empty());
+
+    fibProcessor.clearEnsemble();
+    QVERIFY(fibProcessor.getSnapshot()->version > loaded->version);
+    QVERIFY(fibProcessor.getServiceList().empty());
+    QCOMPARE(loaded->getService(0x4daa).serviceId, (uint32_t)0x4daa);
+}
+
+// Superframe of num_codewords interleaved RS(120, 110) codewords with
+// random content, as ETSI TS 102 563 clause 6 lays them out
+static std::vector<uint8_t> makeSuperframe(void *rs, size_t num_codewords,
+        std::mt19937& gen)
+{
+    std::vector<uint8_t> sf(120 * num_codewords);
+    uint8_t codeword[120];
+    for (size_t i = 0; i < num_codewords; i++) {
+        for (size_t pos = 0; pos < 110; pos++) {
+            codeword[pos] = gen();
+        }
+        encode_rs_char(rs, codeword, codeword + 110);
+
+        for (size_t pos = 0; pos < 120; pos++) {
+            sf[pos * num_codewords + i] = codeword[pos];
+        }
+    }
+    return sf;
+}
+
+// What RSDecoder did before the syndrome check: run libfec on every
+// codeword. Returns libfec's result for each of them.
+static std::vector<int> decodeSuperframeLibfec(void *rs, uint8_t *sf,
+        size_t num_codewords, int& total_corr_count, bool& uncorr_errors)
+{
+    std::vector<int> results(num_codewords);
+    total_corr_count = 0;
+    uncorr_errors = false;
+
+    uint8_t codeword[120];
+    int corr_pos[10];
+    for (size_t i = 0; i < num_codewords; i++) {
+        for (size_t pos = 0; pos < 120; pos++) {
+            codeword[pos] = sf[pos * num_codewords + i];
+        }
+
+        const int corr_count = decode_rs_char(rs, codeword, corr_pos, 0);
+        results[i] = corr_count;
+        if (corr_count == -1) {
+            uncorr_errors = true;
+            continue;
+        }
+        total_corr_count += corr_count;
+
+        for (size_t pos = 0; pos < 120; pos++) {
+            sf[pos * num_codewords + i] = codeword[pos];
+        }
+    }
+    return results;
+}
+
+void BackendTests::testRSSyndromes()
+{
+    // Every implementation must flag exactly the codewords libfec finds
+    // errors in, and the RS decoder must correct the superframe the same
+    // way as running libfec on every codeword
+    std::mt19937 gen(42);
+    void *rs = init_rs_char(8, 0x11D, 0, 1, 10, 135);
+    QVERIFY(rs);
+
+    // From 8 to 384 kbit/s, with and without a partial SIMD vector
+    for (const size_t num_codewords : {1, 6, 16, 17, 24, 48}) {
+        for (int run = 0; run < 20; run++) {
+            auto sf = makeSuperframe(rs, num_codewords, gen);
+
+            // Some codewords correctable, some not, and the first
+            // superframe clean
+            if (run > 0) {
+                for (size_t i = 0; i < num_codewords; i++) {
+                    const int num_errors = gen() % 8;
+                    for (int e = 0; e < num_errors; e++) {
+                        sf[(gen() % 120) * num_codewords + i] ^= 1 + gen() % 255;
+                    }
+                }
+            }
+
+            auto expected = sf;
+            int expected_corr_count;
+            bool expected_uncorr_errors;
+            const auto results = decodeSuperframeLibfec(rs, expected.data(),
+                    num_codewords, expected_corr_count, expected_uncorr_errors);
+
+            std::vector<uint8_t> expected_errors(num_codewords);
+            for (size_t i = 0; i < num_codewords; i++) {
+                expected_errors[i] = results[i] != 0;
+            }
+
+            checkImplementations<RSSyndromes>([&](RSSyndromes& syndromes) {
+                    std::vector<uint8_t> has_errors(num_codewords);
+                    const size_t num_errors = syndromes.check(sf.data(),
+                            num_codewords, has_errors.data());
+                    QVERIFY(has_errors == expected_errors);
+                    QCOMPARE(num_errors, (size_t)std::count(
+                                expected_errors.begin(), expected_errors.end(), 1));
+
+                    RSDecoder decoder(syndromes.implementation());
+                    auto output = sf;
+                    int corr_count;
+                    bool uncorr_errors;
+                    decoder.DecodeSuperframe(output.data(), output.size(),
+                            corr_count, uncorr_errors);
+                    QVERIFY(output == expected);
+                    QCOMPARE(corr_count, expected_corr_count);
+                    QCOMPARE(uncorr_errors, expected_uncorr_errors);
+                });
+        }
+    }
+
+    free_rs_char(rs);
+}
+
+void BackendTests::benchmarkRSDecoder_data()
+{
+    // -1 runs libfec on every codeword
+    QTest::addColumn<int>("implementation");
+
+    QTest::newRow("libfec") << -1;
+    for (const auto impl : RSSyndromes::dispatch().supported()) {
+        QTest::newRow(cpuImplementationName(impl)) << (int)impl;
+    }
+}
+
+void BackendTests::benchmarkRSDecoder()
+{
+    QFETCH(int, implementation);
+
+    // A clean superframe of a 96 kbit/s programme, the common case
+    std::mt19937 gen(42);
+    void *rs = init_rs_char(8, 0x11D, 0, 1, 10, 135);
+    QVERIFY(rs);
+    const size_t num_codewords = 12;
+    auto sf = makeSuperframe(rs, num_codewords, gen);
+
+    int corr_count = 0;
+    bool uncorr_errors = false;
+    if (implementation < 0) {
+        QBENCHMARK {
+            decodeSuperframeLibfec(rs, sf.data(), num_codewords,
+                    corr_count, uncorr_errors);
+        }
+    }
+    else {
+        RSDecoder decoder((RSSyndromes::Implementation)implementation);
+        QBENCHMARK {
+            decoder.DecodeSuperframe(sf.data(), sf.size(),
+                    corr_count, uncorr_errors);
+        }
+    }
+    QCOMPARE(corr_count, 0);
+    QVERIFY(not uncorr_errors);
+
+    free_rs_char(rs);
+}
+
 QTEST_APPLESS_MAIN(BackendTests)
 
 #include "backend_tests.moc"
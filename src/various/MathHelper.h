@@ -34,7 +34,9 @@
 #define MATHHELPER_H
 
 #include <complex>
+#include <cstdint>
 #include <cstring>
+#include <stdexcept>
 
 #define Hz(x) (x)
 #define kHz(x) (x * 1000)
@@ -50,35 +52,6 @@ static inline float l1_norm(const std::complex<float>& z)
     return std::abs(z.real()) + std::abs(z.imag());
 }
 
-static inline bool check_CRC_bits(const uint8_t *in, int size)
-{
-    static const uint8_t crcPolynome[] = { 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0 }; // MSB .. LSB
-    uint8_t b[16];
-    memset(b, 1, 16);
-
-    for (int i = 0; i < size; i++) {
-        uint8_t d = in[i];
-        if (i >= size - 16) {
-            d ^= 1;
-        }
-
-        if ((b[0] ^ d) == 1) {
-            for (int f = 0; f < 15; f++)
-                b[f] = crcPolynome[f] ^ b[f + 1];
-            b[15] = 1;
-        }
-        else {
-            memmove(&b[0], &b[1], sizeof(uint8_t) * 15); // Shift
-            b[15] = 0;
-        }
-    }
-
-    uint16_t crc = 0;
-    for (int i = 0; i < 16; i++)
-        crc |= b[i] << i;
-    return crc == 0;
-}
-
 static inline bool check_crc_bytes(const uint8_t *msg, int len)
 {
     uint16_t accumulator = 0xFFFF;
@@ -101,122 +74,63 @@ static inline bool check_crc_bytes(const uint8_t *msg, int len)
     return (crc ^ accumulator) == 0;
 }
 
+// Read size bits at bit offset of data packed eight bits per byte,
+// most significant bit first
 static inline uint32_t getBits(const uint8_t* d, int16_t offset, uint8_t size)
 {
     if (size > 32) {
         throw std::logic_error("getBits called with size>32");
     }
 
-    uint32_t res = 0;
+    const uint8_t *p = d + (offset >> 3);
+    const int shift = offset & 7;
+    const int nbytes = (shift + size + 7) / 8;
 
-    for (int i = 0; i < size; i++) {
-        res <<= 1;
-        res |= d[offset + i];
+    uint64_t res = 0;
+    for (int i = 0; i < nbytes; i++) {
+        res = (res << 8) | p[i];
     }
-    return res;
+    return (res >> (nbytes * 8 - shift - size)) & ((1ull << size) - 1);
 }
 
 static inline uint16_t getBits_1(const uint8_t* d, int16_t offset)
 {
-    return (d[offset] & 0x01);
+    return (d[offset >> 3] >> (7 - (offset & 7))) & 0x01;
 }
 
 static inline uint16_t getBits_2(const uint8_t* d, int16_t offset)
 {
-    uint16_t res = d[offset];
-    res <<= 1;
-    res |= d[offset + 1];
-    return res;
+    return getBits(d, offset, 2);
 }
 
 static inline uint16_t getBits_3(const uint8_t* d, int16_t offset)
 {
-    uint16_t res = d[offset];
-    res <<= 1;
-    res |= d[offset + 1];
-    res <<= 1;
-    res |= d[offset + 2];
-    return res;
+    return getBits(d, offset, 3);
 }
 
 static inline uint16_t getBits_4(const uint8_t* d, int16_t offset)
 {
-    uint16_t res = d[offset];
-    res <<= 1;
-    res |= d[offset + 1];
-    res <<= 1;
-    res |= d[offset + 2];
-    res <<= 1;
-    res |= d[offset + 3];
-    return res;
+    return getBits(d, offset, 4);
 }
 
 static inline uint16_t getBits_5(const uint8_t* d, int16_t offset)
 {
-    uint16_t res = d[offset];
-    res <<= 1;
-    res |= d[offset + 1];
-    res <<= 1;
-    res |= d[offset + 2];
-    res <<= 1;
-    res |= d[offset + 3];
-    res <<= 1;
-    res |= d[offset + 4];
-    return res;
+    return getBits(d, offset, 5);
 }
 
 static inline uint16_t getBits_6(const uint8_t* d, int16_t offset)
 {
-    uint16_t res = d[offset];
-    res <<= 1;
-    res |= d[offset + 1];
-    res <<= 1;
-    res |= d[offset + 2];
-    res <<= 1;
-    res |= d[offset + 3];
-    res <<= 1;
-    res |= d[offset + 4];
-    res <<= 1;
-    res |= d[offset + 5];
-    return res;
+    return getBits(d, offset, 6);
 }
 
 static inline uint16_t getBits_7(const uint8_t* d, int16_t offset)
 {
-    uint16_t res = d[offset];
-    res <<= 1;
-    res |= d[offset + 1];
-    res <<= 1;
-    res |= d[offset + 2];
-    res <<= 1;
-    res |= d[offset + 3];
-    res <<= 1;
-    res |= d[offset + 4];
-    res <<= 1;
-    res |= d[offset + 5];
-    res <<= 1;
-    res |= d[offset + 6];
-    return res;
+    return getBits(d, offset, 7);
 }
 
 static inline uint16_t getBits_8(const uint8_t* d, int16_t offset)
 {
-    uint16_t res = d[offset];
-    res <<= 1;
-    res |= d[offset + 1];
-    res <<= 1;
-    res |= d[offset + 2];
-    res <<= 1;
-    res |= d[offset + 3];
-    res <<= 1;
-    res |= d[offset + 4];
-    res <<= 1;
-    res |= d[offset + 5];
-    res <<= 1;
-    res |= d[offset + 6];
-    res <<= 1;
-    res |= d[offset + 7];
-    return res;
+    return getBits(d, offset, 8);
 }
 
 #endif // MATHHELPER_H
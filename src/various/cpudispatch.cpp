@@ -0,0 +1,112 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <algorithm>
+#include "cpudispatch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define DISPATCH_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define DISPATCH_NEON
+#  if defined(__linux__) && defined(__arm__)
+#    include <sys/auxv.h>
+#    include <asm/hwcap.h>
+#  endif
+#endif
+
+bool cpuSupports(CPUImplementation impl)
+{
+    switch (impl) {
+        case CPUImplementation::Auto:
+        case CPUImplementation::Generic:
+            return true;
+#ifdef DISPATCH_X86
+        case CPUImplementation::SSE2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        case CPUImplementation::SSSE3:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3");
+        case CPUImplementation::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef DISPATCH_NEON
+        case CPUImplementation::NEON:
+            // NEON is optional on armv7 only
+#  if defined(__linux__) && defined(__arm__)
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#  else
+            return true;
+#  endif
+#endif
+        default:
+            return false;
+    }
+}
+
+const char *cpuImplementationName(CPUImplementation impl)
+{
+    switch (impl) {
+        case CPUImplementation::Auto: return "auto";
+        case CPUImplementation::Generic: return "generic";
+        case CPUImplementation::SSE2: return "SSE2";
+        case CPUImplementation::SSSE3: return "SSSE3";
+        case CPUImplementation::AVX2: return "AVX2";
+        case CPUImplementation::NEON: return "NEON";
+    }
+    return "unknown";
+}
+
+CPUDispatch::CPUDispatch(std::initializer_list<CPUImplementation> compiled) :
+    supportedImpls({CPUImplementation::Generic}),
+    bestImpl(CPUImplementation::Generic)
+{
+    for (const auto impl : compiled) {
+        if (cpuSupports(impl)) {
+            if (bestImpl == CPUImplementation::Generic) {
+                bestImpl = impl;
+            }
+            supportedImpls.push_back(impl);
+        }
+    }
+}
+
+bool CPUDispatch::isSupported(CPUImplementation impl) const
+{
+    return impl == CPUImplementation::Auto or
+        std::find(supportedImpls.begin(), supportedImpls.end(), impl) !=
+        supportedImpls.end();
+}
+
+CPUImplementation CPUDispatch::resolve(CPUImplementation impl) const
+{
+    if (impl == CPUImplementation::Auto or not isSupported(impl)) {
+        return best();
+    }
+    return impl;
+}
@@ -0,0 +1,70 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __CPU_DISPATCH
+#define __CPU_DISPATCH
+
+#include <initializer_list>
+#include <vector>
+
+/* The instruction sets the SIMD kernels of the backend are written for.
+ * Auto stands for the fastest one available, Generic for the plain C++
+ * reference all others must be bit-exact with. */
+enum class CPUImplementation { Auto, Generic, SSE2, SSSE3, AVX2, NEON };
+
+// Returns true if the CPU we are running on can execute impl
+bool cpuSupports(CPUImplementation impl);
+
+const char *cpuImplementationName(CPUImplementation impl);
+
+/* Runtime selection among the implementations of one kernel. Every
+ * class with SIMD kernels keeps one, built from the implementations it
+ * was compiled with. */
+class CPUDispatch
+{
+    public:
+        // The implementations besides Generic that were compiled in,
+        // fastest first
+        CPUDispatch(std::initializer_list<CPUImplementation> compiled);
+
+        // Returns true if impl was compiled in and the CPU supports it
+        bool isSupported(CPUImplementation impl) const;
+
+        // The fastest supported implementation
+        CPUImplementation best(void) const { return bestImpl; }
+
+        // impl if it is supported, otherwise best()
+        CPUImplementation resolve(CPUImplementation impl) const;
+
+        // Generic, then every other supported implementation
+        const std::vector<CPUImplementation>& supported(void) const
+            { return supportedImpls; }
+
+    private:
+        std::vector<CPUImplementation> supportedImpls;
+        CPUImplementation bestImpl;
+};
+
+#endif
@@ -27,23 +27,123 @@
  */
 #include    "fft.h"
 #include    <cstring>
+#include    <fstream>
+#include    <iostream>
+#include    <map>
+#include    <mutex>
+#include    <utility>
 
 namespace fft {
 
+#ifndef KISSFFT
+using plan_t = FFTW_PLAN;
+#else
+using plan_t = kiss_fft_cfg;
+#endif
+
+/* All FFT objects of the same size and direction share one plan, which
+ * both FFTW and KISS FFT allow to be used from several threads at once.
+ * Creating FFTW plans is not thread-safe, so that is serialised here.
+ */
+class PlanRegistry {
+    public:
+        static PlanRegistry& instance(void)
+        {
+            static PlanRegistry registry;
+            return registry;
+        }
+
+        ~PlanRegistry()
+        {
+            for (auto& p : plans) {
+#ifndef KISSFFT
+                FFTW_DESTROY_PLAN(p.second);
+#else
+                free(p.second);
+#endif
+            }
+        }
+
+        bool configure(const std::string& wisdom_file, PlanningEffort effort)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->wisdom_file = wisdom_file;
+            this->effort = effort;
+
+#ifndef KISSFFT
+            if (not wisdom_file.empty() and std::ifstream(wisdom_file).good()) {
+                if (fftwf_import_wisdom_from_filename(wisdom_file.c_str()) == 0) {
+                    std::clog << "FFT: could not load wisdom from " <<
+                        wisdom_file << std::endl;
+                    return false;
+                }
+            }
+#endif
+            return true;
+        }
+
+        plan_t get(int32_t fft_size, bool forward)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto key = std::make_pair(fft_size, forward);
+            const auto it = plans.find(key);
+            if (it != plans.end()) {
+                return it->second;
+            }
+
+#ifndef KISSFFT
+            unsigned flags = FFTW_ESTIMATE;
+            switch (effort) {
+                case PlanningEffort::Estimate: flags = FFTW_ESTIMATE; break;
+                case PlanningEffort::Measure: flags = FFTW_MEASURE; break;
+                case PlanningEffort::Patient: flags = FFTW_PATIENT; break;
+            }
+
+            // Measuring overwrites the buffer, and the FFT objects only
+            // execute the plan on their own buffers, which are aligned
+            // the same way
+            auto buffer = reinterpret_cast<fftwf_complex*>(
+                    FFTW_MALLOC(sizeof(DSPCOMPLEX) * fft_size));
+            plan_t plan = FFTW_PLAN_DFT_1D(fft_size, buffer, buffer,
+                    forward ? FFTW_FORWARD : FFTW_BACKWARD, flags);
+            FFTW_FREE(buffer);
+
+            if (not wisdom_file.empty() and
+                    fftwf_export_wisdom_to_filename(wisdom_file.c_str()) == 0) {
+                std::clog << "FFT: could not save wisdom to " <<
+                    wisdom_file << std::endl;
+            }
+#else
+            plan_t plan = kiss_fft_alloc(fft_size, forward ? 0 : 1, NULL, NULL);
+#endif
+            plans[key] = plan;
+            return plan;
+        }
+
+    private:
+        PlanRegistry() = default;
+
+        std::mutex mutex;
+        std::map<std::pair<int32_t, bool>, plan_t> plans;
+        std::string wisdom_file;
+        PlanningEffort effort = PlanningEffort::Estimate;
+};
+
+bool configurePlanning(const std::string& wisdom_file, PlanningEffort effort)
+{
+    return PlanRegistry::instance().configure(wisdom_file, effort);
+}
+
 #ifndef KISSFFT
 Forward::Forward(int32_t fft_size)
 {
     vector = (DSPCOMPLEX *)FFTW_MALLOC(sizeof (DSPCOMPLEX) * fft_size);
     memset((void*)vector, 0, sizeof(DSPCOMPLEX) * fft_size);
-    plan  = FFTW_PLAN_DFT_1D(fft_size,
-            reinterpret_cast<fftwf_complex*>(vector),
-            reinterpret_cast<fftwf_complex*>(vector),
-            FFTW_FORWARD, FFTW_ESTIMATE);
+    plan = PlanRegistry::instance().get(fft_size, true);
 }
 
 Forward::~Forward()
 {
-    FFTW_DESTROY_PLAN(plan);
     FFTW_FREE(vector);
 }
 
@@ -54,7 +154,9 @@ DSPCOMPLEX* Forward::getVector()
 
 void Forward::do_FFT()
 {
-    FFTW_EXECUTE (plan);
+    FFTW_EXECUTE_DFT(plan,
+            reinterpret_cast<fftwf_complex*>(vector),
+            reinterpret_cast<fftwf_complex*>(vector));
 }
 
 Backward::Backward(int32_t fft_size) :
@@ -64,15 +166,11 @@ Backward::Backward(int32_t fft_size) :
     for (int i = 0; i < fft_size; i ++) {
         vector [i] = 0;
     }
-    plan  = FFTW_PLAN_DFT_1D(fft_size,
-            reinterpret_cast<fftwf_complex*>(vector),
-            reinterpret_cast<fftwf_complex*>(vector),
-            FFTW_BACKWARD, FFTW_ESTIMATE);
+    plan = PlanRegistry::instance().get(fft_size, false);
 }
 
 Backward::~Backward ()
 {
-    FFTW_DESTROY_PLAN(plan);
     FFTW_FREE(vector);
 }
 
@@ -83,7 +181,9 @@ DSPCOMPLEX* Backward::getVector()
 
 void Backward::do_IFFT()
 {
-    FFTW_EXECUTE(plan);
+    FFTW_EXECUTE_DFT(plan,
+            reinterpret_cast<fftwf_complex*>(vector),
+            reinterpret_cast<fftwf_complex*>(vector));
 
     const DSPFLOAT factor = 1.0 / DSPFLOAT(fft_size);
 
@@ -98,7 +198,7 @@ void Backward::do_IFFT()
 Forward::Forward(int32_t fft_size) :
     fft_size(fft_size)
 {
-    cfg = kiss_fft_alloc(fft_size, 0, NULL, NULL);
+    cfg = PlanRegistry::instance().get(fft_size, true);
 
     fin = (DSPCOMPLEX*)malloc(fft_size * sizeof(DSPCOMPLEX));
     fout = (DSPCOMPLEX*)malloc(fft_size * sizeof(DSPCOMPLEX));
@@ -109,7 +209,6 @@ Forward::Forward(int32_t fft_size) :
 
 Forward::~Forward()
 {
-    free(cfg);
     free(fin);
     free(fout);
 }
@@ -128,7 +227,7 @@ void Forward::do_FFT()
 Backward::Backward(int32_t fft_size) :
     fft_size(fft_size)
 {
-    cfg = kiss_fft_alloc(fft_size, 1, NULL, NULL);
+    cfg = PlanRegistry::instance().get(fft_size, false);
 
     fin = (DSPCOMPLEX*)malloc(fft_size * sizeof(DSPCOMPLEX));
     fout = (DSPCOMPLEX*)malloc(fft_size * sizeof(DSPCOMPLEX));
@@ -139,7 +238,6 @@ Backward::Backward(int32_t fft_size) :
 
 Backward::~Backward()
 {
-    free(cfg);
     free(fin);
     free(fout);
 }
@@ -31,17 +31,31 @@
 #define _COMMON_FFT
 
 // Wrappers around fftwf and KISS FFT for both forward and backward FFTs
+#include <string>
 #include "dab-constants.h"
 
 namespace fft {
 
+// How long FFTW may search for the fastest plan of a size it has no
+// wisdom about. Measure takes a fraction of a second per size,
+// Patient several seconds. Ignored by KISS FFT.
+enum class PlanningEffort { Estimate, Measure, Patient };
+
+// Plans are created once per size and direction and shared by all
+// Forward and Backward objects, so this should be called before the
+// first one is created. With a wisdom_file, FFTW wisdom is loaded from
+// it and saved to it whenever a new plan was made, so that the planning
+// effort is only paid once. Returns false if the file exists but could
+// not be loaded.
+bool configurePlanning(const std::string& wisdom_file, PlanningEffort effort);
+
 #ifndef KISSFFT
 #  define FFTW_MALLOC     fftwf_malloc
 #  define FFTW_PLAN_DFT_1D    fftwf_plan_dft_1d
 #  define FFTW_DESTROY_PLAN   fftwf_destroy_plan
 #  define FFTW_FREE       fftwf_free
 #  define FFTW_PLAN       fftwf_plan
-#  define FFTW_EXECUTE        fftwf_execute
+#  define FFTW_EXECUTE_DFT    fftwf_execute_dft
 #  include <fftw3.h>
 
 class Forward {
@@ -55,7 +69,7 @@ class Forward {
 
     private:
         DSPCOMPLEX *vector;
-        FFTW_PLAN plan;
+        FFTW_PLAN plan; // Shared, not owned
 };
 
 class Backward
@@ -71,7 +85,7 @@ class Backward
     private:
         int32_t fft_size;
         DSPCOMPLEX *vector;
-        FFTW_PLAN plan;
+        FFTW_PLAN plan; // Shared, not owned
 };
 
 #else
@@ -90,7 +104,7 @@ class Forward
     private:
         int32_t fft_size;
 
-        kiss_fft_cfg cfg;
+        kiss_fft_cfg cfg; // Shared, not owned
         DSPCOMPLEX *fin;
         DSPCOMPLEX *fout;
 };
@@ -108,7 +122,7 @@ class Backward
     private:
         int32_t fft_size;
 
-        kiss_fft_cfg cfg;
+        kiss_fft_cfg cfg; // Shared, not owned
         DSPCOMPLEX *fin;
         DSPCOMPLEX *fout;
 };
@@ -24,8 +24,10 @@
  */
 
 #if defined(WITH_PROFILING)
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <map>
 #include <utility>
 #include <cmath>
@@ -40,6 +42,32 @@ Profiler& get_profiler() {
     return profiler;
 }
 
+// Time between two marks that is accumulated into a latency histogram
+struct StageDefinition {
+    const char *name;
+    ProfilingMark from;
+    ProfilingMark to;
+};
+
+static const StageDefinition stage_definitions[] = {
+    {"DataSymbols", ProfilingMark::DataSymbols, ProfilingMark::PushAllSymbols},
+    {"NullSymbol", ProfilingMark::DecodeTII, ProfilingMark::OnNewNull},
+    {"OFDMSymbol", ProfilingMark::ProcessSymbol, ProfilingMark::SymbolProcessed},
+    {"FICBlock", ProfilingMark::FICHandler, ProfilingMark::SymbolProcessed},
+    {"MSCBlock", ProfilingMark::MSCHandler, ProfilingMark::SymbolProcessed},
+    {"AudioFrame", ProfilingMark::DAGetMSCData, ProfilingMark::DADone},
+    {"AudioDeconvolve", ProfilingMark::DADeconvolve, ProfilingMark::DADispersal},
+    {"AudioDecode", ProfilingMark::DADecode, ProfilingMark::DADone},
+};
+
+static const auto aggregation_interval = chrono::milliseconds(250);
+
+// In the trace, threads get small tids counted from 1, and tracks are
+// shown as threads with a tid above this offset
+static const int track_tid_offset = 1000;
+
+static thread_local uint32_t current_track = 0;
+
 #define MARK_TO_CSTR_CASE(m) case ProfilingMark::m: return #m;
 const char* mark_to_cstr(const ProfilingMark& m) {
     switch (m) {
@@ -70,11 +98,6 @@ const char* mark_to_cstr(const ProfilingMark& m) {
     return "unknown";
 }
 
-Profiler::Profiler() {
-    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &startup_time_cputime);
-    clock_gettime(CLOCK_MONOTONIC, &startup_time_monotonic);
-}
-
 struct timespec& operator+=(struct timespec& t1, const struct timespec& t2) {
     t1.tv_sec += t2.tv_sec;
     t1.tv_nsec += t2.tv_nsec;
@@ -116,31 +139,393 @@ std::ostream& operator<<(std::ostream& out, const struct timespec& ts)
     return out << ts.tv_sec << "." << nanos;
 }
 
+static uint64_t now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void LatencyHistogram::add(uint64_t ns)
+{
+    size_t bucket = 0;
+    for (uint64_t us = ns / 1000; us > 0 and bucket + 1 < num_buckets; us >>= 1) {
+        bucket++;
+    }
+    buckets[bucket]++;
+
+    if (count == 0 or ns < min_ns) {
+        min_ns = ns;
+    }
+    if (ns > max_ns) {
+        max_ns = ns;
+    }
+    count++;
+    sum_ns += ns;
+}
+
+uint64_t LatencyHistogram::bucket_start_ns(size_t bucket)
+{
+    return bucket == 0 ? 0 : (1000ull << (bucket - 1));
+}
+
+uint64_t LatencyHistogram::quantile_ns(double q) const
+{
+    const uint64_t rank = (uint64_t)ceil(q * count);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < num_buckets; b++) {
+        seen += buckets[b];
+        if (seen >= rank and seen > 0) {
+            return b + 1 < num_buckets ? std::min(bucket_start_ns(b + 1), max_ns) : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+static string json_string(const string& str)
+{
+    string escaped = "\"";
+    for (char c : str) {
+        if (c == '"' or c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+static string trace_timestamp(uint64_t ns)
+{
+    char ts[32];
+    snprintf(ts, sizeof(ts), "%.3f", ns / 1000.0);
+    return ts;
+}
+
+// Marks that start or end a stage are shown as part of the span
+static bool is_stage_mark(ProfilingMark m)
+{
+    for (const auto& def : stage_definitions) {
+        if (def.from == m or def.to == m) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ProfilingTrack::ProfilingTrack(const char *name, int index) :
+    m_previous(current_track)
+{
+    current_track = get_profiler().track_id(name, index);
+}
+
+ProfilingTrack::~ProfilingTrack()
+{
+    current_track = m_previous;
+}
+
+bool ProfilingBuffer::push(const Event& event)
+{
+    const uint64_t head = m_head.load(memory_order_relaxed);
+    if (head - m_tail.load(memory_order_acquire) == capacity) {
+        return false;
+    }
+
+    m_events[head % capacity] = event;
+    m_head.store(head + 1, memory_order_release);
+    return true;
+}
+
+size_t ProfilingBuffer::pop(std::vector<Event>& out)
+{
+    const uint64_t tail = m_tail.load(memory_order_relaxed);
+    const uint64_t head = m_head.load(memory_order_acquire);
+
+    for (uint64_t i = tail; i < head; i++) {
+        out.push_back(m_events[i % capacity]);
+    }
+
+    m_tail.store(head, memory_order_release);
+    return head - tail;
+}
+
+Profiler::Profiler() {
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &startup_time_cputime);
+    clock_gettime(CLOCK_MONOTONIC, &startup_time_monotonic);
+
+    for (const auto& def : stage_definitions) {
+        ProfilingSnapshot::Stage stage;
+        stage.name = def.name;
+        stage.from = def.from;
+        stage.to = def.to;
+        m_stages.push_back(stage);
+    }
+
+    m_thread = thread(&Profiler::run, this);
+}
+
 Profiler::~Profiler() {
-    struct timespec stop_time_cputime;
-    struct timespec stop_time_monotonic;
-    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &stop_time_cputime);
-    clock_gettime(CLOCK_MONOTONIC, &stop_time_monotonic);
-
-    ofstream dump("profiling_points.csv");
-    dump << "thread_id,mark,time_sec,time_ns" << endl;
-    for (const auto tp: m_timepoints) {
-        for (const auto points : tp.second) {
-            dump << tp.first << "," <<
-                mark_to_cstr(points.p) << "," <<
-                points.timestamp.tv_sec << "," <<
-                points.timestamp.tv_nsec << endl;
+    {
+        lock_guard<mutex> lock(m_run_mutex);
+        m_running = false;
+    }
+    m_run_cv.notify_all();
+    m_thread.join();
+
+    write_report();
+    stop_trace();
+}
+
+ProfilingBuffer& Profiler::thread_buffer() {
+    // The profiler keeps the buffer alive after the thread exits, so that
+    // its last events still get aggregated
+    thread_local shared_ptr<ProfilingBuffer> buffer;
+
+    if (not buffer) {
+        buffer = make_shared<ProfilingBuffer>(this_thread::get_id());
+        lock_guard<mutex> lock(m_buffers_mutex);
+        m_new_buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void Profiler::save_time(const ProfilingMark m) {
+    if (not thread_buffer().push({now_ns(), m, current_track})) {
+        m_num_dropped_events.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void Profiler::frame_decoded() {
+    m_num_frames_decoded.fetch_add(1, memory_order_relaxed);
+}
+
+void Profiler::set_thread_name(const std::string& name) {
+    auto& buffer = thread_buffer();
+    lock_guard<mutex> lock(m_buffers_mutex);
+    buffer.name = name;
+}
+
+uint32_t Profiler::track_id(const char *name, int index) {
+    lock_guard<mutex> lock(m_buffers_mutex);
+    const auto key = make_pair(string(name), index);
+    auto it = m_tracks.find(key);
+    if (it != m_tracks.end()) {
+        return it->second;
+    }
+
+    m_track_names.push_back(key.first + " " + to_string(index));
+    const uint32_t id = m_track_names.size();
+    m_tracks.emplace(key, id);
+    return id;
+}
+
+bool Profiler::start_trace(const std::string& filename,
+        std::chrono::seconds duration) {
+    lock_guard<mutex> lock(m_aggregate_mutex);
+    close_trace();
+
+    m_trace.open(filename);
+    if (not m_trace) {
+        m_trace.close();
+        return false;
+    }
+
+    m_trace_start_ns = now_ns();
+    m_trace_end_ns = duration.count() == 0 ? 0 :
+        m_trace_start_ns + chrono::duration_cast<chrono::nanoseconds>(duration).count();
+    m_trace_tids.clear();
+
+    // The closing bracket is optional in this format, which keeps the
+    // trace readable if the process gets killed
+    m_trace << "[\n{\"pid\":1,\"name\":\"process_name\",\"ph\":\"M\","
+        "\"args\":{\"name\":\"welle.io\"}}";
+    return true;
+}
+
+void Profiler::stop_trace() {
+    lock_guard<mutex> lock(m_aggregate_mutex);
+    aggregate();
+    close_trace();
+}
+
+int Profiler::trace_tid(size_t thread_index, uint32_t track) const {
+    return track == 0 ? thread_index + 1 : track_tid_offset + track;
+}
+
+bool Profiler::trace_thread_name(int tid) {
+    const string& name = tid > track_tid_offset ?
+        m_aggregate_track_names[tid - track_tid_offset - 1] :
+        m_threads[tid - 1].name;
+
+    if (name.empty()) {
+        return false;
+    }
+
+    m_trace << ",\n{\"pid\":1,\"tid\":" << tid <<
+        ",\"name\":\"thread_name\",\"ph\":\"M\",\"args\":{\"name\":" <<
+        json_string(name) << "}}";
+    return true;
+}
+
+void Profiler::trace_event(int tid, const std::string& json) {
+    auto& named = m_trace_tids[tid];
+    if (not named) {
+        named = trace_thread_name(tid);
+    }
+
+    m_trace << ",\n{\"pid\":1,\"tid\":" << tid << "," << json << "}";
+}
+
+void Profiler::close_trace() {
+    if (not m_trace.is_open()) {
+        return;
+    }
+
+    // Threads that got their name after their first event
+    for (auto& tid : m_trace_tids) {
+        if (not tid.second) {
+            tid.second = trace_thread_name(tid.first);
         }
     }
 
+    m_trace << "\n]\n";
+    m_trace.close();
+}
+
+void Profiler::aggregate() {
+    {
+        lock_guard<mutex> lock(m_buffers_mutex);
+        for (auto& buffer : m_new_buffers) {
+            ThreadState state;
+            state.buffer = move(buffer);
+            m_threads.push_back(move(state));
+        }
+        m_new_buffers.clear();
+
+        for (auto& state : m_threads) {
+            state.name = state.buffer->name;
+        }
+        m_aggregate_track_names = m_track_names;
+    }
+
+    const bool tracing = m_trace.is_open();
+
+    for (size_t i = 0; i < m_threads.size(); i++) {
+        auto& state = m_threads[i];
+        m_events.clear();
+        m_num_events += state.buffer->pop(m_events);
+
+        for (const auto& event : m_events) {
+            const bool traced = tracing and
+                event.time_ns >= m_trace_start_ns and
+                (m_trace_end_ns == 0 or event.time_ns < m_trace_end_ns);
+            const int tid = trace_tid(i, event.track);
+
+            if (state.has_last) {
+                state.transitions_ns[make_pair(state.last.mark, event.mark)] +=
+                    event.time_ns - state.last.time_ns;
+            }
+            state.has_last = true;
+            state.last = event;
+
+            // Stages are measured from the latest start mark seen by the
+            // same thread
+            for (auto& stage : m_stages) {
+                auto& from_time = state.last_time_ns[(size_t)stage.from];
+                if (stage.to == event.mark and from_time != 0) {
+                    stage.latency.add(event.time_ns - from_time);
+
+                    if (traced and from_time >= m_trace_start_ns) {
+                        trace_event(tid, "\"name\":" + json_string(stage.name) +
+                                ",\"cat\":\"stage\",\"ph\":\"X\",\"ts\":" +
+                                trace_timestamp(from_time - m_trace_start_ns) +
+                                ",\"dur\":" + trace_timestamp(event.time_ns - from_time));
+                    }
+                }
+            }
+            for (auto& stage : m_stages) {
+                if (stage.to == event.mark) {
+                    state.last_time_ns[(size_t)stage.from] = 0;
+                }
+            }
+            state.last_time_ns[(size_t)event.mark] = event.time_ns;
+
+            if (traced and not is_stage_mark(event.mark)) {
+                trace_event(tid, "\"name\":" + json_string(mark_to_cstr(event.mark)) +
+                        ",\"cat\":\"mark\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" +
+                        trace_timestamp(event.time_ns - m_trace_start_ns));
+            }
+        }
+    }
+
+    if (tracing and m_trace_end_ns != 0 and now_ns() >= m_trace_end_ns) {
+        close_trace();
+    }
+}
+
+ProfilingSnapshot Profiler::snapshot() {
+    ProfilingSnapshot snap;
+
+    lock_guard<mutex> lock(m_aggregate_mutex);
+    aggregate();
+
+    snap.stages = m_stages;
+    for (const auto& state : m_threads) {
+        ProfilingSnapshot::Thread t;
+        stringstream ss;
+        ss << state.buffer->thread_id;
+        t.id = ss.str();
+        t.name = state.name;
+        t.transitions_ns = state.transitions_ns;
+        snap.threads.push_back(move(t));
+    }
+
+    snap.num_events = m_num_events;
+    snap.num_dropped_events = m_num_dropped_events.load();
+    snap.num_frames_decoded = m_num_frames_decoded.load();
+
+    struct timespec cputime;
+    struct timespec monotonic;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cputime);
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    snap.cputime = cputime - startup_time_cputime;
+    snap.monotonic = monotonic - startup_time_monotonic;
+
+    return snap;
+}
+
+void Profiler::run() {
+    unique_lock<mutex> lock(m_run_mutex);
+    while (m_running) {
+        m_run_cv.wait_for(lock, aggregation_interval);
+
+        lock_guard<mutex> aggregate_lock(m_aggregate_mutex);
+        aggregate();
+    }
+}
+
+void Profiler::write_report() {
+    const auto snap = snapshot();
+
     ofstream profiling("profiling_stats.csv");
     profiling << "cputime,start," << startup_time_cputime << endl;
-    profiling << "cputime,stop," << stop_time_cputime << endl;
     profiling << "monotonic,start," << startup_time_monotonic << endl;
-    profiling << "monotonic,stop," << stop_time_monotonic << endl;
-    profiling << "cputime,diff," << stop_time_cputime - startup_time_cputime << endl;
-    profiling << "monotonic,diff," << stop_time_monotonic - startup_time_monotonic << endl;
-    profiling << "frames,decoded," << num_frames_decoded << endl;
+    profiling << "cputime,diff," << snap.cputime << endl;
+    profiling << "monotonic,diff," << snap.monotonic << endl;
+    profiling << "frames,decoded," << snap.num_frames_decoded << endl;
+    profiling << "events,recorded," << snap.num_events << endl;
+    profiling << "events,dropped," << snap.num_dropped_events << endl;
+
+    ofstream latency("profiling_latency.csv");
+    latency << "stage,count,mean_us,min_us,p50_us,p99_us,max_us" << endl;
+    for (const auto& stage : snap.stages) {
+        const auto& h = stage.latency;
+        latency << stage.name << "," << h.count << "," <<
+            (h.count ? h.sum_ns / h.count / 1000.0 : 0.0) << "," <<
+            h.min_ns / 1000.0 << "," <<
+            h.quantile_ns(0.5) / 1000.0 << "," <<
+            h.quantile_ns(0.99) / 1000.0 << "," <<
+            h.max_ns / 1000.0 << endl;
+    }
 
     // See http://www.graphviz.org/documentation/
     ofstream graph("profiling.dot");
@@ -149,33 +534,29 @@ Profiler::~Profiler() {
 
     size_t count = 0;
 
-    for (const auto tp: m_timepoints) {
-        if (tp.second.size() < 2) {
+    for (const auto& t : snap.threads) {
+        if (t.transitions_ns.empty()) {
             continue;
         }
 
-        graph << "subgraph cluster_" << tp.first << " { " << endl;
+        graph << "subgraph cluster_" << count << " { " << endl;
+        graph << "label=\"thread " << (t.name.empty() ? t.id : t.name) << "\";" << endl;
         graph << "colorscheme=\"gnbu8\";" << endl;
         graph << "bgcolor=" << (count % 8) + 1 << ";" << endl;
         count++;
 
-        map<pair<ProfilingMark, ProfilingMark>, struct timespec> from_to_times;
-
-        for (auto it = tp.second.begin(); next(it) != tp.second.end(); ++it) {
-            from_to_times[make_pair(it->p, next(it)->p)] += next(it)->timestamp - it->timestamp;
-        }
-
         double maxw = 0;
-        for (auto& d : from_to_times) {
-            double w = log10(1 + d.second.tv_sec * 1000 + d.second.tv_nsec / 1000000);
+        for (auto& d : t.transitions_ns) {
+            double w = log10(1 + d.second / 1000000);
             if (w > maxw) maxw = w;
         }
 
-        for (auto& d : from_to_times) {
-            int w = (d.second.tv_sec * 1000 + d.second.tv_nsec / 1000000);
+        for (auto& d : t.transitions_ns) {
+            int w = d.second / 1000000;
 
             char color[16];
-            snprintf(color, 15, "#%02x%02x%02x", (int)(255 * log10(w+1)/maxw), 0, 0);
+            snprintf(color, 15, "#%02x%02x%02x",
+                    maxw > 0 ? (int)(255 * log10(w+1)/maxw) : 0, 0, 0);
 
             graph << mark_to_cstr(d.first.first) << " -> " << mark_to_cstr(d.first.second) <<
                 " [color=\"" << color << "\""
@@ -187,18 +568,4 @@ Profiler::~Profiler() {
     graph << "}" << endl;
 }
 
-void Profiler::save_time(const ProfilingMark m) {
-    const auto id = this_thread::get_id();
-
-    struct timespec now;
-    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
-
-    lock_guard<mutex> lock(m_mutex);
-    m_timepoints[id].emplace_back(now, m);
-}
-
-void Profiler::frame_decoded() {
-    num_frames_decoded++;
-}
-
 #endif // defined(WITH_PROFILING)
@@ -24,17 +24,29 @@
  */
 
 
+#pragma once
+
 #if defined(WITH_PROFILING)
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <ctime>
-#include <list>
-#include <unordered_map>
-#include <thread>
+#include <fstream>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #define PROFILE(m) get_profiler().save_time(ProfilingMark::m)
 #define PROFILE_FRAME_DECODED() get_profiler().frame_decoded()
+#define PROFILE_THREAD_NAME(name) get_profiler().set_thread_name(name)
+#define PROFILE_TRACK(name, index) ProfilingTrack profiling_track_(name, index)
 
 enum class ProfilingMark {
     NotSynced,
@@ -61,17 +73,121 @@ enum class ProfilingMark {
     DADone,
 };
 
-struct ProfilingTimepoint {
-    ProfilingTimepoint(
-            struct timespec timestamp,
-            ProfilingMark p) :
-        timestamp(timestamp),
-        p(p) { }
+constexpr size_t NUM_PROFILING_MARKS =
+    static_cast<size_t>(ProfilingMark::DADone) + 1;
+
+const char* mark_to_cstr(const ProfilingMark& m);
+
+/* Distribution of latencies, with one bucket per power of two
+ * microseconds. Bucket 0 holds everything below 1us.
+ */
+struct LatencyHistogram {
+    static constexpr size_t num_buckets = 24;
+
+    std::array<uint64_t, num_buckets> buckets = {};
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t min_ns = 0;
+    uint64_t max_ns = 0;
+
+    void add(uint64_t ns);
+
+    // Upper limit of the bucket that contains the quantile q
+    uint64_t quantile_ns(double q) const;
+
+    // Lower limit of a bucket
+    static uint64_t bucket_start_ns(size_t bucket);
+};
+
+/* Aggregated measurements, see Profiler::snapshot() */
+struct ProfilingSnapshot {
+    struct Stage {
+        std::string name;
+        ProfilingMark from;
+        ProfilingMark to;
+        LatencyHistogram latency;
+    };
+
+    struct Thread {
+        std::string id;
+        std::string name;
+
+        // Time between consecutive marks
+        std::map<std::pair<ProfilingMark, ProfilingMark>, uint64_t> transitions_ns;
+    };
+
+    std::vector<Stage> stages;
+    std::vector<Thread> threads;
+
+    uint64_t num_events = 0;
+    uint64_t num_dropped_events = 0;
+    size_t num_frames_decoded = 0;
+
+    struct timespec cputime;
+    struct timespec monotonic;
+};
+
+/* Events of one thread, written by that thread only and read by the
+ * aggregation. When the aggregation does not keep up, new events are
+ * dropped and counted.
+ */
+class ProfilingBuffer {
+    public:
+        struct Event {
+            uint64_t time_ns;
+            ProfilingMark mark;
+            uint32_t track; // 0 for the thread itself
+        };
+
+        static constexpr size_t capacity = 8192;
+
+        explicit ProfilingBuffer(std::thread::id thread_id) :
+            thread_id(thread_id) {}
+        ProfilingBuffer(const ProfilingBuffer&) = delete;
+        ProfilingBuffer& operator=(const ProfilingBuffer&) = delete;
+
+        // Returns false if the buffer is full
+        bool push(const Event& event);
+
+        // Move all events to out, returns their number
+        size_t pop(std::vector<Event>& out);
+
+        const std::thread::id thread_id;
+
+        // Protected by the m_buffers_mutex of the Profiler
+        std::string name;
+
+    private:
+        std::array<Event, capacity> m_events;
+        std::atomic<uint64_t> m_head = ATOMIC_VAR_INIT(0);
+        std::atomic<uint64_t> m_tail = ATOMIC_VAR_INIT(0);
+};
+
+/* Attributes the marks of the current thread to a track of their own
+ * while in scope, e.g. for tasks that run on a worker pool. Tracks with
+ * the same name and index are shown as one thread in the trace.
+ */
+class ProfilingTrack {
+    public:
+        ProfilingTrack(const char *name, int index);
+        ~ProfilingTrack();
+        ProfilingTrack(const ProfilingTrack&) = delete;
+        ProfilingTrack& operator=(const ProfilingTrack&) = delete;
 
-    struct timespec timestamp;
-    ProfilingMark p;
+    private:
+        uint32_t m_previous;
 };
 
+/* The profiler records marks into lock-free per-thread buffers. A
+ * background thread empties them four times per second, and accumulates
+ * the time between marks into latency histograms for the stages of the
+ * decoder, so that memory use stays constant however long the receiver
+ * runs. A report is written to the working directory on destruction.
+ *
+ * The marks can also be streamed to a file in the Chrome trace event
+ * format, to be loaded into chrome://tracing or Perfetto. The stages
+ * appear as spans, the other marks as instant events.
+ */
 class Profiler
 {
     public:
@@ -82,15 +198,74 @@ class Profiler
 
         void save_time(const ProfilingMark m);
         void frame_decoded();
+
+        // Name the calling thread in the trace
+        void set_thread_name(const std::string& name);
+
+        // Identifier of the track with the given name and index,
+        // see ProfilingTrack
+        uint32_t track_id(const char *name, int index);
+
+        // Write all marks to filename until stop_trace() is called, or
+        // for the given duration if it is not zero. Returns false if the
+        // file cannot be opened.
+        bool start_trace(const std::string& filename,
+                std::chrono::seconds duration);
+        void stop_trace();
+
+        // Aggregate the pending events and return all measurements
+        // since startup
+        ProfilingSnapshot snapshot();
+
     private:
-        std::mutex m_mutex;
-        std::unordered_map<
-            std::thread::id,
-            std::list<ProfilingTimepoint> > m_timepoints;
+        struct ThreadState {
+            std::shared_ptr<ProfilingBuffer> buffer;
+            std::string name;
+            bool has_last = false;
+            ProfilingBuffer::Event last;
+            std::array<uint64_t, NUM_PROFILING_MARKS> last_time_ns = {};
+            std::map<std::pair<ProfilingMark, ProfilingMark>, uint64_t> transitions_ns;
+        };
+
+        ProfilingBuffer& thread_buffer();
+        void aggregate();
+        void write_report();
+        void run();
+
+        // Trace output, called with m_aggregate_mutex held
+        int trace_tid(size_t thread_index, uint32_t track) const;
+        bool trace_thread_name(int tid);
+        void trace_event(int tid, const std::string& json);
+        void close_trace();
+
+        std::mutex m_buffers_mutex;
+        std::vector<std::shared_ptr<ProfilingBuffer> > m_new_buffers;
+        std::map<std::pair<std::string, int>, uint32_t> m_tracks;
+        std::vector<std::string> m_track_names;
+
+        // Protected by m_aggregate_mutex
+        std::mutex m_aggregate_mutex;
+        std::vector<ThreadState> m_threads;
+        std::vector<ProfilingSnapshot::Stage> m_stages;
+        std::vector<ProfilingBuffer::Event> m_events;
+        uint64_t m_num_events = 0;
+
+        std::vector<std::string> m_aggregate_track_names;
+        std::ofstream m_trace;
+        uint64_t m_trace_start_ns = 0;
+        uint64_t m_trace_end_ns = 0; // 0 to trace until stopped
+        std::map<int, bool> m_trace_tids; // Whether the name was written
+
+        std::atomic<uint64_t> m_num_dropped_events = ATOMIC_VAR_INIT(0);
+        std::atomic<size_t> m_num_frames_decoded = ATOMIC_VAR_INIT(0);
 
         struct timespec startup_time_cputime;
         struct timespec startup_time_monotonic;
-        size_t num_frames_decoded = 0;
+
+        std::mutex m_run_mutex;
+        std::condition_variable m_run_cv;
+        bool m_running = true;
+        std::thread m_thread;
 };
 
 Profiler& get_profiler(void);
@@ -98,5 +273,7 @@ Profiler& get_profiler(void);
 #else
 # define PROFILE(m)
 # define PROFILE_FRAME_DECODED()
+# define PROFILE_THREAD_NAME(name)
+# define PROFILE_TRACK(name, index)
 #endif // defined(WITH_PROFILING)
 
@@ -0,0 +1,132 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include "workerpool.h"
+
+// Index of the queue belonging to the worker running on this thread
+static thread_local size_t own_queue = SIZE_MAX;
+static thread_local const WorkerPool *own_pool = nullptr;
+
+WorkerPool::WorkerPool(size_t num_workers)
+{
+    if (num_workers == 0) {
+        num_workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < num_workers; i++) {
+        queues.emplace_back(new TaskQueue());
+    }
+
+    for (size_t i = 0; i < num_workers; i++) {
+        workers.emplace_back(&WorkerPool::worker, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        running = false;
+    }
+    wake.notify_all();
+
+    for (auto& t : workers) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+void WorkerPool::submit(std::function<void()>&& task)
+{
+    const size_t index = (own_pool == this) ?
+        own_queue : next_queue++ % queues.size();
+
+    // Count the task before it can be popped, so that the decrement of
+    // the worker running it never comes first
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        num_pending++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+bool WorkerPool::pop_task(size_t index, std::function<void()>& task)
+{
+    // Own queue first, oldest task first
+    {
+        auto& q = *queues[index];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (not q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // then steal the newest task of somebody else
+    for (size_t i = 1; i < queues.size(); i++) {
+        auto& q = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (not q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::worker(size_t index)
+{
+    own_queue = index;
+    own_pool = this;
+
+    while (true) {
+        std::function<void()> task;
+        if (pop_task(index, task)) {
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex);
+                num_pending--;
+            }
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        wake.wait(lock, [&]() { return not running or num_pending > 0; });
+        if (not running) {
+            break;
+        }
+    }
+}
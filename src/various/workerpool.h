@@ -0,0 +1,80 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __WORKER_POOL
+#define __WORKER_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A fixed-size pool of worker threads. Every worker has its own task
+ * queue; a worker that runs out of work steals from the back of the
+ * other queues. Tasks submitted from inside a worker go to the queue of
+ * that worker, others are distributed round-robin.
+ *
+ * The pool does not order tasks, users that need ordering (e.g. the
+ * CIFs of one subchannel) must make sure they only have one task in
+ * flight at any time. Tasks still queued when the pool is destroyed
+ * are discarded.
+ */
+class WorkerPool
+{
+    public:
+        // num_workers == 0 means one worker per core
+        explicit WorkerPool(size_t num_workers = 0);
+        ~WorkerPool();
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        void submit(std::function<void()>&& task);
+
+        size_t size(void) const { return workers.size(); }
+
+    private:
+        struct TaskQueue {
+            std::mutex mutex;
+            std::deque<std::function<void()> > tasks;
+        };
+
+        void worker(size_t index);
+        bool pop_task(size_t index, std::function<void()>& task);
+
+        std::vector<std::unique_ptr<TaskQueue> > queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next_queue = ATOMIC_VAR_INIT(0);
+
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+        size_t num_pending = 0;
+        bool running = true;
+};
+
+#endif
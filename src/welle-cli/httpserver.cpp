@@ -0,0 +1,868 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "welle-cli/httpserver.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+# define HAVE_EPOLL 1
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+#else
+# define HAVE_EPOLL 0
+# include <poll.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+using namespace std;
+
+constexpr size_t HttpConnection::max_backlog;
+constexpr size_t HttpConnection::low_water;
+constexpr chrono::milliseconds HttpServer::poll_interval;
+
+// Limits on what a client may send us
+static const size_t max_header_size = 64 * 1024;
+static const size_t max_content_length = 1024 * 1024;
+
+static bool set_nonblocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 and fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+static string trim(const string& str)
+{
+    const auto first = str.find_first_not_of(" \t");
+    if (first == string::npos) {
+        return "";
+    }
+    const auto last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+static string to_lower(string str)
+{
+    transform(str.begin(), str.end(), str.begin(),
+            [](unsigned char c) { return tolower(c); });
+    return str;
+}
+
+HttpConnection::HttpConnection(HttpServer& server, int fd) :
+    m_server(&server),
+    m_fd(fd)
+{
+}
+
+ssize_t HttpConnection::send(const void *buffer, size_t length, int /*flags*/)
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_close_requested) {
+        return -1;
+    }
+
+    const char *data = reinterpret_cast<const char*>(buffer);
+
+    switch (m_state) {
+        case State::Handling:
+            m_response.append(data, length);
+            break;
+        case State::Streaming:
+            if (m_backlog + length > max_backlog) {
+                cerr << "HTTP client does not keep up, dropping it" << endl;
+                m_close_requested = true;
+                schedule();
+                return -1;
+            }
+            enqueue(make_shared<const vector<uint8_t> >(data, data + length));
+            break;
+        default:
+            // Nobody asked for this data
+            return -1;
+    }
+
+    return length;
+}
+
+ssize_t HttpConnection::send(chunk_t chunk)
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_close_requested) {
+        return -1;
+    }
+
+    const size_t length = chunk->size();
+
+    switch (m_state) {
+        case State::Handling:
+            m_response.append(chunk->begin(), chunk->end());
+            break;
+        case State::Streaming:
+            if (m_backlog + length > max_backlog) {
+                cerr << "HTTP client does not keep up, dropping it" << endl;
+                m_close_requested = true;
+                schedule();
+                return -1;
+            }
+            enqueue(move(chunk));
+            break;
+        default:
+            return -1;
+    }
+
+    return length;
+}
+
+static HttpConnection::chunk_t to_chunk(const string& data)
+{
+    return make_shared<const vector<uint8_t> >(data.begin(), data.end());
+}
+
+void HttpConnection::start_stream()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_state != State::Handling) {
+        return;
+    }
+
+    m_state = State::Streaming;
+    m_keep_alive = false;
+    enqueue(to_chunk(m_response));
+    m_response.clear();
+    schedule();
+}
+
+void HttpConnection::set_source(function<bool(HttpConnection&)>&& refill)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_source = make_shared<function<bool(HttpConnection&)> >(move(refill));
+    schedule();
+}
+
+void HttpConnection::on_close(function<void()>&& handler)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_state != State::Closed) {
+            m_close_handlers.push_back(move(handler));
+            return;
+        }
+    }
+    handler();
+}
+
+void HttpConnection::close()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_state != State::Closed) {
+        m_close_requested = true;
+        schedule();
+    }
+}
+
+bool HttpConnection::closed() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_state == State::Closed or m_close_requested;
+}
+
+size_t HttpConnection::backlog() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_backlog;
+}
+
+void HttpConnection::finish_response()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_state != State::Handling) {
+        return;
+    }
+
+    // The handlers write HTTP/1.0 responses that end when the connection
+    // is closed. To keep the connection, the client needs to know the
+    // length of the body.
+    const auto header_end = m_response.find("\r\n\r\n");
+    if (header_end == string::npos) {
+        m_keep_alive = false;
+    }
+
+    if (m_keep_alive) {
+        const size_t content_length = m_response.size() - header_end - 4;
+        const size_t status_end = m_response.find("\r\n") + 2;
+        m_response.insert(status_end,
+                "Connection: keep-alive\r\n"
+                "Content-Length: " + to_string(content_length) + "\r\n");
+    }
+
+    m_state = State::Flushing;
+    enqueue(to_chunk(m_response));
+    m_response.clear();
+    schedule();
+}
+
+void HttpConnection::enqueue(chunk_t chunk)
+{
+    if (chunk->empty()) {
+        return;
+    }
+    m_backlog += chunk->size();
+    m_queue.push_back(move(chunk));
+    schedule();
+}
+
+void HttpConnection::schedule()
+{
+    if (not m_scheduled and m_server) {
+        m_scheduled = true;
+        m_server->schedule(shared_from_this());
+    }
+}
+
+HttpServer::HttpServer(Handler&& handler, size_t num_workers) :
+    m_handler(move(handler)),
+    m_notifier(make_shared<notifier_t>()),
+    m_pool(num_workers)
+{
+#if HAVE_EPOLL
+    m_poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_poll_fd == -1) {
+        throw runtime_error(string("Cannot create epoll: ") + strerror(errno));
+    }
+
+    m_wake_read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wake_read_fd == -1) {
+        throw runtime_error(string("Cannot create eventfd: ") + strerror(errno));
+    }
+    m_wake_write_fd = m_wake_read_fd;
+#else
+    int fds[2];
+    if (pipe(fds) == -1) {
+        throw runtime_error(string("Cannot create pipe: ") + strerror(errno));
+    }
+    m_wake_read_fd = fds[0];
+    m_wake_write_fd = fds[1];
+    set_nonblocking(m_wake_read_fd);
+    set_nonblocking(m_wake_write_fd);
+#endif
+
+    m_notifier->fd = m_wake_write_fd;
+    watch(m_wake_read_fd, false);
+}
+
+HttpServer::~HttpServer()
+{
+    // The worker pool would discard the close handlers, run them here
+    m_stopping = true;
+    {
+        lock_guard<mutex> lock(m_notifier->mutex);
+        m_notifier->fd = -1;
+    }
+
+    auto connections = m_connections;
+    for (auto& c : connections) {
+        close_connection(c.second);
+    }
+
+    if (m_listen_fd != -1) {
+        ::close(m_listen_fd);
+    }
+
+    ::close(m_wake_read_fd);
+    if (m_wake_write_fd != m_wake_read_fd) {
+        ::close(m_wake_write_fd);
+    }
+
+    if (m_poll_fd != -1) {
+        ::close(m_poll_fd);
+    }
+}
+
+bool HttpServer::listen(int port)
+{
+    const int fd = ::socket(PF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        perror("Could not create socket");
+        return false;
+    }
+
+    int reuse = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1) {
+        perror("Can't reuse address");
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = PF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+        perror("Could not bind socket");
+        ::close(fd);
+        return false;
+    }
+
+    if (::listen(fd, 64) == -1 or not set_nonblocking(fd)) {
+        perror("Could not listen");
+        ::close(fd);
+        return false;
+    }
+
+    m_listen_fd = fd;
+    watch(m_listen_fd, false);
+    return true;
+}
+
+void HttpServer::run(const function<bool()>& keep_running)
+{
+    using namespace chrono;
+
+    vector<event_t> events;
+    auto last_poll = steady_clock::now();
+
+    while (keep_running()) {
+        wait(events, poll_interval.count());
+
+        for (const auto& ev : events) {
+            if (ev.fd == m_listen_fd) {
+                accept_clients();
+                continue;
+            }
+            else if (ev.fd == m_wake_read_fd) {
+                uint64_t buf;
+                while (::read(m_wake_read_fd, &buf, sizeof(buf)) > 0) {
+                }
+                continue;
+            }
+
+            auto it = m_connections.find(ev.fd);
+            if (it == m_connections.end()) {
+                continue;
+            }
+            auto c = it->second;
+
+            if (ev.error) {
+                close_connection(c);
+                continue;
+            }
+
+            if (ev.readable) {
+                receive(c);
+            }
+
+            if (ev.writable) {
+                service(c);
+            }
+        }
+
+        // Connections that got data or changed state in another thread
+        vector<shared_ptr<HttpConnection> > ready;
+        {
+            lock_guard<mutex> lock(m_ready_mutex);
+            ready.swap(m_ready);
+        }
+
+        for (auto& c : ready) {
+            {
+                lock_guard<mutex> lock(c->m_mutex);
+                c->m_scheduled = false;
+            }
+            service(c);
+        }
+
+        // Give streams that pull their data a chance to look for more
+        const auto now = steady_clock::now();
+        if (m_notifier->pending.exchange(false) or now - last_poll >= poll_interval) {
+            last_poll = now;
+
+            vector<shared_ptr<HttpConnection> > sources;
+            for (auto& c : m_connections) {
+                lock_guard<mutex> lock(c.second->m_mutex);
+                if (c.second->m_source) {
+                    sources.push_back(c.second);
+                }
+            }
+
+            for (auto& c : sources) {
+                service(c);
+            }
+        }
+    }
+}
+
+function<void()> HttpServer::source_notifier()
+{
+    auto notifier = m_notifier;
+    return [notifier]() {
+        if (notifier->pending.exchange(true)) {
+            // The event loop has not seen the previous notification yet
+            return;
+        }
+
+        lock_guard<mutex> lock(notifier->mutex);
+        if (notifier->fd != -1) {
+#if HAVE_EPOLL
+            const uint64_t one = 1;
+#else
+            const uint8_t one = 1;
+#endif
+            if (::write(notifier->fd, &one, sizeof(one)) == -1 and errno != EAGAIN) {
+                perror("Cannot wake HTTP server");
+            }
+        }
+    };
+}
+
+void HttpServer::watch(int fd, bool want_write)
+{
+#if HAVE_EPOLL
+    epoll_event ev = {};
+    ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    if (epoll_ctl(m_poll_fd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+        if (errno != ENOENT or epoll_ctl(m_poll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            perror("epoll_ctl");
+        }
+    }
+#else
+    m_watched[fd] = POLLIN | (want_write ? POLLOUT : 0);
+#endif
+}
+
+void HttpServer::unwatch(int fd)
+{
+#if HAVE_EPOLL
+    epoll_ctl(m_poll_fd, EPOLL_CTL_DEL, fd, nullptr);
+#else
+    m_watched.erase(fd);
+#endif
+}
+
+void HttpServer::wait(vector<event_t>& events, int timeout_ms)
+{
+    events.clear();
+
+#if HAVE_EPOLL
+    epoll_event evs[64];
+    const int n = epoll_wait(m_poll_fd, evs, 64, timeout_ms);
+    if (n == -1 and errno != EINTR) {
+        perror("epoll_wait");
+    }
+
+    for (int i = 0; i < n; i++) {
+        const auto e = evs[i].events;
+        events.push_back({evs[i].data.fd,
+                (e & EPOLLIN) != 0,
+                (e & EPOLLOUT) != 0,
+                (e & EPOLLERR) or ((e & EPOLLHUP) and not (e & EPOLLIN))});
+    }
+#else
+    vector<pollfd> fds;
+    for (const auto& w : m_watched) {
+        fds.push_back({w.first, w.second, 0});
+    }
+
+    const int n = poll(fds.data(), fds.size(), timeout_ms);
+    if (n == -1 and errno != EINTR) {
+        perror("poll");
+    }
+
+    for (size_t i = 0; n > 0 and i < fds.size(); i++) {
+        const auto e = fds[i].revents;
+        if (e) {
+            events.push_back({fds[i].fd,
+                    (e & POLLIN) != 0,
+                    (e & POLLOUT) != 0,
+                    (e & (POLLERR | POLLNVAL)) or ((e & POLLHUP) and not (e & POLLIN))});
+        }
+    }
+#endif
+}
+
+void HttpServer::schedule(const shared_ptr<HttpConnection>& connection)
+{
+    bool was_empty = false;
+    {
+        lock_guard<mutex> lock(m_ready_mutex);
+        was_empty = m_ready.empty();
+        m_ready.push_back(connection);
+    }
+
+    if (was_empty) {
+        wake();
+    }
+}
+
+void HttpServer::wake()
+{
+#if HAVE_EPOLL
+    const uint64_t one = 1;
+#else
+    const uint8_t one = 1;
+#endif
+    if (::write(m_wake_write_fd, &one, sizeof(one)) == -1 and errno != EAGAIN) {
+        perror("Cannot wake HTTP server");
+    }
+}
+
+void HttpServer::accept_clients()
+{
+    while (true) {
+        sockaddr_in remote_addr;
+        socklen_t remote_addr_len = sizeof(remote_addr);
+        const int fd = ::accept(m_listen_fd, (sockaddr*)&remote_addr, &remote_addr_len);
+        if (fd == -1) {
+            if (errno == EINTR or errno == ECONNABORTED) {
+                continue;
+            }
+            else if (errno != EAGAIN and errno != EWOULDBLOCK) {
+                perror("accept failed");
+            }
+            return;
+        }
+
+        if (not set_nonblocking(fd)) {
+            perror("Cannot make client socket non-blocking");
+            ::close(fd);
+            continue;
+        }
+
+        m_connections[fd] = make_shared<HttpConnection>(*this, fd);
+        watch(fd, false);
+    }
+}
+
+void HttpServer::receive(const shared_ptr<HttpConnection>& c)
+{
+    char buf[4096];
+    const ssize_t ret = ::recv(c->m_fd, buf, sizeof(buf), 0);
+
+    if (ret == 0) {
+        close_connection(c);
+        return;
+    }
+    else if (ret == -1) {
+        if (errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR) {
+            close_connection(c);
+        }
+        return;
+    }
+
+    HttpConnection::State state;
+    {
+        lock_guard<mutex> lock(c->m_mutex);
+        state = c->m_state;
+    }
+
+    // Streaming clients have nothing more to say
+    if (state == HttpConnection::State::Streaming) {
+        return;
+    }
+
+    c->m_input.append(buf, ret);
+    if (c->m_input.size() > max_header_size + max_content_length) {
+        cerr << "HTTP client sends too much data" << endl;
+        close_connection(c);
+        return;
+    }
+
+    if (state == HttpConnection::State::Reading) {
+        parse_request(c);
+    }
+}
+
+static void reject(HttpConnection& c, const string& status)
+{
+    const string response = "HTTP/1.0 " + status + "\r\n"
+        "Content-Type: text/plain\r\n\r\n" + status + "\r\n";
+    c.send(response.data(), response.size());
+}
+
+void HttpServer::parse_request(const shared_ptr<HttpConnection>& c)
+{
+    auto& input = c->m_input;
+
+    const auto header_end = input.find("\r\n\r\n");
+    bool valid = header_end != string::npos;
+    if (not valid and input.size() < max_header_size) {
+        return;
+    }
+
+    HttpRequest req;
+    string version;
+    size_t content_length = 0;
+
+    if (valid) {
+        size_t line_start = 0;
+        while (line_start < header_end) {
+            auto line_end = input.find("\r\n", line_start);
+            const string line = input.substr(line_start, line_end - line_start);
+            line_start = line_end + 2;
+
+            if (version.empty()) {
+                const auto sp1 = line.find(' ');
+                const auto sp2 = line.rfind(' ');
+                if (sp1 == string::npos or sp1 == sp2) {
+                    cerr << "Malformed request: " << line << endl;
+                    valid = false;
+                    break;
+                }
+
+                const string method = line.substr(0, sp1);
+                req.is_get = (method == "GET");
+                req.is_post = (method == "POST");
+                req.url = line.substr(sp1 + 1, sp2 - sp1 - 1);
+                version = line.substr(sp2 + 1);
+                continue;
+            }
+
+            const auto colon = line.find(':');
+            if (colon != string::npos) {
+                req.headers.emplace(trim(line.substr(0, colon)),
+                        trim(line.substr(colon + 1)));
+            }
+        }
+    }
+
+    string connection_header;
+    for (const auto& h : req.headers) {
+        const auto name = to_lower(h.first);
+        if (name == "connection") {
+            connection_header = to_lower(h.second);
+        }
+        else if (name == "content-length") {
+            try {
+                content_length = std::stoul(h.second);
+            }
+            catch (const exception&) {
+                cerr << "Cannot parse Content-Length: " << h.second << endl;
+                valid = false;
+            }
+
+            if (content_length > max_content_length) {
+                cerr << "Unreasonable Content-Length: " << content_length << endl;
+                valid = false;
+            }
+        }
+    }
+
+    if (valid and input.size() < header_end + 4 + content_length) {
+        // Wait for the body
+        return;
+    }
+
+    if (version == "HTTP/1.1") {
+        req.keep_alive = connection_header.find("close") == string::npos;
+    }
+    else {
+        req.keep_alive = connection_header.find("keep-alive") != string::npos;
+    }
+
+    if (not valid or not (req.is_get or req.is_post)) {
+        req.keep_alive = false;
+    }
+
+    {
+        lock_guard<mutex> lock(c->m_mutex);
+        c->m_state = HttpConnection::State::Handling;
+        c->m_keep_alive = req.keep_alive;
+    }
+
+    if (not valid or not (req.is_get or req.is_post)) {
+        reject(*c, valid ? "405 Method Not Allowed" : "400 Bad Request");
+        input.clear();
+        c->finish_response();
+        return;
+    }
+
+    req.post_data = input.substr(header_end + 4, content_length);
+    input.erase(0, header_end + 4 + content_length);
+
+    m_pool.submit([this, c, req]() {
+            try {
+                m_handler(c, req);
+            }
+            catch (const exception& e) {
+                cerr << "HTTP request " << req.url << " failed: " << e.what() << endl;
+                c->close();
+                return;
+            }
+            c->finish_response();
+        });
+}
+
+void HttpServer::service(const shared_ptr<HttpConnection>& c)
+{
+    shared_ptr<function<bool(HttpConnection&)> > source;
+    bool close_requested = false;
+    {
+        lock_guard<mutex> lock(c->m_mutex);
+        if (c->m_state == HttpConnection::State::Closed) {
+            return;
+        }
+
+        close_requested = c->m_close_requested;
+        if (c->m_state == HttpConnection::State::Streaming and
+                c->m_source and c->m_backlog < HttpConnection::low_water) {
+            source = c->m_source;
+        }
+    }
+
+    if (close_requested) {
+        close_connection(c);
+        return;
+    }
+
+    if (source and not (*source)(*c)) {
+        close_connection(c);
+        return;
+    }
+
+    if (not flush(*c)) {
+        close_connection(c);
+        return;
+    }
+
+    bool next_request = false;
+    bool done = false;
+    {
+        lock_guard<mutex> lock(c->m_mutex);
+        if (c->m_state == HttpConnection::State::Flushing and c->m_queue.empty()) {
+            if (c->m_keep_alive) {
+                c->m_state = HttpConnection::State::Reading;
+                next_request = true;
+            }
+            else {
+                done = true;
+            }
+        }
+    }
+
+    if (done) {
+        close_connection(c);
+    }
+    else if (next_request) {
+        parse_request(c);
+    }
+}
+
+bool HttpServer::flush(HttpConnection& c)
+{
+    lock_guard<mutex> lock(c.m_mutex);
+
+    // Hand as many chunks as possible to the kernel in one call
+    constexpr size_t max_iov = 64;
+    iovec iov[max_iov];
+
+    while (not c.m_queue.empty()) {
+        size_t num_iov = 0;
+        for (const auto& chunk : c.m_queue) {
+            if (num_iov == max_iov) {
+                break;
+            }
+            const size_t offset = (num_iov == 0) ? c.m_queue_offset : 0;
+            iov[num_iov].iov_base = const_cast<uint8_t*>(chunk->data() + offset);
+            iov[num_iov].iov_len = chunk->size() - offset;
+            num_iov++;
+        }
+
+        msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = num_iov;
+        ssize_t ret = ::sendmsg(c.m_fd, &msg, MSG_NOSIGNAL);
+
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            else if (errno == EAGAIN or errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+
+        c.m_backlog -= ret;
+        while (ret > 0) {
+            const size_t remain = c.m_queue.front()->size() - c.m_queue_offset;
+            if ((size_t)ret < remain) {
+                c.m_queue_offset += ret;
+                break;
+            }
+            ret -= remain;
+            c.m_queue.pop_front();
+            c.m_queue_offset = 0;
+        }
+    }
+
+    const bool want_write = not c.m_queue.empty();
+    if (want_write != c.m_want_write) {
+        c.m_want_write = want_write;
+        watch(c.m_fd, want_write);
+    }
+    return true;
+}
+
+void HttpServer::close_connection(const shared_ptr<HttpConnection>& c)
+{
+    vector<function<void()> > handlers;
+    shared_ptr<function<bool(HttpConnection&)> > source;
+    {
+        lock_guard<mutex> lock(c->m_mutex);
+        if (c->m_state == HttpConnection::State::Closed) {
+            return;
+        }
+        c->m_state = HttpConnection::State::Closed;
+        c->m_server = nullptr;
+        c->m_queue.clear();
+        c->m_backlog = 0;
+        handlers.swap(c->m_close_handlers);
+        source.swap(c->m_source);
+    }
+
+    unwatch(c->m_fd);
+    ::close(c->m_fd);
+    m_connections.erase(c->m_fd);
+
+    for (auto& h : handlers) {
+        if (m_stopping) {
+            h();
+        }
+        else {
+            m_pool.submit(move(h));
+        }
+    }
+}
@@ -0,0 +1,229 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "various/workerpool.h"
+
+struct HttpRequest {
+    bool is_get = false;
+    bool is_post = false;
+    std::string url;
+    std::map<std::string, std::string> headers;
+    std::string post_data;
+
+    // The client wants to send further requests over the same connection
+    bool keep_alive = false;
+};
+
+class HttpServer;
+
+/* One client of the HttpServer.
+ *
+ * Request handlers run on a worker thread, and streams get fed from the
+ * decoder threads, so all public methods are thread-safe. Sending never
+ * blocks: the data is queued and the event loop writes it out whenever
+ * the socket accepts more.
+ */
+class HttpConnection : public std::enable_shared_from_this<HttpConnection> {
+    public:
+        // Immutable piece of data, shared between all connections that send it
+        using chunk_t = std::shared_ptr<const std::vector<uint8_t> >;
+
+        HttpConnection(HttpServer& server, int fd);
+        HttpConnection(const HttpConnection&) = delete;
+        HttpConnection& operator=(const HttpConnection&) = delete;
+
+        // Queue data for the client. Same signature as Socket::send, the
+        // flags are ignored. Returns -1 if the connection is closed, or if
+        // a stream lags behind by more than max_backlog, in which case the
+        // connection gets closed.
+        ssize_t send(const void *buffer, size_t length, int flags = 0);
+
+        // Queue a chunk without copying it
+        ssize_t send(chunk_t chunk);
+
+        // Turn the response into a stream of unknown length: what was
+        // sent so far goes out right away, and the connection stays open
+        // until the client leaves or close() is called.
+        void start_stream();
+
+        // Let the event loop call refill whenever the stream backlog falls
+        // below low_water, and at least every poll_interval. For streams
+        // that pull their data, e.g. from the time-shift store.
+        // Returning false closes the connection.
+        void set_source(std::function<bool(HttpConnection&)>&& refill);
+
+        // Register a function to be called on a worker thread once the
+        // connection is closed. Called right away if it already is.
+        void on_close(std::function<void()>&& handler);
+
+        void close();
+        bool closed() const;
+
+        // Number of bytes queued but not yet written to the socket
+        size_t backlog() const;
+
+        static constexpr size_t max_backlog = 1024 * 1024;
+        static constexpr size_t low_water = 64 * 1024;
+
+    private:
+        friend class HttpServer;
+
+        enum class State {
+            Reading,    // Waiting for a complete request
+            Handling,   // A handler builds the response
+            Flushing,   // The response is complete and gets written out
+            Streaming,  // Open-ended response
+            Closed };
+
+        // Called once the handler returns
+        void finish_response();
+
+        // Queue data and make sure the event loop will write it out
+        void enqueue(chunk_t chunk);
+        void schedule();
+
+        mutable std::mutex m_mutex;
+        HttpServer *m_server;
+        const int m_fd;
+        State m_state = State::Reading;
+        bool m_keep_alive = false;
+        bool m_close_requested = false;
+        bool m_scheduled = false;
+
+        std::string m_response;
+        std::deque<chunk_t> m_queue;
+        size_t m_queue_offset = 0;
+        size_t m_backlog = 0;
+
+        // Shared so that the event loop can call it outside of the lock
+        // without copying the state the source keeps between calls
+        std::shared_ptr<std::function<bool(HttpConnection&)> > m_source;
+        std::vector<std::function<void()> > m_close_handlers;
+
+        // Only accessed from the event loop
+        std::string m_input;
+        bool m_want_write = false;
+};
+
+/* Event-driven HTTP/1.x server.
+ *
+ * A single thread waits for socket events (epoll on Linux, poll
+ * elsewhere), reads and parses requests, and writes out the queued
+ * responses. Handlers run on a small worker pool so that a slow one,
+ * e.g. a retune, does not hold up the other clients. Responses to
+ * keep-alive requests get a Content-Length so that the connection can
+ * be reused.
+ */
+class HttpServer {
+    public:
+        using Handler = std::function<void(
+                const std::shared_ptr<HttpConnection>& connection,
+                const HttpRequest& request)>;
+
+        HttpServer(Handler&& handler, size_t num_workers);
+        ~HttpServer();
+        HttpServer(const HttpServer&) = delete;
+        HttpServer& operator=(const HttpServer&) = delete;
+
+        // Listen on all addresses
+        bool listen(int port);
+
+        // Serve clients until keep_running returns false. It is checked
+        // at least every poll_interval.
+        void run(const std::function<bool()>& keep_running);
+
+        // Returns a function that makes the event loop call all sources
+        // (see HttpConnection::set_source) as soon as possible. It can be
+        // called from any thread, also after the server is gone.
+        std::function<void()> source_notifier();
+
+        static constexpr std::chrono::milliseconds poll_interval =
+            std::chrono::milliseconds(100);
+
+    private:
+        friend class HttpConnection;
+
+        struct notifier_t {
+            std::atomic<bool> pending = ATOMIC_VAR_INIT(false);
+            std::mutex mutex;
+            int fd = -1; // -1 once the server is gone
+        };
+
+        struct event_t {
+            int fd;
+            bool readable;
+            bool writable;
+            bool error;
+        };
+
+        void watch(int fd, bool want_write);
+        void unwatch(int fd);
+        void wait(std::vector<event_t>& events, int timeout_ms);
+
+        // Called from any thread
+        void schedule(const std::shared_ptr<HttpConnection>& connection);
+        void wake();
+
+        void accept_clients();
+        void receive(const std::shared_ptr<HttpConnection>& connection);
+        void parse_request(const std::shared_ptr<HttpConnection>& connection);
+        void service(const std::shared_ptr<HttpConnection>& connection);
+        bool flush(HttpConnection& connection);
+        void close_connection(const std::shared_ptr<HttpConnection>& connection);
+
+        Handler m_handler;
+
+        int m_listen_fd = -1;
+        int m_poll_fd = -1;
+        int m_wake_read_fd = -1;
+        int m_wake_write_fd = -1;
+        std::map<int, short> m_watched; // Only used without epoll
+
+        std::map<int, std::shared_ptr<HttpConnection> > m_connections;
+
+        std::shared_ptr<notifier_t> m_notifier;
+
+        std::mutex m_ready_mutex;
+        std::vector<std::shared_ptr<HttpConnection> > m_ready;
+
+        // Set while the destructor closes the remaining connections
+        bool m_stopping = false;
+
+        // Last, so that running handlers finish before anything else goes
+        WorkerPool m_pool;
+};
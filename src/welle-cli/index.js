@@ -142,7 +142,25 @@ function refreshChannel() {
 
 var channelRefreshTimer = setInterval(refreshChannel, 2000);
 
-var ensembleInfoTimer = setInterval(populateEnsembleinfo, 1000);
+// The server pushes the changes of the mux.json if the browser supports it,
+// otherwise poll it
+var ensembleInfo = null;
+var ensembleInfoTimer = null;
+if (window.EventSource) {
+    var ensembleEvents = new EventSource("/events");
+    ensembleEvents.addEventListener("snapshot", function(e) {
+        ensembleInfo = JSON.parse(e.data);
+        showEnsembleinfo(ensembleInfo);
+    });
+    ensembleEvents.addEventListener("patch", function(e) {
+        if (ensembleInfo == null) return;
+        ensembleInfo = applyPatch(ensembleInfo, JSON.parse(e.data));
+        showEnsembleinfo(ensembleInfo);
+    });
+}
+else {
+    ensembleInfoTimer = setInterval(populateEnsembleinfo, 1000);
+}
 
 function ensembleInfoTemplate() {
     var html = '';
@@ -298,152 +316,195 @@ function populateEnsembleinfo() {
     var r = new XMLHttpRequest();
     r.onreadystatechange = function () {
         if (r.readyState != 4 || r.status != 200) return;
-        var data = JSON.parse(r.responseText);
-
-        var start_addresses = [];
-        for (key in data.services) {
-            var service = data.services[key];
-            var sad_ix = {};
-            if (service.components) {
-                sad_ix["sad"] = service.components[0].subchannel.sad;
+        showEnsembleinfo(JSON.parse(r.responseText));
+    };
+    r.open("GET", "/mux.json", true);
+    r.send()
+};
+
+function showEnsembleinfo(data) {
+    var start_addresses = [];
+    for (key in data.services) {
+        var service = data.services[key];
+        var sad_ix = {};
+        if (service.components) {
+            sad_ix["sad"] = service.components[0].subchannel.sad;
+        }
+        else {
+            // Place them at the end
+            sad_ix["sad"] = 864;
+        }
+        sad_ix["key"] = key;
+        start_addresses.push(sad_ix);
+    }
+
+    start_addresses.sort(function(a, b) {
+        return a.sad - b.sad;
+    });
+
+    var servicehtml = "";
+    for (ix in start_addresses) {
+        var key = start_addresses[ix].key;
+        var service = data.services[key];
+        var s = {};
+        s["label"] = service.label.label;
+        s["fig2label"] = service.label.fig2label;
+        s["shortlabel"] = service.label.shortlabel;
+        s["SId"] = service.sid;
+        s["buttondisabled"] = "disabled";
+        s["buttonclass"] = "disabled";
+        if (service.components) {
+            var sc = service.components[0];
+            var sub = sc.subchannel;
+            s["bitrate"] = sub.bitrate;
+            s["sad_cu"] = sub.sad + ", " + sub.cu;
+            s["protection"] = sub.protection;
+            s["subchannel_language"] = sub.languagestring;
+
+            if (sc.transportmode == "audio") {
+                s["techdetails"] = sc.ascty + ", " +
+                    service.samplerate + " Hz, " +
+                    service.mode + ", " +
+                    service.channels;
+                s["buttondisabled"] = "";
+                s["buttonclass"] = "";
             }
             else {
-                // Place them at the end
-                sad_ix["sad"] = 864;
+                s["techdetails"] = sc.transportmode + ", DSCTy=" + sc.dscty;
             }
-            sad_ix["key"] = key;
-            start_addresses.push(sad_ix);
+        }
+        else {
+            s["bitrate"] = 0;
+            s["sad"] = -1;
+            s["protection"] = "?";
+            s["techdetails"] = "";
         }
 
-        start_addresses.sort(function(a, b) {
-            return a.sad - b.sad;
-        });
+        s["dls"] = "";
 
-        var servicehtml = "";
-        for (ix in start_addresses) {
-            var key = start_addresses[ix].key;
-            var service = data.services[key];
-            var s = {};
-            s["label"] = service.label.label;
-            s["fig2label"] = service.label.fig2label;
-            s["shortlabel"] = service.label.shortlabel;
-            s["SId"] = service.sid;
-            s["buttondisabled"] = "disabled";
-            s["buttonclass"] = "disabled";
-            if (service.components) {
-                var sc = service.components[0];
-                var sub = sc.subchannel;
-                s["bitrate"] = sub.bitrate;
-                s["sad_cu"] = sub.sad + ", " + sub.cu;
-                s["protection"] = sub.protection;
-                s["subchannel_language"] = sub.languagestring;
-
-                if (sc.transportmode == "audio") {
-                    s["techdetails"] = sc.ascty + ", " +
-                        service.samplerate + " Hz, " +
-                        service.mode + ", " +
-                        service.channels;
-                    s["buttondisabled"] = "";
-                    s["buttonclass"] = "";
-                }
-                else {
-                    s["techdetails"] = sc.transportmode + ", DSCTy=" + sc.dscty;
-                }
-            }
-            else {
-                s["bitrate"] = 0;
-                s["sad"] = -1;
-                s["protection"] = "?";
-                s["techdetails"] = "";
-            }
+        if (service.mot && service.mot.time > 0) {
+            s["dls"] += '<button type=button onclick="showSlide(';
+            s["dls"] += service.sid + ', ' + service.mot.time;
+            s["dls"] += ')">SLS</button>';
+        }
 
-            s["dls"] = "";
+        if (service.dls) {
+            var last_update = new Date(service.dls.time * 1000);
+            s["dls"] += ' <span title="Updated ' + last_update + '">' + service.dls.label + '</span>';
+        }
 
-            if (service.mot && service.mot.time > 0) {
-                s["dls"] += '<button type=button onclick="showSlide(';
-                s["dls"] += service.sid + ', ' + service.mot.time;
-                s["dls"] += ')">SLS</button>';
-            }
+        if (service.xpaderror && service.xpaderror.haserror) {
+            var alerthtml = ' <img width=16 height=16 src="data:image/png;base64,' + png_alert + '" ';
+            var tooltip = "X-PAD Length error, expected " + service.xpaderror.announcedlen +
+                " got " + service.xpaderror.len;
+            alerthtml += 'title="' + tooltip + '" ';
+            alerthtml += 'alt="' + tooltip + '">';
+            s["dls"] += alerthtml;
+        }
+        s["dls"] += "</td>";
 
-            if (service.dls) {
-                var last_update = new Date(service.dls.time * 1000);
-                s["dls"] += ' <span title="Updated ' + last_update + '">' + service.dls.label + '</span>';
-            }
+        s["pty"] = service.ptystring;
+        s["language"] = service.languagestring;
+        s["canvasid"] = "canvas" + service.sid;
 
-            if (service.xpaderror && service.xpaderror.haserror) {
-                var alerthtml = ' <img width=16 height=16 src="data:image/png;base64,' + png_alert + '" ';
-                var tooltip = "X-PAD Length error, expected " + service.xpaderror.announcedlen +
-                    " got " + service.xpaderror.len;
-                alerthtml += 'title="' + tooltip + '" ';
-                alerthtml += 'alt="' + tooltip + '">';
-                s["dls"] += alerthtml;
-            }
-            s["dls"] += "</td>";
+        if (service.errorcounters) {
+            s["errorcounters"] = service.errorcounters.frameerrors + "," +
+                                 service.errorcounters.rserrors + "," +
+                                 service.errorcounters.aacerrors;
+        }
+        else {
+            s["errorcounters"] = "";
+        }
 
-            s["pty"] = service.ptystring;
-            s["language"] = service.languagestring;
-            s["canvasid"] = "canvas" + service.sid;
+        servicehtml += parseTemplate(serviceTemplate(), s)
+    }
 
-            if (service.errorcounters) {
-                s["errorcounters"] = service.errorcounters.frameerrors + "," +
-                                     service.errorcounters.rserrors + "," +
-                                     service.errorcounters.aacerrors;
-            }
-            else {
-                s["errorcounters"] = "";
-            }
+    var ens = {};
+    ens["label"] = data.ensemble.label.label;
+    ens["fig2label"] = data.ensemble.label.fig2label;
+    ens["shortlabel"] = data.ensemble.label.shortlabel;
+    ens["EId"] = data.ensemble.id;
+    ens["ecc"] = data.ensemble.ecc;
+
+    ens["year"] = data.utctime.year;
+    ens["month"] = data.utctime.month;
+    ens["day"] = data.utctime.day;
+    ens["hour"] = data.utctime.hour;
+    ens["minutes"] = data.utctime.minutes;
+    ens["lto"] = data.utctime.lto;
+
+    ens["gain"] = data.receiver.hardware.gain.toFixed(1);
+    document.getElementById("fftwindowselector").value = data.receiver.software.fftwindowplacement;
+    document.getElementById("coarsecheckbox").checked = data.receiver.software.coarsecorrectorenabled;
+
+    ens["version"] = data.receiver.software.version;
+    ens["hw_name"] = data.receiver.hardware.name;
+    ens["sw_name"] = data.receiver.software.name;
+    ens["SNR"] = data.demodulator.snr.toFixed(1);
+    ens["FrequencyCorrection"] = data.demodulator.frequencycorrection;
+    ens["services"] = servicehtml;
+    ens["ficcrcerrors"] = data.demodulator.fic.numcrcerrors;
+    var lcc = new Date(data.receiver.software.lastchannelchange);
+    ens["lastchannelchange"] = lcc.toISOString();
+    var lfct0 = new Date(data.demodulator.time_last_fct0_frame);
+    ens["lastfct0frame"] = lfct0.toISOString();
+
+    var ei = document.getElementById('ensembleinfo');
+    ei.innerHTML = parseTemplate(ensembleInfoTemplate(), ens);
+
+    tiihtml = "<ul>";
+    for (key in data.tii) {
+        tiihtml += parseTemplate(tiiTemplate(), data.tii[key])
+    }
+    tiihtml += "</ul>";
 
-            servicehtml += parseTemplate(serviceTemplate(), s)
-        }
+    var tii_el = document.getElementById('tiiinfo');
+    tii_el.innerHTML = tiihtml;
 
-        var ens = {};
-        ens["label"] = data.ensemble.label.label;
-        ens["fig2label"] = data.ensemble.label.fig2label;
-        ens["shortlabel"] = data.ensemble.label.shortlabel;
-        ens["EId"] = data.ensemble.id;
-        ens["ecc"] = data.ensemble.ecc;
-
-        ens["year"] = data.utctime.year;
-        ens["month"] = data.utctime.month;
-        ens["day"] = data.utctime.day;
-        ens["hour"] = data.utctime.hour;
-        ens["minutes"] = data.utctime.minutes;
-        ens["lto"] = data.utctime.lto;
-
-        ens["gain"] = data.receiver.hardware.gain.toFixed(1);
-        document.getElementById("fftwindowselector").value = data.receiver.software.fftwindowplacement;
-        document.getElementById("coarsecheckbox").checked = data.receiver.software.coarsecorrectorenabled;
-
-        ens["version"] = data.receiver.software.version;
-        ens["hw_name"] = data.receiver.hardware.name;
-        ens["sw_name"] = data.receiver.software.name;
-        ens["SNR"] = data.demodulator.snr.toFixed(1);
-        ens["FrequencyCorrection"] = data.demodulator.frequencycorrection;
-        ens["services"] = servicehtml;
-        ens["ficcrcerrors"] = data.demodulator.fic.numcrcerrors;
-        var lcc = new Date(data.receiver.software.lastchannelchange);
-        ens["lastchannelchange"] = lcc.toISOString();
-        var lfct0 = new Date(data.demodulator.time_last_fct0_frame);
-        ens["lastfct0frame"] = lfct0.toISOString();
-
-        var ei = document.getElementById('ensembleinfo');
-        ei.innerHTML = parseTemplate(ensembleInfoTemplate(), ens);
-
-        tiihtml = "<ul>";
-        for (key in data.tii) {
-            tiihtml += parseTemplate(tiiTemplate(), data.tii[key])
-        }
-        tiihtml += "</ul>";
+    drawCIRPeaks(data.cir_peaks);
 
-        var tii_el = document.getElementById('tiiinfo');
-        tii_el.innerHTML = tiihtml;
+    drawAudiolevels(data.services);
+};
 
-        drawCIRPeaks(data.cir_peaks);
+// Apply a JSON Patch (RFC 6902) as sent by /events. The server only
+// uses add, remove and replace.
+function applyPatch(doc, patch) {
+    for (var i = 0; i < patch.length; i++) {
+        var op = patch[i];
+        if (op.path == "") {
+            doc = op.value;
+            continue;
+        }
 
-        drawAudiolevels(data.services);
-    };
-    r.open("GET", "/mux.json", true);
-    r.send()
+        var keys = op.path.substring(1).split("/").map(function(k) {
+            return k.replace(/~1/g, "/").replace(/~0/g, "~");
+        });
+        var last = keys.pop();
+        var parent = doc;
+        for (var k = 0; k < keys.length; k++) {
+            parent = parent[keys[k]];
+        }
+
+        if (Array.isArray(parent)) {
+            var ix = (last == "-") ? parent.length : parseInt(last);
+            if (op.op == "add") {
+                parent.splice(ix, 0, op.value);
+            }
+            else if (op.op == "remove") {
+                parent.splice(ix, 1);
+            }
+            else {
+                parent[ix] = op.value;
+            }
+        }
+        else if (op.op == "remove") {
+            delete parent[last];
+        }
+        else {
+            parent[last] = op.value;
+        }
+    }
+    return doc;
 };
 
 function plot(data, id, scalefactor, shiftfactor, plot_ix) {
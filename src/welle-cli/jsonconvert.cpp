@@ -161,6 +161,13 @@ static void to_json(nlohmann::json& j, const ServiceJson& s) {
         j["url_mp3"] = s.url_mp3;
     }
 
+    if (s.url_passthrough.empty()) {
+        j["url_passthrough"] = nullptr;
+    }
+    else {
+        j["url_passthrough"] = s.url_passthrough;
+    }
+
     if (s.audiolevel_present) {
         j["audiolevel"] = nlohmann::json{
             {"time", s.audiolevel_time},
@@ -234,3 +241,90 @@ std::string build_mux_json(const MuxJson& mux)
     nlohmann::json j = mux;
     return j.dump();
 }
+
+struct MuxJsonTracker::State {
+    nlohmann::json mux;
+};
+
+MuxJsonTracker::MuxJsonTracker() :
+    state(std::make_unique<State>())
+{
+}
+
+MuxJsonTracker::~MuxJsonTracker() = default;
+
+std::string MuxJsonTracker::update(const MuxJson& mux)
+{
+    nlohmann::json j = mux;
+    const auto patch = nlohmann::json::diff(state->mux, j);
+    state->mux = std::move(j);
+
+    if (patch.empty()) {
+        return "";
+    }
+    return patch.dump();
+}
+
+std::string MuxJsonTracker::snapshot() const
+{
+    return state->mux.dump();
+}
+
+#if defined(WITH_PROFILING)
+std::string build_profiling_json(const ProfilingSnapshot& snapshot)
+{
+    nlohmann::json j;
+
+    auto to_s = [](const struct timespec& ts) {
+        return ts.tv_sec + ts.tv_nsec / 1e9; };
+
+    j["cputime"] = to_s(snapshot.cputime);
+    j["monotonic"] = to_s(snapshot.monotonic);
+    j["frames_decoded"] = snapshot.num_frames_decoded;
+    j["events"] = snapshot.num_events;
+    j["dropped_events"] = snapshot.num_dropped_events;
+
+    j["stages"] = nlohmann::json::array();
+    for (const auto& stage : snapshot.stages) {
+        const auto& h = stage.latency;
+
+        nlohmann::json buckets = nlohmann::json::array();
+        for (size_t b = 0; b < h.buckets.size(); b++) {
+            if (h.buckets[b]) {
+                buckets.push_back({
+                        {"from_us", LatencyHistogram::bucket_start_ns(b) / 1000},
+                        {"count", h.buckets[b]}});
+            }
+        }
+
+        j["stages"].push_back({
+                {"name", stage.name},
+                {"from", mark_to_cstr(stage.from)},
+                {"to", mark_to_cstr(stage.to)},
+                {"count", h.count},
+                {"mean_us", h.count ? h.sum_ns / h.count / 1000.0 : 0.0},
+                {"min_us", h.min_ns / 1000.0},
+                {"p50_us", h.quantile_ns(0.5) / 1000.0},
+                {"p99_us", h.quantile_ns(0.99) / 1000.0},
+                {"max_us", h.max_ns / 1000.0},
+                {"histogram", buckets}});
+    }
+
+    j["threads"] = nlohmann::json::array();
+    for (const auto& t : snapshot.threads) {
+        nlohmann::json transitions = nlohmann::json::array();
+        for (const auto& tr : t.transitions_ns) {
+            transitions.push_back({
+                    {"from", mark_to_cstr(tr.first.first)},
+                    {"to", mark_to_cstr(tr.first.second)},
+                    {"total_ms", tr.second / 1e6}});
+        }
+        j["threads"].push_back({
+                {"id", t.id},
+                {"name", t.name},
+                {"transitions", transitions}});
+    }
+
+    return j.dump();
+}
+#endif
@@ -32,6 +32,7 @@
 #include <ctime>
 #include "dab-constants.h"
 #include "backend/radio-controller.h"
+#include "various/profiling.h"
 
 struct SoftwareJson {
     std::string name;
@@ -80,6 +81,8 @@ struct ServiceJson {
     std::vector<ComponentJson> components;
 
     std::string url_mp3;
+    // The audio as broadcast, without decoding and encoding
+    std::string url_passthrough;
 
     bool audiolevel_present = false;
     std::time_t audiolevel_time = 0;
@@ -145,3 +148,28 @@ struct MuxJson {
 };
 
 std::string build_mux_json(const MuxJson& mux);
+
+/* The mux.json last sent to the event stream clients, so that they only
+ * get what changed since. */
+class MuxJsonTracker {
+    public:
+        MuxJsonTracker();
+        ~MuxJsonTracker();
+        MuxJsonTracker(const MuxJsonTracker&) = delete;
+        MuxJsonTracker& operator=(const MuxJsonTracker&) = delete;
+
+        // Make mux the current state, and return the JSON Patch (RFC 6902)
+        // that turns the previous state into it. Empty if nothing changed.
+        std::string update(const MuxJson& mux);
+
+        // The current state as a complete mux.json
+        std::string snapshot() const;
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+};
+
+#if defined(WITH_PROFILING)
+std::string build_profiling_json(const ProfilingSnapshot& snapshot);
+#endif
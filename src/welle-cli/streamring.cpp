@@ -0,0 +1,164 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "welle-cli/streamring.h"
+#include <iostream>
+
+using namespace std;
+
+StreamRing::StreamRing(size_t capacity) :
+    m_chunks(capacity),
+    m_positions(capacity)
+{
+}
+
+void StreamRing::publish(chunk_t chunk)
+{
+    function<void()> notify;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        const size_t slot = m_head % m_chunks.size();
+        m_positions[slot] = m_position;
+        m_position += chunk->size();
+        m_chunks[slot] = move(chunk);
+        m_head++;
+        if (m_head - m_tail > m_chunks.size()) {
+            m_tail = m_head - m_chunks.size();
+        }
+        notify = m_notify;
+    }
+
+    if (notify) {
+        notify();
+    }
+}
+
+void StreamRing::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    for (auto& c : m_chunks) {
+        c.reset();
+    }
+    m_tail = m_head;
+}
+
+void StreamRing::set_notify(function<void()>&& notify)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_notify = move(notify);
+}
+
+bool StreamRing::read(uint64_t& seq, vector<chunk_t>& out, size_t max_bytes) const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (seq < m_tail) {
+        return false;
+    }
+
+    size_t bytes = 0;
+    while (seq < m_head and bytes < max_bytes) {
+        const auto& chunk = m_chunks[seq % m_chunks.size()];
+        bytes += chunk->size();
+        out.push_back(chunk);
+        seq++;
+    }
+    return true;
+}
+
+void StreamRing::subscribe(HttpConnection& connection, LagPolicy policy,
+        Start start, chunk_t header)
+{
+    uint64_t seq = 0;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        seq = (start == Start::Live) ? m_head : m_tail;
+    }
+
+    if (header and connection.send(header) == -1) {
+        return;
+    }
+
+    attach(connection, policy, seq);
+}
+
+bool StreamRing::subscribe_at(HttpConnection& connection, LagPolicy policy,
+        uint64_t position)
+{
+    uint64_t seq = 0;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (position == m_position) {
+            seq = m_head;
+        }
+        else {
+            // The position is usually close to the head
+            seq = m_head;
+            while (seq > m_tail and
+                    m_positions[(seq - 1) % m_chunks.size()] > position) {
+                seq--;
+            }
+
+            if (seq == m_tail or
+                    m_positions[(seq - 1) % m_chunks.size()] != position) {
+                return false;
+            }
+            seq--;
+        }
+    }
+
+    attach(connection, policy, seq);
+    return true;
+}
+
+void StreamRing::attach(HttpConnection& connection, LagPolicy policy, uint64_t seq)
+{
+    auto ring = shared_from_this();
+    vector<chunk_t> chunks;
+
+    connection.set_source(
+            [ring, policy, seq, chunks](HttpConnection& c) mutable {
+                chunks.clear();
+                const size_t max_bytes = HttpConnection::low_water;
+
+                if (not ring->read(seq, chunks, max_bytes)) {
+                    if (policy == LagPolicy::Drop) {
+                        cerr << "HTTP client lags behind stream, dropping it" << endl;
+                        return false;
+                    }
+
+                    // Continue with what comes next
+                    lock_guard<mutex> lock(ring->m_mutex);
+                    seq = ring->m_head;
+                }
+
+                for (auto& chunk : chunks) {
+                    if (c.send(move(chunk)) == -1) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+}
@@ -0,0 +1,95 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "welle-cli/httpserver.h"
+
+/* Fan-out of one encoded stream to any number of HTTP clients.
+ *
+ * The producer publishes immutable chunks into a ring of fixed size.
+ * Every subscribed connection keeps its own position in the ring, and
+ * the event loop moves pointers to the chunks into the connection
+ * queue whenever it runs low. Publishing therefore costs the same for
+ * one listener or for hundreds, and the data is never copied.
+ */
+class StreamRing : public std::enable_shared_from_this<StreamRing> {
+    public:
+        using chunk_t = HttpConnection::chunk_t;
+
+        // What to do with a client that fell behind by more than
+        // the ring size
+        enum class LagPolicy { Drop, SkipAhead };
+
+        // Where a new subscriber starts
+        enum class Start { Live, Oldest };
+
+        explicit StreamRing(size_t capacity);
+        StreamRing(const StreamRing&) = delete;
+        StreamRing& operator=(const StreamRing&) = delete;
+
+        // Called by the producer
+        void publish(chunk_t chunk);
+
+        // Drop everything published so far, e.g. after a retune
+        void clear();
+
+        // Set the function called after every publish, usually
+        // HttpServer::source_notifier()
+        void set_notify(std::function<void()>&& notify);
+
+        // Stream the ring to the connection, preceded by the header if
+        // there is one.
+        void subscribe(HttpConnection& connection, LagPolicy policy,
+                Start start, chunk_t header = nullptr);
+
+        // Stream the ring to the connection starting at the given byte
+        // position, counted from the first chunk ever published. Returns
+        // false if no chunk starts there, e.g. because it is not
+        // published yet or already left the ring.
+        bool subscribe_at(HttpConnection& connection, LagPolicy policy,
+                uint64_t position);
+
+    private:
+        void attach(HttpConnection& connection, LagPolicy policy, uint64_t seq);
+
+        // Append the chunks from seq on to out, up to max_bytes. Returns
+        // false if seq is not in the ring anymore.
+        bool read(uint64_t& seq, std::vector<chunk_t>& out, size_t max_bytes) const;
+
+        mutable std::mutex m_mutex;
+        std::vector<chunk_t> m_chunks;
+        std::vector<uint64_t> m_positions; // Byte position of each chunk
+        uint64_t m_position = 0; // Byte position of the next chunk
+        uint64_t m_head = 0;  // Sequence number of the next chunk
+        uint64_t m_tail = 0;  // Oldest sequence number still in the ring
+
+        std::function<void()> m_notify;
+};
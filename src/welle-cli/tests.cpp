@@ -34,6 +34,7 @@
 #include "backend/radio-receiver.h"
 #include "raw_file.h"
 #include "various/profiling.h"
+#include "welle-cli/webradiointerface.h"
 #include <algorithm>
 #include <numeric>
 #include <random>
@@ -42,6 +43,15 @@
 #include <iostream>
 #include <utility>
 #include <cstdio>
+#include <csignal>
+
+#if !defined(_WIN32)
+# include <arpa/inet.h>
+# include <netinet/in.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -369,6 +379,103 @@ void Tests::test_multipath(int test_id)
     fclose(fd);
 }
 
+#if !defined(_WIN32)
+static int connect_local(int port)
+{
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == -1) {
+        throw runtime_error("socket failed");
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(sock);
+        throw runtime_error("connect failed");
+    }
+    return sock;
+}
+
+// Receive into buf until it contains what, false on timeout or close
+static bool receive_until(int sock, string& buf, const string& what,
+        chrono::milliseconds timeout)
+{
+    const auto deadline = chrono::steady_clock::now() + timeout;
+    while (buf.find(what) == string::npos) {
+        const auto left = chrono::duration_cast<chrono::milliseconds>(
+                deadline - chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+
+        struct pollfd pfd = {};
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, left.count()) <= 0) {
+            continue;
+        }
+
+        char data[4096];
+        const ssize_t r = recv(sock, data, sizeof(data), 0);
+        if (r <= 0) {
+            return false;
+        }
+        buf.append(data, r);
+    }
+    return true;
+}
+#endif
+
+void Tests::test_events_after_retune()
+{
+#if defined(_WIN32)
+    cerr << "test_events_after_retune needs POSIX sockets" << endl;
+#else
+    const int port = 18000;
+    cerr << "Setup test_events_after_retune on port " << port << endl;
+
+    WebRadioInterface::DecodeSettings ds;
+    WebRadioInterface wri(*input_interface, port, ds, rro);
+    thread server_thread([&]() { wri.serve(); });
+
+    const int events_sock = connect_local(port);
+    const string events_req = "GET /events HTTP/1.1\r\n\r\n";
+    send(events_sock, events_req.data(), events_req.size(), 0);
+
+    // The snapshot is one JSON object, and the patches are arrays
+    string events;
+    const bool got_snapshot = receive_until(events_sock, events,
+            "}\n\n", chrono::seconds(5));
+    events.clear();
+
+    const int channel_sock = connect_local(port);
+    const string channel = "5A";
+    const string channel_req = "POST /channel HTTP/1.1\r\n"
+        "Content-Length: " + to_string(channel.size()) + "\r\n\r\n" + channel;
+    send(channel_sock, channel_req.data(), channel_req.size(), 0);
+
+    string reply;
+    const bool retuned = receive_until(channel_sock, reply, "Retuning...",
+            chrono::seconds(10));
+    close(channel_sock);
+
+    // Only the retune changes lastchannelchange, so this cannot be a
+    // patch that was already on its way before
+    const bool got_patch = receive_until(events_sock, events,
+            "lastchannelchange", chrono::seconds(5));
+    close(events_sock);
+
+    raise(SIGINT);
+    server_thread.join();
+
+    cerr << "Snapshot " << (got_snapshot ? "received" : "MISSING") <<
+        ", retune " << (retuned ? "done" : "FAILED") <<
+        ", patch after retune " << (got_patch ? "received" : "MISSING") << endl;
+#endif
+}
+
 void Tests::run_test(int test_id)
 {
     rro.fftPlacementMethod = DEFAULT_FFT_PLACEMENT;
@@ -376,5 +483,6 @@ void Tests::run_test(int test_id)
     if (test_id == 0) test_with_noise();
     else if (test_id == 1 or test_id == 2) test_multipath(test_id);
     else if (test_id == 3) test_with_noise_iteration(0);
+    else if (test_id == 4) test_events_after_retune();
     else cerr << "Test " << test_id << " does not exist!" << endl;
 }
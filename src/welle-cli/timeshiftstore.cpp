@@ -0,0 +1,335 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "timeshiftstore.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+using namespace std;
+
+// Minimum time between two entries of the seek index
+static const chrono::milliseconds index_interval(100);
+
+TimeShiftStore::Segment::Segment(const string& directory, size_t capacity,
+        uint64_t sequence, uint64_t position, clock::time_point start) :
+    sequence(sequence),
+    position(position),
+    start(start),
+    m_capacity(capacity),
+    m_last_time(start)
+{
+#if defined(_WIN32)
+    (void)directory;
+    m_data = new uint8_t[capacity];
+#else
+    string path = directory + "/welle-timeshift-XXXXXX";
+    vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+
+    const int fd = mkstemp(name.data());
+    if (fd == -1) {
+        throw runtime_error("Cannot create time-shift segment in " +
+                directory + ": " + strerror(errno));
+    }
+
+    // The file only lives as long as it is open or mapped
+    unlink(name.data());
+
+    if (ftruncate(fd, capacity) == -1) {
+        const int err = errno;
+        ::close(fd);
+        throw runtime_error(string("Cannot resize time-shift segment: ") +
+                strerror(err));
+    }
+
+    void *p = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int err = errno;
+
+    // The mapping keeps the file alive, so that a store does not need a
+    // descriptor per segment
+    ::close(fd);
+
+    if (p == MAP_FAILED) {
+        throw runtime_error(string("Cannot map time-shift segment: ") +
+                strerror(err));
+    }
+    m_data = reinterpret_cast<uint8_t*>(p);
+#endif
+}
+
+TimeShiftStore::Segment::~Segment()
+{
+#if defined(_WIN32)
+    delete[] m_data;
+#else
+    munmap(m_data, m_capacity);
+#endif
+}
+
+void TimeShiftStore::Segment::write(const uint8_t *data, size_t len)
+{
+    const size_t size = m_size.load(memory_order_relaxed);
+    memcpy(m_data + size, data, len);
+    m_size.store(size + len, memory_order_release);
+}
+
+TimeShiftStore::TimeShiftStore(const Settings& settings) :
+    m_settings(settings)
+{
+}
+
+void TimeShiftStore::append(const uint8_t *data, size_t len, clock::time_point t)
+{
+    if (len == 0) {
+        return;
+    }
+
+    lock_guard<mutex> lock(m_mutex);
+
+    // Count the data even if it cannot be stored, to stay in line
+    // with the live stream
+    const uint64_t position = m_position;
+    m_position += len;
+
+    // The front segment can go once the second one starts before the
+    // retention limit, i.e. all of the front is too old
+    const auto limit = t - m_settings.retention;
+    while (m_segments.size() > 1 and m_segments[1]->start <= limit) {
+        m_segments.pop_front();
+    }
+
+    if (m_segments.empty() or
+            t - m_segments.back()->start >= m_settings.segment_duration or
+            m_segments.back()->size() + len > m_segments.back()->capacity()) {
+        string directory = m_settings.directory;
+        if (directory.empty()) {
+            const char *tmpdir = getenv("TMPDIR");
+            directory = tmpdir ? tmpdir : "/tmp";
+        }
+
+        auto segment = make_shared<Segment>(directory,
+                std::max(m_settings.segment_capacity, len),
+                m_next_sequence++, position, t);
+
+        if (not m_segments.empty()) {
+            m_segments.back()->seal();
+        }
+        m_segments.push_back(move(segment));
+    }
+
+    auto& segment = *m_segments.back();
+    if (segment.m_index.empty() or
+            t - segment.m_index.back().time >= index_interval) {
+        segment.m_index.push_back({t, segment.size()});
+    }
+    segment.m_last_time = t;
+    segment.write(data, len);
+}
+
+void TimeShiftStore::clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (not m_segments.empty()) {
+        m_segments.back()->seal();
+    }
+    m_segments.clear();
+}
+
+TimeShiftStore::Cursor TimeShiftStore::seek(clock::time_point t) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    Cursor c;
+
+    if (m_segments.empty()) {
+        return c;
+    }
+
+    // Last segment that starts at or before t
+    auto seg_it = upper_bound(m_segments.begin(), m_segments.end(), t,
+            [](clock::time_point t, const shared_ptr<Segment>& s) {
+                return t < s->start;
+            });
+
+    if (seg_it == m_segments.begin()) {
+        c.segment = m_segments.front();
+        return c;
+    }
+    --seg_it;
+
+    const auto& index = (*seg_it)->m_index;
+    auto entry_it = lower_bound(index.begin(), index.end(), t,
+            [](const Segment::IndexEntry& e, clock::time_point t) {
+                return e.time < t;
+            });
+
+    if (entry_it != index.end()) {
+        c.segment = *seg_it;
+        c.offset = entry_it->offset;
+    }
+    else if (next(seg_it) != m_segments.end()) {
+        c.segment = *next(seg_it);
+    }
+    else {
+        c.segment = *seg_it;
+        c.offset = (*seg_it)->size();
+    }
+
+    return c;
+}
+
+TimeShiftStore::Cursor TimeShiftStore::head() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    Cursor c;
+    if (not m_segments.empty()) {
+        c.segment = m_segments.back();
+        c.offset = c.segment->size();
+    }
+    return c;
+}
+
+shared_ptr<TimeShiftStore::Segment> TimeShiftStore::next_segment(
+        const Segment& segment) const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    // If the reader fell behind the retention, this skips to the oldest
+    // segment still available.
+    auto it = upper_bound(m_segments.begin(), m_segments.end(),
+            segment.sequence,
+            [](uint64_t seq, const shared_ptr<Segment>& s) {
+                return seq < s->sequence;
+            });
+
+    if (it == m_segments.end()) {
+        return nullptr;
+    }
+    return *it;
+}
+
+size_t TimeShiftStore::peek(Cursor& cursor, const uint8_t **data, size_t max_len,
+        clock::time_point until) const
+{
+    if (not cursor.valid()) {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_segments.empty()) {
+            return 0;
+        }
+        cursor.segment = m_segments.front();
+        cursor.offset = 0;
+    }
+
+    size_t available = cursor.segment->size() - cursor.offset;
+
+    if (available == 0 and cursor.segment->sealed()) {
+        // Nothing gets written after sealing, but the last write
+        // could have happened since we looked at the size
+        available = cursor.segment->size() - cursor.offset;
+
+        if (available == 0) {
+            auto next = next_segment(*cursor.segment);
+            if (next) {
+                cursor.segment = move(next);
+                cursor.offset = 0;
+                available = cursor.segment->size();
+            }
+        }
+    }
+
+    if (until != clock::time_point::max() and available > 0) {
+        lock_guard<mutex> lock(m_mutex);
+
+        // Everything before the first index entry later than until
+        // was appended in time
+        const auto& index = cursor.segment->m_index;
+        auto entry_it = upper_bound(index.begin(), index.end(), until,
+                [](clock::time_point t, const Segment::IndexEntry& e) {
+                    return t < e.time;
+                });
+
+        if (entry_it != index.end()) {
+            available = (entry_it->offset > cursor.offset) ?
+                std::min(available, entry_it->offset - cursor.offset) : 0;
+        }
+    }
+
+    *data = cursor.segment->data() + cursor.offset;
+    return std::min(available, max_len);
+}
+
+void TimeShiftStore::advance(Cursor& cursor, size_t len) const
+{
+    cursor.offset += len;
+}
+
+TimeShiftStore::clock::time_point TimeShiftStore::time_at(const Cursor& cursor) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (not cursor.valid()) {
+        return m_segments.empty() ? clock::now() : m_segments.front()->start;
+    }
+
+    // Last index entry at or before the cursor
+    const auto& index = cursor.segment->m_index;
+    auto entry_it = upper_bound(index.begin(), index.end(), cursor.offset,
+            [](size_t offset, const Segment::IndexEntry& e) {
+                return offset < e.offset;
+            });
+
+    if (entry_it == index.begin()) {
+        return cursor.segment->start;
+    }
+    return prev(entry_it)->time;
+}
+
+uint64_t TimeShiftStore::position(const Cursor& cursor) const
+{
+    if (cursor.valid()) {
+        return cursor.segment->position + cursor.offset;
+    }
+
+    lock_guard<mutex> lock(m_mutex);
+    return m_segments.empty() ? m_position : m_segments.front()->position;
+}
+
+chrono::milliseconds TimeShiftStore::duration() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_segments.empty()) {
+        return chrono::milliseconds(0);
+    }
+
+    return chrono::duration_cast<chrono::milliseconds>(
+            m_segments.back()->m_last_time - m_segments.front()->start);
+}
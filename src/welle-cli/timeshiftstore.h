@@ -0,0 +1,171 @@
+/*
+ *    Copyright (C) 2026
+ *    welle.io contributors
+ *
+ *    This file is part of the welle.io.
+ *    Many of the ideas as implemented in welle.io are derived from
+ *    other work, made available through the GNU general Public License.
+ *    All copyrights of the original authors are recognized.
+ *
+ *    welle.io is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    welle.io is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with welle.io; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Time-shift buffer for the encoded audio of one programme.
+ *
+ * The audio is stored in segments of fixed duration, each living in a
+ * memory-mapped file that is unlinked right after creation, so that the
+ * kernel can page it out and nothing is left behind on disk. Every
+ * segment keeps a sparse index of timestamp -> offset, which allows to
+ * seek by time with two binary searches.
+ *
+ * Readers hold a Cursor that keeps its segment mapped, and get pointers
+ * directly into the mapping: data is never copied on the way out.
+ * There is a single writer; appends only take the lock briefly to
+ * update the index and the list of segments.
+ */
+class TimeShiftStore {
+    public:
+        using clock = std::chrono::system_clock;
+
+        struct Settings {
+            // How much audio to keep
+            std::chrono::minutes retention = std::chrono::minutes(30);
+
+            // Duration of one segment file
+            std::chrono::seconds segment_duration = std::chrono::seconds(10);
+
+            // Size of a segment file. A new segment is started early
+            // if the current one is full.
+            size_t segment_capacity = 1024 * 1024;
+
+            // Where to create the segment files, empty means $TMPDIR or /tmp
+            std::string directory;
+        };
+
+        class Segment;
+
+        // Read position inside the store
+        struct Cursor {
+            std::shared_ptr<const Segment> segment;
+            size_t offset = 0;
+
+            bool valid() const { return segment.get() != nullptr; }
+        };
+
+        explicit TimeShiftStore(const Settings& settings);
+        TimeShiftStore(const TimeShiftStore&) = delete;
+        TimeShiftStore& operator=(const TimeShiftStore&) = delete;
+
+        // Append encoded data received at time t. Throws a runtime_error
+        // if the segment file cannot be created.
+        void append(const uint8_t *data, size_t len,
+                clock::time_point t = clock::now());
+
+        // Drop all stored audio, e.g. after a retune
+        void clear();
+
+        // Cursor at the first data appended at or after t, or at the
+        // oldest data if t is further back than the retention.
+        Cursor seek(clock::time_point t) const;
+
+        // Cursor at the live end of the store
+        Cursor head() const;
+
+        // Make data point to the contiguous bytes available at the cursor
+        // and return their number, at most max_len. Only bytes appended
+        // up to the time until are returned, with the granularity of
+        // the seek index. Moves the cursor to the next segment once the
+        // current one is exhausted. The data stays valid as long as the
+        // cursor is not advanced or destroyed.
+        size_t peek(Cursor& cursor, const uint8_t **data, size_t max_len,
+                clock::time_point until = clock::time_point::max()) const;
+        void advance(Cursor& cursor, size_t len) const;
+
+        // Time at which the data at the cursor was appended, with the
+        // granularity of the seek index
+        clock::time_point time_at(const Cursor& cursor) const;
+
+        // Number of bytes appended before the cursor since the store was
+        // created, including the ones dropped or cleared since. Lines up
+        // with the byte positions of the live StreamRing.
+        uint64_t position(const Cursor& cursor) const;
+
+        // Time span covered by the stored audio
+        std::chrono::milliseconds duration() const;
+
+        const Settings& settings() const { return m_settings; }
+
+    private:
+        std::shared_ptr<Segment> next_segment(const Segment& segment) const;
+
+        const Settings m_settings;
+
+        mutable std::mutex m_mutex;
+        std::deque<std::shared_ptr<Segment> > m_segments;
+        uint64_t m_next_sequence = 0;
+        uint64_t m_position = 0;
+};
+
+class TimeShiftStore::Segment {
+    public:
+        struct IndexEntry {
+            clock::time_point time;
+            size_t offset;
+        };
+
+        Segment(const std::string& directory, size_t capacity,
+                uint64_t sequence, uint64_t position, clock::time_point start);
+        ~Segment();
+        Segment(const Segment&) = delete;
+        Segment& operator=(const Segment&) = delete;
+
+        const uint8_t *data() const { return m_data; }
+        size_t size() const { return m_size.load(std::memory_order_acquire); }
+        size_t capacity() const { return m_capacity; }
+        bool sealed() const { return m_sealed.load(std::memory_order_acquire); }
+
+        const uint64_t sequence;
+        const uint64_t position;  // Store position of the first byte
+        const clock::time_point start;
+
+    private:
+        friend class TimeShiftStore;
+
+        // Called by the writer only
+        void write(const uint8_t *data, size_t len);
+        void seal() { m_sealed.store(true, std::memory_order_release); }
+
+        uint8_t *m_data = nullptr;
+        size_t m_capacity = 0;
+        std::atomic<size_t> m_size = ATOMIC_VAR_INIT(0);
+        std::atomic<bool> m_sealed = ATOMIC_VAR_INIT(false);
+
+        // Protected by the store mutex
+        std::vector<IndexEntry> m_index;
+        clock::time_point m_last_time;
+};
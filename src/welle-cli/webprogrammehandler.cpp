@@ -34,13 +34,19 @@
 
 using namespace std;
 
-int MAX_PLAYBACK_TIME_SECONDS = 0;
-
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL 0
 #endif
 
-constexpr int AUDIO_CHUNK_SIZE = 5000;
+// Largest chunk of time-shifted audio queued at once
+constexpr size_t AUDIO_CHUNK_SIZE = 5000;
+
+// How far ahead of real time time-shifted audio is sent, so that
+// the player can fill its buffer
+constexpr chrono::seconds TIMESHIFT_PREBUFFER(2);
+
+// Number of encoder outputs kept for the live listeners
+constexpr size_t STREAM_RING_SIZE = 512;
 
 class IEncoder 
 {
@@ -161,182 +167,110 @@ class LameEncoder : public IEncoder {
 };
 
 
-ProgrammeSender::ProgrammeSender(Socket&& s) :
-    s(move(s))
+ProgrammeSender::ProgrammeSender(std::shared_ptr<HttpConnection> connection) :
+    connection(move(connection))
 {
 }
 
-ProgrammeSender::ProgrammeSender(ProgrammeSender&& other) :
-    s(move(other.s))
+void ProgrammeSender::seek(std::shared_ptr<TimeShiftStore> timeshift,
+        std::shared_ptr<StreamRing> stream,
+        TimeShiftStore::clock::time_point start)
 {
+    store = move(timeshift);
+    live = move(stream);
+    cursor = store->seek(start);
+    paced = false;
 }
 
-ProgrammeSender& ProgrammeSender::operator=(ProgrammeSender&& other)
-{
-    s = move(other.s);
-    other.running = false;
-    return *this;
-}
-
-
-// TODO mozna neposialt ten stream tak rychle ? dat tam nejaky sleep
-bool ProgrammeSender::send_stream(const std::vector<uint8_t>& headerdata, const std::vector<uint8_t>& mp3Data)
+bool ProgrammeSender::send_cached_stream()
 {
-    if (not s.valid()) {
-        return false;
-    }
-
-    const int flags = MSG_NOSIGNAL;
-    ssize_t ret = 0;
-
-    if (!headerSent)
-    {
-        ret = s.send(headerdata.data(), headerdata.size(), flags);
-        headerSent = true;
-    }
-
-    ret = s.send(mp3Data.data(), mp3Data.size(), flags);
-
-    // std::cout << "Sent data size: " << mp3Data.size() << endl;
-    // std::cout << "Sent data: " << ret << endl;
-    // std::cout << endl;
-
-    if (ret == -1) {
-        s.close();
-        std::unique_lock<std::mutex> lock(mutex);
-        running = false;
-        lock.unlock();
-        cv.notify_all();
-        return false;
-    }
-
-    return true;
-}
-
-bool ProgrammeSender::send_cached_stream(WebProgrammeHandler& webProgrammeHandler, ssize_t index) {
-    cached_mp3_index = webProgrammeHandler.audioBuffer.size() - index - 1;
-
-    while (running) {
-        if (!s.valid()) {
-            return false;
+    const auto now = chrono::steady_clock::now();
+
+    while (connection->backlog() < HttpConnection::low_water) {
+        const uint8_t *data = nullptr;
+        size_t len = 0;
+
+        auto until = TimeShiftStore::clock::time_point::max();
+        if (paced) {
+            until = origin_stream + TIMESHIFT_PREBUFFER +
+                chrono::duration_cast<TimeShiftStore::clock::duration>(
+                        now - origin_wall);
+            len = store->peek(cursor, &data, AUDIO_CHUNK_SIZE, until);
         }
 
-        const int flags = MSG_NOSIGNAL;
-        ssize_t ret = 0;
-
-        std::vector<uint8_t> samples = webProgrammeHandler.getAudioBufferChunk(cached_mp3_index);
-        if (static_cast<int>(samples.size()) == AUDIO_CHUNK_SIZE) {
-            cached_mp3_index += AUDIO_CHUNK_SIZE;
-            ret = s.send(samples.data(), samples.size(), flags);
-        } 
-
-        if (ret == -1) {
-            s.close();
-            {
-                std::unique_lock<std::mutex> lock(mutex);
-                running = false;
+        if (len == 0) {
+            len = store->peek(cursor, &data, AUDIO_CHUNK_SIZE);
+
+            if (len == 0) {
+                // Caught up with the store, the next byte is the one
+                // the live stream publishes next
+                if (live and live->subscribe_at(*connection,
+                            StreamRing::LagPolicy::SkipAhead,
+                            store->position(cursor))) {
+                    live.reset();
+                }
+                break;
+            }
+            else if (paced and
+                    store->time_at(cursor) < until + TIMESHIFT_PREBUFFER) {
+                // Ahead of time, the event loop calls again after the
+                // next publish
+                break;
             }
-            cv.notify_all();
-            return false;
-        }
-
-    }
-
-    return true;
-}
-
-// void WebProgrammeHandler::cache_mp3(const std::vector<uint8_t>& data) {
-//       std::unique_lock<std::mutex> mp3_lock(cached_mp3_mutex);
-//     // std::unique_lock<std::mutex> audio_buffer_lock(audio_buffer_mutex);
-
-//     for (uint8_t value : data) {
-//         if (this->audioBuffer.size() >= MAX_AUDIO_BUFFER_SIZE) {
-//             this->audioBuffer.pop_front();
-//         }
-//         this->audioBuffer.push_back(value);
-//     }
-
-//     for (auto& s : senders) {
-//         if (!s->isLive && s->cached_mp3_index - static_cast<int>(data.size()) > 0) {
-//             s->cached_mp3_index -= static_cast<int>(data.size());
-//         }
-//     }
-// }
-
-void writeMP3ToFile(const std::vector<uint8_t>& mp3Data, const std::string& filename) {
-    std::ofstream outFile(filename, std::ios::binary);
-    if (!outFile) {
-        std::cerr << "Error opening file for writing: " << filename << std::endl;
-        return;
-    }
-
-    outFile.write(reinterpret_cast<const char*>(mp3Data.data()), mp3Data.size());
-    outFile.close();
-}
-
-
-void WebProgrammeHandler::cache_mp3(const std::vector<uint8_t>& data) {
-    std::unique_lock<std::mutex> mp3_lock(cached_mp3_mutex);
 
-    int removed = 0;
-    for (uint8_t value : data) {
-        if (this->audioBuffer.size() >= MAX_PLAYBACK_TIME_SECONDS) {
-            this->audioBuffer.pop_front();
-            ++removed;
+            // Start pacing, or start over after a gap in the store
+            // left by a retune
+            paced = true;
+            origin_stream = store->time_at(cursor);
+            origin_wall = now;
         }
-        this->audioBuffer.push_back(value);
-    }
 
-    for (auto& s : senders) {
-        if (!s->isLive) {
-            s->cached_mp3_index = std::max(0, s->cached_mp3_index - removed);
+        if (connection->send(data, len, MSG_NOSIGNAL) == -1) {
+            return false;
         }
+        store->advance(cursor, len);
     }
 
-    bool saved = false;
-    if(audioBuffer.size() > 825600 && !saved) {
-        std::vector<uint8_t> mp3Vector(this->audioBuffer.begin(), this->audioBuffer.end());
-        writeMP3ToFile(mp3Vector, "output.mp3");
-        saved = true;
-    }
-
-}
-
-
-
-void ProgrammeSender::wait_for_termination() const
-{
-    std::unique_lock<std::mutex> lock(mutex);
-    while (running) {
-        cv.wait_for(lock, chrono::seconds(2));
-    }
+    return true;
 }
 
 void ProgrammeSender::cancel()
 {
-    s.close();
-    running = false;
+    connection->close();
 }
 
-WebProgrammeHandler::WebProgrammeHandler(uint32_t serviceId, OutputCodec codecID, long audioBufferMaxLen) :
-    serviceId(serviceId), codec(codecID)
+WebProgrammeHandler::WebProgrammeHandler(uint32_t serviceId, OutputCodec codecID,
+        const TimeShiftStore::Settings& timeshiftSettings,
+        bool audioOnDemand, std::function<void()> notify) :
+    serviceId(serviceId), codec(codecID), audioOnDemand(audioOnDemand),
+    stream(make_shared<StreamRing>(STREAM_RING_SIZE)),
+    timeshift(make_shared<TimeShiftStore>(timeshiftSettings)),
+    passthroughStream(make_shared<StreamRing>(STREAM_RING_SIZE))
 {
+    passthroughStream->set_notify(function<void()>(notify));
+    stream->set_notify(move(notify));
+
     const auto now = chrono::system_clock::now();
 
     time_label = now;
     time_label_change = now;
     time_mot = now;
     time_mot_change = now;
-    this->audioBufferMaxLen = audioBufferMaxLen;
-    MAX_PLAYBACK_TIME_SECONDS = audioBufferMaxLen;
 }
 
 WebProgrammeHandler::WebProgrammeHandler(WebProgrammeHandler&& other) :
     serviceId(other.serviceId),
     codec(other.codec),
-    senders(move(other.senders))
+    audioOnDemand(other.audioOnDemand),
+    senders(move(other.senders)),
+    stream(move(other.stream)),
+    streamHeader(move(other.streamHeader)),
+    timeshift(move(other.timeshift)),
+    passthroughStream(move(other.passthroughStream)),
+    passthroughListeners(move(other.passthroughListeners))
 {
     other.senders.clear();
+    other.passthroughListeners.clear();
     other.serviceId = 0;
 
     const auto now = chrono::system_clock::now();
@@ -366,39 +300,34 @@ void WebProgrammeHandler::removeSender(ProgrammeSender *sender)
 bool WebProgrammeHandler::needsToBeDecoded() const
 {
     std::unique_lock<std::mutex> lock(senders_mutex);
-    return not senders.empty();
+    return not senders.empty() or not passthroughListeners.empty();
 }
 
-void WebProgrammeHandler::cancelAll()
+bool WebProgrammeHandler::wantsDecodedAudio()
 {
+    // The time-shift store keeps the encoder output even without listeners,
+    // unless only the PAD of the idle programmes is of interest
     std::unique_lock<std::mutex> lock(senders_mutex);
-    for (auto& s : senders) {
-        s->cancel();
-    }
+    return not senders.empty() or
+        (not audioOnDemand and timeshift->settings().retention.count() > 0);
 }
-std::vector<uint8_t> WebProgrammeHandler::getAudioBufferChunk(int index)
-{
-    std::unique_lock<std::mutex> mp3_lock(cached_mp3_mutex);
 
-    if (index >= static_cast<int>(audioBuffer.size())) {
-        return {};  
-    }
+bool WebProgrammeHandler::wantsEncodedAudio()
+{
+    std::unique_lock<std::mutex> lock(senders_mutex);
+    return not passthroughListeners.empty();
+}
 
-    int availableSamples = static_cast<int>(audioBuffer.size()) - index;
-    if (availableSamples < AUDIO_CHUNK_SIZE) {
-        return {};
+void WebProgrammeHandler::cancelAll()
+{
+    std::unique_lock<std::mutex> lock(senders_mutex);
+    for (auto& s : senders) {
+        s->cancel();
     }
-
-    std::vector<uint8_t> samples;
-    samples.reserve(AUDIO_CHUNK_SIZE);
-
-    for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i) {
-        samples.push_back(audioBuffer[index + i]);
+    for (auto& c : passthroughListeners) {
+        c->close();
     }
-
-    return samples;
 }
-
 WebProgrammeHandler::dls_t WebProgrammeHandler::getDLS() const
 {
     dls_t dls;
@@ -509,18 +438,63 @@ void WebProgrammeHandler::onNewAudio(std::vector<int16_t>&& audioData,
 
 void WebProgrammeHandler::send_to_all_clients(const std::vector<uint8_t>& headerData, const std::vector<uint8_t>& data)
 {
-    std::unique_lock<std::mutex> lock(senders_mutex);
-
-    for (auto& s : senders) {
-        if(s->isLive){
-            bool success = s->send_stream(headerData, data);
-            if (not success) {
-                cerr << "Failed to send audio for " << serviceId << endl;
-            }
+    if (not headerData.empty()) {
+        std::unique_lock<std::mutex> lock(senders_mutex);
+        if (not streamHeader) {
+            streamHeader = make_shared<const vector<uint8_t> >(headerData);
         }
     }
 
-    cache_mp3(data);
+    // A single copy, shared by all listeners
+    stream->publish(make_shared<const vector<uint8_t> >(data));
+
+    try {
+        timeshift->append(data.data(), data.size());
+    }
+    catch (const runtime_error& e) {
+        cerr << "Failed to store audio for " << serviceId << ": " << e.what() << endl;
+    }
+}
+
+void WebProgrammeHandler::subscribe(HttpConnection& connection)
+{
+    HttpConnection::chunk_t header;
+    {
+        std::unique_lock<std::mutex> lock(senders_mutex);
+        header = streamHeader;
+    }
+
+    // Audio decoders resynchronise, a client that is too slow
+    // misses some audio instead of being dropped
+    stream->subscribe(connection, StreamRing::LagPolicy::SkipAhead,
+            StreamRing::Start::Live, header);
+}
+
+void WebProgrammeHandler::subscribePassthrough(const std::shared_ptr<HttpConnection>& connection)
+{
+    {
+        std::unique_lock<std::mutex> lock(senders_mutex);
+        passthroughListeners.push_back(connection);
+    }
+
+    // Both MP2 and LATM resynchronise, like the live stream
+    passthroughStream->subscribe(*connection, StreamRing::LagPolicy::SkipAhead,
+            StreamRing::Start::Live);
+}
+
+void WebProgrammeHandler::removePassthroughListener(const HttpConnection *connection)
+{
+    std::unique_lock<std::mutex> lock(senders_mutex);
+    passthroughListeners.remove_if(
+            [&](const std::shared_ptr<HttpConnection>& c) {
+                return c.get() == connection;
+            });
+}
+
+void WebProgrammeHandler::onEncodedAudio(const uint8_t *data, size_t len,
+        size_t /*duration_ms*/, const std::string& /*extension*/)
+{
+    passthroughStream->publish(make_shared<const vector<uint8_t> >(data, data + len));
 }
 
 void WebProgrammeHandler::onRsErrors(bool uncorrectedErrors, int numCorrectedErrors)
@@ -551,7 +525,7 @@ void WebProgrammeHandler::onNewDynamicLabel(const string& label)
         dls_buffer.push_back({label, now});
     }
 
-    const auto threshold = now - std::chrono::seconds(MAX_PLAYBACK_TIME_SECONDS);
+    const auto threshold = now - timeshift->settings().retention;
 
     int toRemove = -1;
     for (auto& record : dls_buffer) {
@@ -594,7 +568,7 @@ void WebProgrammeHandler::onMOT(const mot_file_t& mot_file)
         mot_buffer.push_back({mot_file.data, last_subtype, now});
     }
 
-    const auto threshold = now - std::chrono::seconds(MAX_PLAYBACK_TIME_SECONDS);
+    const auto threshold = now - timeshift->settings().retention;
 
     int toRemove = -1;
     for (auto& record : mot_buffer) {
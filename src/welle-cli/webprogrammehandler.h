@@ -24,7 +24,6 @@
  */
 #pragma once
 
-#include "various/Socket.h"
 #include "backend/radio-receiver.h"
 #include <cstdint>
 #include <memory>
@@ -35,26 +34,43 @@
 #include <deque>
 #include <shared_mutex>
 #include "webprogrammehandler.h"
+#include "timeshiftstore.h"
+#include "httpserver.h"
+#include "streamring.h"
 
 class WebProgrammeHandler;
 class ProgrammeSender {
     private:
-        Socket s;
+        std::shared_ptr<HttpConnection> connection;
 
-        std::atomic<bool> running = ATOMIC_VAR_INIT(true);
-        mutable std::condition_variable cv;
-        mutable std::mutex mutex;
-        bool headerSent = false;
+        // Read position for time-shifted playback
+        std::shared_ptr<TimeShiftStore> store;
+        TimeShiftStore::Cursor cursor;
+
+        // The live stream to continue with once the cursor reaches the
+        // end of the store
+        std::shared_ptr<StreamRing> live;
+
+        // Playback is paced so that the audio stored at origin_stream
+        // goes out at origin_wall
+        bool paced = false;
+        TimeShiftStore::clock::time_point origin_stream;
+        std::chrono::steady_clock::time_point origin_wall;
 
     public:
-        bool isLive = true;
-        int cached_mp3_index = 0;
-        ProgrammeSender(Socket&& s);
-        ProgrammeSender(ProgrammeSender&& other);
-        ProgrammeSender& operator=(ProgrammeSender&& other);
-        bool send_stream(const std::vector<uint8_t>& headerdata, const std::vector<uint8_t>& mp3data);
-        bool send_cached_stream(WebProgrammeHandler& webProgrammeHandler, ssize_t index);
-        void wait_for_termination() const;
+        explicit ProgrammeSender(std::shared_ptr<HttpConnection> connection);
+
+        // Start time-shifted playback at the given time
+        void seek(std::shared_ptr<TimeShiftStore> store,
+                std::shared_ptr<StreamRing> live,
+                TimeShiftStore::clock::time_point start);
+
+        // Queue the stored audio following the cursor, at the pace it
+        // was received, until the connection has enough to send. Called
+        // by the event loop whenever new audio was published, it switches
+        // the connection over to the live stream when there is nothing
+        // left in the store.
+        bool send_cached_stream();
         void cancel();
 };
 
@@ -87,12 +103,14 @@ class WebProgrammeHandler : public ProgrammeHandlerInterface {
             size_t num_aacErrors = 0;
         };
 
-        mutable std::mutex cached_mp3_mutex;
-        mutable std::mutex audio_buffer_mutex;
-
     private:
         uint32_t serviceId;
         const OutputCodec codec;
+
+        // Decode the audio only while somebody listens, and otherwise just
+        // the PAD. Without, the time-shift buffer keeps the audio of every
+        // decoded programme.
+        const bool audioOnDemand;
         std::unique_ptr<IEncoder> encoder;
 
         mutable std::mutex senders_mutex;
@@ -102,7 +120,17 @@ class WebProgrammeHandler : public ProgrammeHandlerInterface {
 
         errorcounters_t errorcounters;
 
-        int audioBufferMaxLen;
+        // Live encoded audio, and the stream header of the codec if it has one
+        std::shared_ptr<StreamRing> stream;
+        HttpConnection::chunk_t streamHeader;
+
+        // Encoded audio of the last minutes, for time-shifted playback
+        std::shared_ptr<TimeShiftStore> timeshift;
+
+        // The audio as broadcast, and the connections it is passed
+        // through to
+        std::shared_ptr<StreamRing> passthroughStream;
+        std::list<std::shared_ptr<HttpConnection> > passthroughListeners;
 
         bool last_label_valid = false;
         std::chrono::time_point<std::chrono::system_clock> time_label;
@@ -121,11 +149,14 @@ class WebProgrammeHandler : public ProgrammeHandlerInterface {
         audiolevels_t audiolevels;
 
     public:
-        std::deque<uint8_t> audioBuffer;
         int rate = 0;
         std::string mode;
 
-        WebProgrammeHandler(uint32_t serviceId, OutputCodec codec, long audioBufferMaxLen);
+        // notify is called whenever new audio is available for the
+        // listeners, see StreamRing::set_notify
+        WebProgrammeHandler(uint32_t serviceId, OutputCodec codec,
+                const TimeShiftStore::Settings& timeshiftSettings,
+                bool audioOnDemand, std::function<void()> notify);
         WebProgrammeHandler(WebProgrammeHandler&& other);
         ~WebProgrammeHandler();
 
@@ -134,8 +165,16 @@ class WebProgrammeHandler : public ProgrammeHandlerInterface {
         bool needsToBeDecoded() const;
         void cancelAll();
         void send_to_all_clients(const std::vector<uint8_t>& headerData, const std::vector<uint8_t>& data);
-        void cache_mp3(const std::vector<uint8_t>& data);
-        std::vector<uint8_t> getAudioBufferChunk(int);
+
+        // Stream the live audio to the connection
+        void subscribe(HttpConnection& connection);
+
+        // Stream the audio to the connection as broadcast, without
+        // decoding and encoding it again
+        void subscribePassthrough(const std::shared_ptr<HttpConnection>& connection);
+        void removePassthroughListener(const HttpConnection *connection);
+        std::shared_ptr<TimeShiftStore> getTimeShift() { return timeshift; }
+        std::shared_ptr<StreamRing> getStream() { return stream; }
 
         struct dls_t {
             std::string label;
@@ -174,5 +213,9 @@ class WebProgrammeHandler : public ProgrammeHandlerInterface {
         virtual void onNewDynamicLabel(const std::string& label) override;
         virtual void onMOT(const mot_file_t& mot_file) override;
         virtual void onPADLengthError(size_t announced_xpad_len, size_t xpad_len) override;
+        virtual bool wantsDecodedAudio(void) override;
+        virtual bool wantsEncodedAudio(void) override;
+        virtual void onEncodedAudio(const uint8_t *data, size_t len,
+                size_t duration_ms, const std::string& extension) override;
 };
 
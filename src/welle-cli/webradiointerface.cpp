@@ -32,7 +32,6 @@
 #include <cstring>
 #include <ctime>
 #include <errno.h>
-#include <future>
 #include <iomanip>
 #include <iostream>
 #include <regex>
@@ -51,7 +50,6 @@
 #endif
 
 #include <utility>
-#include "Socket.h"
 #include "channels.h"
 #include "ofdm-decoder.h"
 #include "radio-receiver.h"
@@ -83,6 +81,28 @@
 
 constexpr size_t MAX_PENDING_MESSAGES = 512;
 
+// Threads running the request handlers, the I/O itself is done by one
+// event loop. More than one so that a retune does not block everything.
+constexpr size_t NUM_HTTP_WORKERS = 4;
+
+// FIBs kept for the /fic clients, six seconds
+constexpr size_t FIC_RING_SIZE = 3*250;
+
+// How often the ensemble database gets updated while on one channel
+constexpr std::chrono::seconds ENSEMBLE_SAVE_INTERVAL(60);
+
+// Stop computing the plots once no client polled them for that long
+constexpr std::chrono::seconds PLOT_IDLE_TIMEOUT(10);
+
+// Weight of the newest frame in the averaged spectra, which settle
+// within about ten frames, i.e. one second
+constexpr float SPECTRUM_AVERAGING = 0.1f;
+
+// How often the /events clients get the changes of the mux.json, and how
+// many of them a client may lag behind before it gets dropped
+constexpr std::chrono::seconds EVENT_INTERVAL(1);
+constexpr size_t EVENT_RING_SIZE = 60;
+
 
 using namespace std;
 
@@ -94,11 +114,15 @@ static const char* http_500 = "HTTP/1.0 500 Internal Server Error\r\n";
 static const char* http_503 = "HTTP/1.0 503 Service Unavailable\r\n";
 static const char* http_contenttype_mp3 = "Content-Type: audio/mpeg\r\n";
 static const char* http_contenttype_flac = "Content-Type: audio/flac\r\n";
+static const char* http_contenttype_aac = "Content-Type: audio/aac\r\n";
 static const char* http_contenttype_m3u = "Content-Type: application/mpegurl\r\n";
 static const char* http_contenttype_text = "Content-Type: text/plain\r\n";
 static const char* http_contenttype_data =
         "Content-Type: application/octet-stream\r\n";
 
+static const char* http_contenttype_event_stream =
+        "Content-Type: text/event-stream\r\n";
+
 static const char* http_contenttype_json =
         "Content-Type: application/json; charset=utf-8\r\n";
 
@@ -112,6 +136,9 @@ static const char* http_nocache = "Cache-Control: no-cache\r\n";
 
 static const char* http_allow_origin = "Access-Control-Allow-Origin: *\r\n";
 
+// The next frame computes the plots, which is well within a second
+static const char* http_retry_after = "Retry-After: 1\r\n";
+
 static string to_hex(uint32_t value, int width)
 {
     std::stringstream sidstream;
@@ -121,7 +148,7 @@ static string to_hex(uint32_t value, int width)
     return sidstream.str();
 }
 
-static bool send_http_response(Socket& s, const string& statuscode,
+static bool send_http_response(HttpConnection& s, const string& statuscode,
         const string& data, const string& content_type = http_contenttype_text) {
     string headers = statuscode;
     headers += content_type;
@@ -144,16 +171,20 @@ WebRadioInterface::WebRadioInterface(CVirtualInput& in,
     input(in),
     spectrum_fft_handler(dabparams.T_u),
     rro(rro),
-    decode_settings(ds)
+    decode_settings(ds),
+    fic_stream(make_shared<StreamRing>(FIC_RING_SIZE)),
+    events_stream(make_shared<StreamRing>(EVENT_RING_SIZE))
 {
     {
         // Ensure that rx always exists when rx_mut is free!
         lock_guard<mutex> lock(rx_mut);
 
-        bool success = serverSocket.bind(port);
-        if (success) {
-            success = serverSocket.listen();
-        }
+        server = make_unique<HttpServer>(
+                [this](const shared_ptr<HttpConnection>& c, const HttpRequest& req) {
+                    dispatch_client(c, req);
+                }, NUM_HTTP_WORKERS);
+        notify_sources = server->source_notifier();
+        bool success = server->listen(port);
 
         if (success) {
             rx = make_unique<RadioReceiver>(*this, in, rro);
@@ -165,24 +196,80 @@ WebRadioInterface::WebRadioInterface(CVirtualInput& in,
 
         time_rx_created = chrono::system_clock::now();
         rx->restart(false);
+
+        if (not ds.ensemble_directory.empty()) {
+            ensemble_database = make_unique<EnsembleDatabase>(ds.ensemble_directory);
+            load_ensemble();
+        }
     }
 
+    fic_stream->set_notify(server->source_notifier());
+    events_stream->set_notify(server->source_notifier());
     programme_handler_thread = thread(&WebRadioInterface::handle_phs, this);
+    events_thread = thread(&WebRadioInterface::push_events, this);
 }
 
 WebRadioInterface::~WebRadioInterface()
 {
+    // The close handlers of the connections still need the receiver
+    server.reset();
+
     running = false;
+    events_running = false;
     if (programme_handler_thread.joinable()) {
         programme_handler_thread.join();
     }
+    if (events_thread.joinable()) {
+        events_thread.join();
+    }
 
     {
         lock_guard<mutex> lock(rx_mut);
+        save_ensemble();
         rx.reset();
     }
 }
 
+void WebRadioInterface::load_ensemble()
+{
+    if (not ensemble_database) {
+        return;
+    }
+
+    try {
+        const auto chan = channels.getChannelForFrequency(input.getFrequency());
+
+        EnsembleConfiguration config;
+        if (ensemble_database->load(chan, config)) {
+            rx->loadEnsemble(config);
+        }
+    }
+    catch (const out_of_range&) {
+        // Not tuned to a known channel
+    }
+    time_ensemble_saved = chrono::steady_clock::now();
+}
+
+void WebRadioInterface::save_ensemble()
+{
+    if (not ensemble_database or not rx) {
+        return;
+    }
+
+    try {
+        const auto chan = channels.getChannelForFrequency(input.getFrequency());
+
+        const auto config = rx->getEnsembleConfiguration();
+        if (not config.services.empty() and
+                not ensemble_database->save(chan, config)) {
+            cerr << "Could not save the ensemble of channel " << chan << endl;
+        }
+    }
+    catch (const out_of_range&) {
+    }
+    time_ensemble_saved = chrono::steady_clock::now();
+}
+
 class TuneFailed {};
 
 void WebRadioInterface::check_decoders_required()
@@ -205,6 +292,7 @@ void WebRadioInterface::check_decoders_required()
                 const bool require =
                     rx->serviceHasAudioComponent(s) and
                     (decode_settings.strategy == DecodeStrategy::All or
+                     decode_settings.strategy == DecodeStrategy::AllPAD or
                      phs.at(sid).needsToBeDecoded() or
                      is_active);
                 const bool is_decoded = programmes_being_decoded[sid];
@@ -275,6 +363,8 @@ void WebRadioInterface::retune(const std::string& channel)
         // we check to uncover errors.
         ASSERT_RX;
 
+        save_ensemble();
+
         cerr << "RETUNE Destroy RX" << endl;
         rx.reset();
 
@@ -306,6 +396,7 @@ void WebRadioInterface::retune(const std::string& channel)
 
         time_rx_created = chrono::system_clock::now();
         rx->restart(false);
+        load_ensemble();
 
         phs.clear();
 
@@ -315,292 +406,149 @@ void WebRadioInterface::retune(const std::string& channel)
     }
 }
 
-static string recv_line(Socket& s) {
-    string line;
-    bool cr_seen = false;
+bool WebRadioInterface::dispatch_client(
+        const shared_ptr<HttpConnection>& connection,
+        const HttpRequest& req)
+{
+    HttpConnection& s = *connection;
+    bool success = false;
 
-    while (true) {
-        char c = 0;
-        ssize_t ret = s.recv(&c, 1, 0);
-        if (ret == 0) {
-            return "";
+    if (req.is_get) {
+        if (req.url == "/") {
+            success = send_file(s, "index.html", http_contenttype_html);
         }
-        else if (ret == -1) {
-            string errstr = strerror(errno);
-            cerr << "recv error " << errstr << endl;
-            return "";
+        else if (req.url == "/index.js") {
+            success = send_file(s, "index.js", http_contenttype_js);
         }
-
-        line += c;
-
-        if (c == '\r') {
-            cr_seen = true;
+        else if (req.url == "/mux.json") {
+            success = send_mux_json(s);
         }
-        else if (cr_seen and c == '\n') {
-            return line;
+        else if (req.url == "/events") {
+            success = send_events(s);
         }
-    }
-}
-
-static vector<char> recv_exactly(Socket& s, size_t num_bytes)
-{
-    vector<char> buf(num_bytes);
-    size_t rx = 0;
-
-    while (rx < num_bytes) {
-        const size_t remain = num_bytes - rx;
-        ssize_t ret = s.recv(buf.data() + rx, remain, 0);
-
-        if (ret == 0) {
-            break;
+#if defined(WITH_PROFILING)
+        else if (req.url == "/profiling.json") {
+            success = send_profiling_json(s);
         }
-        else if (ret == -1) {
-            string errstr = strerror(errno);
-            cerr << "recv error " << errstr << endl;
-            return {};
+#endif
+        else if (req.url == "/mux.m3u") {
+            success = send_mux_playlist(s);
         }
-        else {
-            rx += ret;
+        else if (req.url == "/fic") {
+            success = send_fic(s);
         }
-    }
-
-    return buf;
-}
-
-static vector<string> split(const string& str, char c = ' ')
-{
-    const char *s = str.data();
-    vector<string> result;
-    do {
-        const char *begin = s;
-        while (*s != c && *s)
-            s++;
-        result.push_back(string(begin, s));
-    } while (0 != *s++);
-    return result;
-}
-
-struct http_request_t {
-    bool valid = false;
-
-    bool is_get = false;
-    bool is_post = false;
-    string url;
-    map<string, string> headers;
-    string post_data;
-};
-
-
-static http_request_t parse_http_headers(Socket& s) {
-    http_request_t r;
-
-    const auto first_line = recv_line(s);
-    const auto request_type = split(first_line);
-
-    if (request_type.size() != 3) {
-        cerr << "Malformed request: " << first_line << endl;
-        return r;
-    }
-    else if (request_type[0] == "GET") {
-        r.is_get = true;
-    }
-    else if (request_type[0] == "POST") {
-        r.is_post = true;
-    }
-    else {
-        return r;
-    }
-
-    r.url = request_type[1];
-
-    while (true) {
-        string header_line = recv_line(s);
-
-        if (header_line == "\r\n") {
-            break;
+        else if (req.url == "/impulseresponse") {
+            success = send_impulseresponse(s);
+        }
+        else if (req.url == "/spectrum") {
+            success = send_spectrum(s);
+        }
+        else if (req.url == "/constellation") {
+            success = send_constellation(s);
+        }
+        else if (req.url == "/nullspectrum") {
+            success = send_null_spectrum(s);
+        }
+        else if (req.url == "/channel") {
+            success = send_channel(s);
         }
+        else if (req.url == "/fftwindowplacement" or req.url == "/enablecoarsecorrector") {
+            send_http_response(s, http_405,
+                    "405 Method Not Allowed\r\n" + req.url + " is POST-only");
+            return false;
+        }
+        else {
+            const regex regex_slide(R"(^[/]slide[/]([^ ]+))");
+            std::smatch match_slide;
 
-        const auto header = split(header_line, ':');
+            const std::regex regex_buffered_slide(R"(^/buffered_slide\?sid=([^&]+)&time=([^&]+)$)");
+            std::smatch match_buffered_slide;
 
-        if (header.size() == 2) {
-            r.headers.emplace(header[0], header[1]);
-        }
-    }
+            const std::regex regex_buffered_dls(R"(^/buffered_dls\?sid=([^&]+)&time=([^&]+)$)");
+            std::smatch match_buffered_dls;
 
-    if (r.is_post) {
-        constexpr auto CL = "Content-Length";
-        if (r.headers.count(CL) == 1) {
-            try {
-                const int content_length = std::stoi(r.headers[CL]);
-                if (content_length > 1024 * 1024) {
-                    cerr << "Unreasonable POST Content-Length: " << content_length << endl;
-                    return r;
-                }
+            const regex regex_stream(R"(^[/]stream[/]([^ ]+))");
+            std::smatch match_stream;
 
-                const auto buf = recv_exactly(s, content_length);
-                r.post_data = string(buf.begin(), buf.end());
-            }
-            catch (const invalid_argument&) {
-                cerr << "Cannot parse POST Content-Length: " << r.headers[CL] << endl;
-                return r;
-            }
-            catch (const out_of_range&) {
-                cerr << "Cannot represent POST Content-Length: " << r.headers[CL] << endl;
-                return r;
-            }
-        }
-    }
+            const regex regex_passthrough(R"(^[/](aac|mp2)[/]([^ ]+))");
+            std::smatch match_passthrough;
 
-    r.valid = true;
-    return r;
-}
+            const std::regex regex_buffered_audio_size(R"(^[/]playback_time[/]([^ ]+))");
+            std::smatch match_buffered_audio_size;
 
-bool WebRadioInterface::dispatch_client(Socket&& client)
-{
-    Socket s(move(client));
+            const std::regex regex_buffered_mp3(R"(^/buffered_mp3\?sid=([^&]+)&offsetMs=([^&]+)$)");
+            std::smatch match_buffered_mp3;
 
-    bool success = false;
+            const regex regex_mp3(R"(^[/]mp3[/]([^ ]+))");
+            std::smatch match_mp3;
 
-    if (not s.valid()) {
-        cerr << "socket in dispatcher not valid!" << endl;
-        return false;
-    }
+            const regex regex_flac(R"(^[/]flac[/]([^ ]+))");
+            std::smatch match_flac;
 
-    const auto req = parse_http_headers(s);
+            const bool mp3 = decode_settings.outputCodec == OutputCodec::MP3;
+            const bool flac = decode_settings.outputCodec == OutputCodec::FLAC;
 
-    if (not req.valid) {
-        return false;
-    }
-    else {
-        if (req.is_get) {
-            if (req.url == "/") {
-                success = send_file(s, "index.html", http_contenttype_html);
+            if (regex_search(req.url, match_stream, regex_stream)) {
+                success = send_stream(s, match_stream[1]);
             }
-            else if (req.url == "/index.js") {
-                success = send_file(s, "index.js", http_contenttype_js);
+            else if (regex_search(req.url, match_passthrough, regex_passthrough)) {
+                success = send_passthrough_stream(s, match_passthrough[2], match_passthrough[1]);
             }
-            else if (req.url == "/mux.json") {
-                success = send_mux_json(s);
+            else if (mp3 and regex_search(req.url, match_buffered_audio_size, regex_buffered_audio_size)) {
+                success = send_buffered_audio_size(s, match_buffered_audio_size[1]);
             }
-            else if (req.url == "/mux.m3u") {
-                success = send_mux_playlist(s);
+            else if (mp3 and regex_search(req.url, match_buffered_mp3, regex_buffered_mp3)) {
+                success = send_buffered_stream(s, match_buffered_mp3[1], match_buffered_mp3[2]);
             }
-            else if (req.url == "/fic") {
-                success = send_fic(s);
+            // const std::regex regex_cache_mp3(R"(^[/]cache_mp3[/]([^ ]+))");
+            // std::smatch match_cached_mp3;
+            // else if (regex_search(req.url, match_cached_mp3, regex_cache_mp3)) {
+            //     success = send_cached_stream(s, match_cached_mp3[1]);
+            // }
+            else if (mp3 and regex_search(req.url, match_mp3, regex_mp3)) {
+                success = send_stream(s, match_mp3[1]);
             }
-            else if (req.url == "/impulseresponse") {
-                success = send_impulseresponse(s);
+            else if (flac and regex_search(req.url, match_flac, regex_flac)) {
+                success = send_stream(s, match_flac[1]);
             }
-            else if (req.url == "/spectrum") {
-                success = send_spectrum(s);
-            }
-            else if (req.url == "/constellation") {
-                success = send_constellation(s);
-            }
-            else if (req.url == "/nullspectrum") {
-                success = send_null_spectrum(s);
-            }
-            else if (req.url == "/channel") {
-                success = send_channel(s);
-            }
-            else if (req.url == "/fftwindowplacement" or req.url == "/enablecoarsecorrector") {
-                send_http_response(s, http_405,
-                        "405 Method Not Allowed\r\n" + req.url + " is POST-only");
-                return false;
+            else if (regex_search(req.url, match_slide, regex_slide)) {
+                success = send_slide(s, match_slide[1]);
+            } else if(regex_search(req.url, match_buffered_slide, regex_buffered_slide)) {
+                success = send_buffered_slide(s, match_buffered_slide[1], match_buffered_slide[2]);
+            } else if(regex_search(req.url, match_buffered_dls, regex_buffered_dls)) {
+                success = send_buffered_dls(s, match_buffered_dls[1], match_buffered_dls[2]);
             }
             else {
-                const regex regex_slide(R"(^[/]slide[/]([^ ]+))");
-                std::smatch match_slide;
-
-                const std::regex regex_buffered_slide(R"(^/buffered_slide\?sid=([^&]+)&time=([^&]+)$)");
-                std::smatch match_buffered_slide;
-
-                const std::regex regex_buffered_dls(R"(^/buffered_dls\?sid=([^&]+)&time=([^&]+)$)");
-                std::smatch match_buffered_dls;
-
-                const regex regex_stream(R"(^[/]stream[/]([^ ]+))");
-                std::smatch match_stream;
-                if (regex_search(req.url, match_stream, regex_stream)) {
-                    success = send_stream(s, match_stream[1]);
-                }
-
-                if (decode_settings.outputCodec == OutputCodec::MP3)
-                {
-                    const std::regex regex_buffered_audio_size(R"(^[/]playback_time[/]([^ ]+))");
-                    std::smatch match_buffered_audio_size;
-                    if (regex_search(req.url, match_buffered_audio_size, regex_buffered_audio_size)) {
-                        success = send_buffered_audio_size(s, match_buffered_audio_size[1]);
-                    } 
-
-                    const std::regex regex_buffered_mp3(R"(^/buffered_mp3\?sid=([^&]+)&offsetMs=([^&]+)$)");
-                    std::smatch match_buffered_mp3;
-                    if (regex_search(req.url, match_buffered_mp3, regex_buffered_mp3)) {
-                        success = send_buffered_stream(s, match_buffered_mp3[1], match_buffered_mp3[2]);
-                    }
-
-                    // const std::regex regex_cache_mp3(R"(^[/]cache_mp3[/]([^ ]+))");
-                    // std::smatch match_cached_mp3;
-                    // if (regex_search(req.url, match_cached_mp3, regex_cache_mp3)) {
-                    //     success = send_cached_stream(s, match_cached_mp3[1]);
-                    // } 
-
-
-                    // TODO dat nejak do elsumatch_cached_mp3
-                    const regex regex_mp3(R"(^[/]mp3[/]([^ ]+))");
-                    std::smatch match_mp3;
-                    if (regex_search(req.url, match_mp3, regex_mp3)) {
-                        success = send_stream(s, match_mp3[1]);
-                    }
-                }
-
-                if (decode_settings.outputCodec == OutputCodec::FLAC)
-                {
-                    const regex regex_flac(R"(^[/]flac[/]([^ ]+))");
-                    std::smatch match_flac;
-                    if (regex_search(req.url, match_flac, regex_flac)) {
-                        success = send_stream(s, match_flac[1]);
-                    }
-                } 
-                
-                else if (regex_search(req.url, match_slide, regex_slide)) {
-                    success = send_slide(s, match_slide[1]);
-                } else if(regex_search(req.url, match_buffered_slide, regex_buffered_slide)) {
-                    success = send_buffered_slide(s, match_buffered_slide[1], match_buffered_slide[2]);
-                } else if(regex_search(req.url, match_buffered_dls, regex_buffered_dls)) {
-                    success = send_buffered_dls(s, match_buffered_dls[1], match_buffered_dls[2]);
-                }
-                else {
-                    cerr << "Could not understand GET request " << req.url << endl;
-                }
+                cerr << "Could not understand GET request " << req.url << endl;
             }
         }
-        else if (req.is_post) {
-            if (req.url == "/channel") {
-                success = handle_channel_post(s, req.post_data);
-            }
-            else if (req.url == "/fftwindowplacement") {
-                success = handle_fft_window_placement_post(s, req.post_data);
-            }
-            else if (req.url == "/enablecoarsecorrector") {
-                success = handle_coarse_corrector_post(s, req.post_data);
-            }
-            else {
-                cerr << "Could not understand POST request " << req.url << endl;
-            }
+    }
+    else if (req.is_post) {
+        if (req.url == "/channel") {
+            success = handle_channel_post(s, req.post_data);
         }
-        else {
-            throw logic_error("valid req is neither GET nor POST!");
+        else if (req.url == "/fftwindowplacement") {
+            success = handle_fft_window_placement_post(s, req.post_data);
         }
-
-        if (not success) {
-            send_http_response(s, http_404, "Could not understand request.\r\n");
+        else if (req.url == "/enablecoarsecorrector") {
+            success = handle_coarse_corrector_post(s, req.post_data);
+        }
+        else {
+            cerr << "Could not understand POST request " << req.url << endl;
         }
+    }
+    else {
+        throw logic_error("valid req is neither GET nor POST!");
+    }
 
-        return success;
+    if (not success) {
+        send_http_response(s, http_404, "Could not understand request.\r\n");
     }
+
+    return success;
 }
 
-bool WebRadioInterface::send_file(Socket& s,
+bool WebRadioInterface::send_file(HttpConnection& s,
         const std::string& filename,
         const std::string& content_type)
 {
@@ -669,7 +617,7 @@ static vector<PeakJson> calculate_cir_peaks(const vector<float>& cir_linear)
     return peaks;
 }
 
-bool WebRadioInterface::send_mux_json(Socket& s)
+MuxJson WebRadioInterface::collect_mux_json(bool take_messages)
 {
     MuxJson mux_json;
 
@@ -691,12 +639,13 @@ bool WebRadioInterface::send_mux_json(Socket& s)
         lock_guard<mutex> lock(rx_mut);
         ASSERT_RX;
 
-        mux_json.ensemble.label = rx->getEnsembleLabel();
+        const auto ensemble = rx->getEnsembleSnapshot();
+        mux_json.ensemble.label = ensemble->ensembleLabel;
 
-        mux_json.ensemble.id = to_hex(rx->getEnsembleId(), 4);
-        mux_json.ensemble.ecc = to_hex(rx->getEnsembleEcc(), 2);
+        mux_json.ensemble.id = to_hex(ensemble->ensembleId, 4);
+        mux_json.ensemble.ecc = to_hex(ensemble->ensembleEcc, 2);
 
-        for (const auto& s : rx->getServiceList()) {
+        for (const auto& s : ensemble->services) {
             ServiceJson service;
             service.sid = to_hex(s.serviceId, 4);
             service.programType = s.programType;
@@ -705,15 +654,16 @@ bool WebRadioInterface::send_mux_json(Socket& s)
             service.languagestring = DABConstants::getLanguageName(s.language);
             service.label = s.serviceLabel;
             service.url_mp3 = "";
+            service.url_passthrough = "";
 
-            for (const auto& sc : rx->getComponents(s)) {
+            for (const auto& sc : ensemble->getComponents(s)) {
                 ComponentJson component;
                 component.componentnr = sc.componentNr;
                 component.primary = (sc.PS_flag ? true : false);
                 component.caflag = (sc.CAflag ? true : false);
                 component.label = sc.componentLabel;
 
-                const auto sub = rx->getSubchannel(sc);
+                const auto sub = ensemble->getSubchannel(sc);
 
                 switch (sc.transportMode()) {
                     case TransportMode::Audio:
@@ -727,6 +677,9 @@ bool WebRadioInterface::send_mux_json(Socket& s)
                             sc.audioType() == AudioServiceComponentType::DABPlus) {
                             string urlmp3 = "/mp3/" + to_hex(s.serviceId, 4);
                             service.url_mp3 = urlmp3;
+                            service.url_passthrough =
+                                (sc.audioType() == AudioServiceComponentType::DABPlus ? "/aac/" : "/mp2/") +
+                                to_hex(s.serviceId, 4);
                         }
                         break;
                     case TransportMode::FIDC:
@@ -804,7 +757,12 @@ bool WebRadioInterface::send_mux_json(Socket& s)
         mux_json.utctime.minutes = last_dateTime.minutes;
         mux_json.utctime.lto = last_dateTime.hourOffset + ((double)last_dateTime.minuteOffset / 30.0);
 
-        for (const auto& m : pending_messages) {
+        decltype(pending_messages) messages;
+        if (take_messages) {
+            swap(messages, pending_messages);
+        }
+
+        for (const auto& m : messages) {
             using namespace chrono;
 
             stringstream ss;
@@ -831,8 +789,6 @@ bool WebRadioInterface::send_mux_json(Socket& s)
             mux_json.messages.push_back(ss.str());
         }
 
-        pending_messages.clear();
-
         mux_json.demodulator_snr = last_snr;
         mux_json.demodulator_frequencycorrection = last_fine_correction + last_coarse_correction;
         mux_json.demodulator_timelastfct0frame = rx->getReceiverStats().timeLastFCT0Frame;
@@ -845,6 +801,13 @@ bool WebRadioInterface::send_mux_json(Socket& s)
         mux_json.cir_peaks = calculate_cir_peaks(last_CIR);
     }
 
+    return mux_json;
+}
+
+bool WebRadioInterface::send_mux_json(HttpConnection& s)
+{
+    const auto mux_json = collect_mux_json(true);
+
     if (not send_http_response(s, http_ok, "", http_contenttype_json)) {
         return false;
     }
@@ -859,7 +822,25 @@ bool WebRadioInterface::send_mux_json(Socket& s)
     return true;
 }
 
-bool WebRadioInterface::send_mux_playlist(Socket& s)
+#if defined(WITH_PROFILING)
+bool WebRadioInterface::send_profiling_json(HttpConnection& s)
+{
+    if (not send_http_response(s, http_ok, "", http_contenttype_json)) {
+        return false;
+    }
+
+    const auto json_str = build_profiling_json(get_profiler().snapshot());
+
+    ssize_t ret = s.send(json_str.c_str(), json_str.size(), MSG_NOSIGNAL);
+    if (ret == -1) {
+        cerr << "Failed to send profiling.json data" << endl;
+        return false;
+    }
+    return true;
+}
+#endif
+
+bool WebRadioInterface::send_mux_playlist(HttpConnection& s)
 {
     stringstream m3u;
     m3u << "#EXTM3U\n";
@@ -868,12 +849,13 @@ bool WebRadioInterface::send_mux_playlist(Socket& s)
         lock_guard<mutex> lock(rx_mut);
         ASSERT_RX;
 
-        for (const auto& s : rx->getServiceList()) {
+        const auto ensemble = rx->getEnsembleSnapshot();
+        for (const auto& s : ensemble->services) {
             auto hex_sid = to_hex(s.serviceId, 4);
             auto label = s.serviceLabel.utf8_label();
             string url_mp3 = "";
 
-            for (const auto& sc : rx->getComponents(s)) {
+            for (const auto& sc : ensemble->getComponents(s)) {
                 switch (sc.transportMode()) {
                     case TransportMode::Audio:
                         if (sc.audioType() == AudioServiceComponentType::DAB or
@@ -906,7 +888,7 @@ bool WebRadioInterface::send_mux_playlist(Socket& s)
     return true;
 }
 
-bool WebRadioInterface::send_stream(Socket& s, const std::string& stream)
+bool WebRadioInterface::send_stream(HttpConnection& s, const std::string& stream)
 {
     unique_lock<mutex> lock(rx_mut);
     ASSERT_RX;
@@ -918,8 +900,6 @@ bool WebRadioInterface::send_stream(Socket& s, const std::string& stream)
             try {
                 auto& ph = phs.at(srv.serviceId);
 
-                lock.unlock();
-
                 std::string http_contenttype;
 
                 switch (decode_settings.outputCodec)
@@ -938,16 +918,16 @@ bool WebRadioInterface::send_stream(Socket& s, const std::string& stream)
                     cerr << "Failed to send mp3 headers" << endl;
                     return false;
                 }
+                s.start_stream();
 
-                ProgrammeSender sender(move(s));
+                auto sender = make_shared<ProgrammeSender>(s.shared_from_this());
 
                 cerr << "Registering mp3 sender" << endl;
-                ph.registerSender(&sender);
-                check_decoders_required();
-                sender.wait_for_termination();
+                ph.registerSender(sender.get());
+                ph.subscribe(s);
+                lock.unlock();
 
-                cerr << "Removing mp3 sender" << endl;
-                ph.removeSender(&sender);
+                remove_sender_on_close(s, srv.serviceId, sender);
                 check_decoders_required();
 
                 return true;
@@ -964,10 +944,74 @@ bool WebRadioInterface::send_stream(Socket& s, const std::string& stream)
     return false;
 }
 
+bool WebRadioInterface::send_passthrough_stream(HttpConnection& s,
+        const std::string& stream, const std::string& extension)
+{
+    unique_lock<mutex> lock(rx_mut);
+    ASSERT_RX;
+
+    const auto ensemble = rx->getEnsembleSnapshot();
+    try {
+        for (const auto& srv : ensemble->services) {
+            if (to_hex(srv.serviceId, 4) != stream and
+                    (uint32_t)std::stoul(stream) != srv.serviceId) {
+                continue;
+            }
+
+            const auto expectedType = (extension == "aac") ?
+                AudioServiceComponentType::DABPlus :
+                AudioServiceComponentType::DAB;
+
+            for (const auto& sc : ensemble->getComponents(srv)) {
+                if (sc.transportMode() != TransportMode::Audio or
+                        sc.audioType() != expectedType) {
+                    continue;
+                }
+
+                auto& ph = phs.at(srv.serviceId);
+
+                if (not send_http_response(s, http_ok, "", extension == "aac" ?
+                            http_contenttype_aac : http_contenttype_mp3)) {
+                    cerr << "Failed to send " << extension << " headers" << endl;
+                    return false;
+                }
+                s.start_stream();
+                ph.subscribePassthrough(s.shared_from_this());
+                lock.unlock();
+
+                const HttpConnection *connection = &s;
+                const auto sid = srv.serviceId;
+                s.on_close([this, sid, connection]() {
+                        {
+                            lock_guard<mutex> lock(rx_mut);
+                            auto ph = phs.find(sid);
+                            if (ph != phs.end()) {
+                                ph->second.removePassthroughListener(connection);
+                            }
+                        }
+                        check_decoders_required();
+                    });
+                check_decoders_required();
+
+                return true;
+            }
+
+            send_http_response(s, http_404, "404 Not Found\r\nThe programme has no " +
+                    extension + " audio.\r\n");
+            return true;
+        }
+    }
+    catch (const std::exception& e) {
+        send_http_response(s, http_503, e.what());
+        return true;
+    }
+    return false;
+}
+
 const int MAX_BUFFER_TIME_MS = 50000; 
 
 
-bool WebRadioInterface::send_buffered_stream(Socket& s, const std::string& stream, const std::string& offsetMsStr)
+bool WebRadioInterface::send_buffered_stream(HttpConnection& s, const std::string& stream, const std::string& offsetMsStr)
 {
     unique_lock<mutex> lock(rx_mut);
     ASSERT_RX;
@@ -980,16 +1024,14 @@ bool WebRadioInterface::send_buffered_stream(Socket& s, const std::string& strea
 
                 auto& ph = phs.at(srv.serviceId);
 
-                double offsetSeconds = std::stod(offsetMsStr) / 1000;
-                double index = offsetSeconds * ((double) ph.rate / 2.0);
-                long long preciseIndex = std::round(index);
-
-                if(preciseIndex > ph.audioBuffer.size()) {
-                    cerr << "Index out of bounds" << endl;
+                // The offset is counted back from live, seek() clamps it
+                // to the oldest audio still stored
+                const auto offset = chrono::milliseconds(std::stoll(offsetMsStr));
+                if (offset.count() < 0) {
+                    cerr << "Negative time-shift offset" << endl;
                     return false;
                 }
-
-                lock.unlock();
+                const auto start = TimeShiftStore::clock::now() - offset;
 
                 std::string http_contenttype;
 
@@ -1010,16 +1052,19 @@ bool WebRadioInterface::send_buffered_stream(Socket& s, const std::string& strea
                     cerr << "Failed to send mp3 headers" << endl;
                     return false;
                 }
+                s.start_stream();
 
-                ProgrammeSender sender(move(s));
-                sender.isLive = false;
+                auto sender = make_shared<ProgrammeSender>(s.shared_from_this());
+                sender->seek(ph.getTimeShift(), ph.getStream(), start);
 
-                ph.registerSender(&sender);
-                check_decoders_required();
+                ph.registerSender(sender.get());
+                lock.unlock();
 
-                sender.send_cached_stream(ph, preciseIndex);
-                
-                ph.removeSender(&sender);
+                // The event loop pulls from the store as the client reads
+                s.set_source([sender](HttpConnection&) {
+                        return sender->send_cached_stream();
+                    });
+                remove_sender_on_close(s, srv.serviceId, sender);
                 check_decoders_required();
 
                 return true;
@@ -1034,7 +1079,7 @@ bool WebRadioInterface::send_buffered_stream(Socket& s, const std::string& strea
     return false;
 }
 
-bool WebRadioInterface::send_slide(Socket& s, const std::string& stream)
+bool WebRadioInterface::send_slide(HttpConnection& s, const std::string& stream)
 {
     for (const auto& wph : phs) {
         if (to_hex(wph.first, 4) == stream or
@@ -1088,7 +1133,7 @@ bool WebRadioInterface::send_slide(Socket& s, const std::string& stream)
     return false;
 }
 
-bool WebRadioInterface::send_buffered_slide(Socket& s, const std::string& stream, const std::string& timestamp_str)
+bool WebRadioInterface::send_buffered_slide(HttpConnection& s, const std::string& stream, const std::string& timestamp_str)
 {
    try {
         long long timestamp = std::stoll(timestamp_str);
@@ -1166,7 +1211,7 @@ bool WebRadioInterface::send_buffered_slide(Socket& s, const std::string& stream
     return false;
 }
 
-bool WebRadioInterface::send_buffered_dls(Socket& s, const std::string& stream, const std::string& timestamp_str)
+bool WebRadioInterface::send_buffered_dls(HttpConnection& s, const std::string& stream, const std::string& timestamp_str)
 {
     try {
         unique_lock<mutex> lock(rx_mut);
@@ -1228,153 +1273,146 @@ bool WebRadioInterface::send_buffered_dls(Socket& s, const std::string& stream,
     return false;
 }
 
-bool WebRadioInterface::send_fic(Socket& s)
+bool WebRadioInterface::send_events(HttpConnection& s)
 {
-    if (not send_http_response(s, http_ok, "", http_contenttype_data)) {
-        cerr << "Failed to send FIC headers" << endl;
+    if (not send_http_response(s, http_ok, "", http_contenttype_event_stream)) {
+        cerr << "Failed to send event stream headers" << endl;
         return false;
     }
 
-    while (true) {
-        unique_lock<mutex> lock(fib_mut);
-        while (fib_blocks.empty()) {
-            new_fib_block_available.wait_for(lock, chrono::seconds(1));
-        }
-        ssize_t ret = s.send(fib_blocks.front().data(),
-                fib_blocks.front().size(), MSG_NOSIGNAL);
-        if (ret == -1) {
-            cerr << "Failed to send FIC data" << endl;
-            return false;
-        }
+    s.start_stream();
 
-        fib_blocks.pop_front();
-    }
+    // The snapshot has to be the state the next patch in the ring applies
+    // to, so publish what changed since the last patch first
+    lock_guard<mutex> lock(events_mut);
+    publish_mux_patch(collect_mux_json(false));
+
+    const string snapshot = "event: snapshot\ndata: " +
+        mux_tracker.snapshot() + "\n\n";
+    auto header = make_shared<vector<uint8_t> >(snapshot.begin(), snapshot.end());
+
+    num_event_clients++;
+    s.on_close([this]() { num_event_clients--; });
+
+    events_stream->subscribe(s, StreamRing::LagPolicy::Drop,
+            StreamRing::Start::Live, move(header));
     return true;
 }
 
-bool WebRadioInterface::send_impulseresponse(Socket& s)
+void WebRadioInterface::publish_mux_patch(const MuxJson& mux_json)
 {
-    if (not send_http_response(s, http_ok, "", http_contenttype_data)) {
-        cerr << "Failed to send CIR headers" << endl;
-        return false;
+    // events_mut must already be locked, and have been when mux_json was
+    // collected. Otherwise an older state could be published after a newer
+    // one, and the patch would revert the clients to it.
+    const auto patch = mux_tracker.update(mux_json);
+    if (not patch.empty()) {
+        const string event = "event: patch\ndata: " + patch + "\n\n";
+        events_stream->publish(
+                make_shared<vector<uint8_t> >(event.begin(), event.end()));
     }
-
-    lock_guard<mutex> lock(plotdata_mut);
-    vector<float> cir_db(last_CIR.size());
-    std::transform(last_CIR.begin(), last_CIR.end(), cir_db.begin(),
-            [](float y) { return 10.0f * log10(y); });
-
-    size_t lengthBytes = cir_db.size() * sizeof(float);
-    ssize_t ret = s.send(cir_db.data(), lengthBytes, MSG_NOSIGNAL);
-    if (ret == -1) {
-        cerr << "Failed to send CIR data" << endl;
-        return false;
-    }
-
-    return true;
 }
 
-static bool send_fft_data(Socket& s, DSPCOMPLEX *spectrumBuffer, size_t T_u)
+void WebRadioInterface::push_events()
 {
-    vector<float> spectrum(T_u);
+    while (events_running) {
+        this_thread::sleep_for(EVENT_INTERVAL);
 
-    // Shift FFT samples
-    const size_t half_Tu = T_u / 2;
-    for (size_t i = 0; i < half_Tu; i++) {
-        spectrum[i] = abs(spectrumBuffer[i + half_Tu]);
-    }
-    for (size_t i = half_Tu; i < T_u; i++) {
-        spectrum[i] = abs(spectrumBuffer[i - half_Tu]);
+        // Without clients, the next one starts from a fresh snapshot anyway
+        if (num_event_clients == 0) {
+            continue;
+        }
+
+        lock_guard<mutex> lock(events_mut);
+        publish_mux_patch(collect_mux_json(false));
     }
+}
 
+bool WebRadioInterface::send_fic(HttpConnection& s)
+{
     if (not send_http_response(s, http_ok, "", http_contenttype_data)) {
-        cerr << "Failed to send spectrum headers" << endl;
+        cerr << "Failed to send FIC headers" << endl;
         return false;
     }
 
-    size_t lengthBytes = spectrum.size() * sizeof(float);
-    ssize_t ret = s.send(spectrum.data(), lengthBytes, MSG_NOSIGNAL);
-    if (ret == -1) {
-        cerr << "Failed to send spectrum data" << endl;
-        return false;
-    }
+    s.start_stream();
 
+    // Start with the FIBs of the last seconds. Drop clients that
+    // cannot keep up, rather than giving them an incomplete FIC.
+    fic_stream->subscribe(s, StreamRing::LagPolicy::Drop,
+            StreamRing::Start::Oldest);
     return true;
 }
 
-bool WebRadioInterface::send_spectrum(Socket& s)
+bool WebRadioInterface::send_impulseresponse(HttpConnection& s)
 {
-    // Get FFT buffer
-    DSPCOMPLEX* spectrumBuffer = spectrum_fft_handler.getVector();
-    auto samples = input.getSpectrumSamples(dabparams.T_u);
-
-    // Continue only if we got data
-    if (samples.size() != (size_t)dabparams.T_u)
-        return false;
+    return send_plot(s, plot_impulseresponse);
+}
 
-    std::copy(samples.begin(), samples.end(), spectrumBuffer);
+bool WebRadioInterface::send_spectrum(HttpConnection& s)
+{
+    return send_plot(s, plot_spectrum);
+}
 
-    // Do FFT to get the spectrum
-    spectrum_fft_handler.do_FFT();
+bool WebRadioInterface::send_null_spectrum(HttpConnection& s)
+{
+    return send_plot(s, plot_null_spectrum);
+}
 
-    return send_fft_data(s, spectrumBuffer, dabparams.T_u);
+bool WebRadioInterface::send_constellation(HttpConnection& s)
+{
+    return send_plot(s, plot_constellation);
 }
 
-bool WebRadioInterface::send_null_spectrum(Socket& s)
+bool WebRadioInterface::send_plot(HttpConnection& s,
+        const HttpConnection::chunk_t& plot)
 {
-    // Get FFT buffer
-    DSPCOMPLEX* spectrumBuffer = spectrum_fft_handler.getVector();
+    HttpConnection::chunk_t data;
+    {
+        lock_guard<mutex> lock(plotdata_mut);
+        // After an idle period, the plot we still have is outdated, but
+        // sending it is better than nothing until the next frame
+        time_plots_requested = chrono::steady_clock::now();
+        data = plot;
+    }
+
+    if (not data) {
+        // No frame was computed since the first request
+        string headers = http_503;
+        headers += http_contenttype_text;
+        headers += http_retry_after;
+        headers += http_allow_origin;
+        headers += http_nocache;
+        headers += "\r\n";
+        headers += "Plot not computed yet.\r\n";
+        if (s.send(headers.data(), headers.size(), MSG_NOSIGNAL) == -1) {
+            cerr << "Failed to send plot retry" << endl;
+            return false;
+        }
+        return true;
+    }
 
-    lock_guard<mutex> lock(plotdata_mut);
-    if (last_NULL.empty()) {
+    if (not send_http_response(s, http_ok, "", http_contenttype_data)) {
+        cerr << "Failed to send plot headers" << endl;
         return false;
     }
-    else if (last_NULL.size() != (size_t)dabparams.T_null) {
-        cerr << "Invalid NULL size " << last_NULL.size() << endl;
+
+    ssize_t ret = s.send(move(data));
+    if (ret == -1) {
+        cerr << "Failed to send plot data" << endl;
         return false;
     }
 
-    copy(last_NULL.begin(), last_NULL.begin() + dabparams.T_u, spectrumBuffer);
-
-    // Do FFT to get the spectrum
-    spectrum_fft_handler.do_FFT();
-
-    return send_fft_data(s, spectrumBuffer, dabparams.T_u);
+    return true;
 }
 
-bool WebRadioInterface::send_constellation(Socket& s)
+bool WebRadioInterface::plots_wanted() const
 {
-    const size_t decim = OfdmDecoder::constellationDecimation;
-    const size_t num_iqpoints = (dabparams.L-1) * dabparams.K / decim;
-    std::vector<float> phases(num_iqpoints);
-
     lock_guard<mutex> lock(plotdata_mut);
-    if (last_constellation.size() == num_iqpoints) {
-        phases.resize(num_iqpoints);
-        for (size_t i = 0; i < num_iqpoints; i++) {
-            const float y = 180.0f / (float)M_PI * std::arg(last_constellation[i]);
-            phases[i] = y;
-        }
-
-        if (not send_http_response(s, http_ok, "", http_contenttype_data)) {
-            cerr << "Failed to send constellation headers" << endl;
-            return false;
-        }
-
-        size_t lengthBytes = phases.size() * sizeof(float);
-        ssize_t ret = s.send(phases.data(), lengthBytes, MSG_NOSIGNAL);
-        if (ret == -1) {
-            cerr << "Failed to send constellation data" << endl;
-            return false;
-        }
-
-        return true;
-    }
-
-    return false;
+    return chrono::steady_clock::now() <
+        time_plots_requested + PLOT_IDLE_TIMEOUT;
 }
 
-bool WebRadioInterface::send_channel(Socket& s)
+bool WebRadioInterface::send_channel(HttpConnection& s)
 {
     const auto freq = input.getFrequency();
 
@@ -1408,7 +1446,7 @@ bool WebRadioInterface::send_channel(Socket& s)
     return true;
 }
 
-bool WebRadioInterface::send_buffered_audio_size(Socket& s, const std::string& stream) {
+bool WebRadioInterface::send_buffered_audio_size(HttpConnection& s, const std::string& stream) {
     unique_lock<mutex> lock(rx_mut);
     ASSERT_RX;
     for (const auto& srv : rx->getServiceList()) {
@@ -1420,7 +1458,7 @@ bool WebRadioInterface::send_buffered_audio_size(Socket& s, const std::string& s
 
                 lock.unlock();
 
-                double playbackTimeMs = (((double)ph.audioBuffer.size() / ((double) ph.rate * 2.0))) * 1000.0;
+                double playbackTimeMs = ph.getTimeShift()->duration().count();
 
                 string response = http_ok;
                 response += http_allow_origin;
@@ -1449,7 +1487,7 @@ bool WebRadioInterface::send_buffered_audio_size(Socket& s, const std::string& s
     return false;
 }
 
-bool WebRadioInterface::handle_fft_window_placement_post(Socket& s, const std::string& fft_window_placement)
+bool WebRadioInterface::handle_fft_window_placement_post(HttpConnection& s, const std::string& fft_window_placement)
 {
     cerr << "POST fft window: " << fft_window_placement << endl;
 
@@ -1495,7 +1533,7 @@ bool WebRadioInterface::handle_fft_window_placement_post(Socket& s, const std::s
     return true;
 }
 
-bool WebRadioInterface::handle_coarse_corrector_post(Socket& s, const std::string& coarseCorrector)
+bool WebRadioInterface::handle_coarse_corrector_post(HttpConnection& s, const std::string& coarseCorrector)
 {
     cerr << "POST coarse : " << coarseCorrector << endl;
 
@@ -1538,14 +1576,14 @@ bool WebRadioInterface::handle_coarse_corrector_post(Socket& s, const std::strin
     return true;
 }
 
-bool WebRadioInterface::handle_channel_post(Socket& s, const std::string& channel)
+bool WebRadioInterface::handle_channel_post(HttpConnection& s, const std::string& channel)
 {
     cerr << "POST channel: " << channel << endl;
 
     retune(channel);
 
     for(auto& ph : phs) {
-        ph.second.audioBuffer.clear();
+        ph.second.getTimeShift()->clear();
         ph.second.dls_buffer.clear();
         ph.second.mot_buffer.clear();
     }
@@ -1570,9 +1608,14 @@ void WebRadioInterface::handle_phs()
         unique_lock<mutex> lock(rx_mut);
         ASSERT_RX;
 
-        auto serviceList = rx->getServiceList();
+        if (time_ensemble_saved + ENSEMBLE_SAVE_INTERVAL < chrono::steady_clock::now()) {
+            save_ensemble();
+        }
+
+        const auto ensemble = rx->getEnsembleSnapshot();
+        const auto& serviceList = ensemble->services;
         for (auto& s : serviceList) {
-            auto scs = rx->getComponents(s);
+            auto scs = ensemble->getComponents(s);
 
             if (std::find(
                         carousel_services_available.cbegin(),
@@ -1585,10 +1628,19 @@ void WebRadioInterface::handle_phs()
                 }
             }
 
-            long sampleCount = (rro.audioBufferSeconds) * 48000 * 2;
-
             if (phs.count(s.serviceId) == 0) {
-                WebProgrammeHandler ph(s.serviceId, decode_settings.outputCodec, sampleCount);
+                TimeShiftStore::Settings timeshiftSettings;
+                timeshiftSettings.retention = chrono::minutes(decode_settings.timeshift_minutes);
+                timeshiftSettings.directory = decode_settings.timeshift_directory;
+
+                // The PAD strategies only harvest DLS and slides, decoding
+                // the audio is left to the listeners
+                const bool audioOnDemand =
+                    decode_settings.strategy == DecodeStrategy::CarouselPAD or
+                    decode_settings.strategy == DecodeStrategy::AllPAD;
+
+                WebProgrammeHandler ph(s.serviceId, decode_settings.outputCodec,
+                        timeshiftSettings, audioOnDemand, notify_sources);
                 phs.emplace(std::make_pair(s.serviceId, move(ph)));
             }
         }
@@ -1708,8 +1760,6 @@ const int sig_caught = 0;
 
 void WebRadioInterface::serve()
 {
-    deque<future<bool>> running_connections;
-
 #if HAVE_SIGACTION
     struct sigaction sa = {};
     sa.sa_handler = handler;
@@ -1719,53 +1769,18 @@ void WebRadioInterface::serve()
     }
 #endif
 
-    while (sig_caught == 0) {
-        auto client = serverSocket.accept();
-
-        running_connections.push_back(async(launch::async,
-                    &WebRadioInterface::dispatch_client, this, move(client)));
-
-        deque<future<bool> > still_running_connections;
-        for (auto& fut : running_connections) {
-            if (fut.valid()) {
-                switch (fut.wait_for(chrono::milliseconds(1))) {
-                    case future_status::deferred:
-                    case future_status::timeout:
-                        still_running_connections.push_back(move(fut));
-                        break;
-                    case future_status::ready:
-                        fut.get();
-                        break;
-                }
-            }
-        }
-        running_connections = move(still_running_connections);
-    }
+    server->run([]() { return sig_caught == 0; });
 
-    cerr << "SERVE No more connections running" << endl;
+    cerr << "SERVE Close all connections" << endl;
+    server.reset();
 
     running = false;
+    events_running = false;
     if (programme_handler_thread.joinable()) {
         programme_handler_thread.join();
     }
-
-    cerr << "SERVE Wait for all futures to clear" << endl;
-    while (running_connections.size() > 0) {
-        deque<future<bool> > still_running_connections;
-        for (auto& fut : running_connections) {
-            if (fut.valid()) {
-                switch (fut.wait_for(chrono::milliseconds(1))) {
-                    case future_status::deferred:
-                    case future_status::timeout:
-                        still_running_connections.push_back(move(fut));
-                        break;
-                    case future_status::ready:
-                        fut.get();
-                        break;
-                }
-            }
-        }
-        running_connections = move(still_running_connections);
+    if (events_thread.joinable()) {
+        events_thread.join();
     }
 
     cerr << "SERVE clear remaining data structures" << endl;
@@ -1775,6 +1790,22 @@ void WebRadioInterface::serve()
     carousel_services_active.clear();
 }
 
+void WebRadioInterface::remove_sender_on_close(HttpConnection& s,
+        uint32_t sid, shared_ptr<ProgrammeSender> sender)
+{
+    s.on_close([this, sid, sender]() {
+            {
+                lock_guard<mutex> lock(rx_mut);
+                auto ph = phs.find(sid);
+                if (ph != phs.end()) {
+                    cerr << "Removing mp3 sender" << endl;
+                    ph->second.removeSender(sender.get());
+                }
+            }
+            check_decoders_required();
+        });
+}
+
 const int AUDIO_BUFFER_LENGTH_MS = 1800000;
 const int DLS_CACHING_RATE_MS = 1000;
 
@@ -1850,46 +1881,122 @@ void WebRadioInterface::onFIBDecodeSuccess(bool crcCheckOk, const uint8_t* fib)
         return;
     }
 
-    // Convert the fib bitvector to bytes
-    vector<uint8_t> buf(32);
-    for (size_t i = 0; i < buf.size(); i++) {
-        uint8_t v = 0;
-        for (int j = 0; j < 8; j++) {
-            if (fib[8*i+j]) {
-                v |= 1 << (7-j);
-            }
+    fic_stream->publish(make_shared<vector<uint8_t> >(fib, fib + 32));
+}
+
+// Add the power of the FFT output to the exponential average, an empty
+// average starts over from this frame
+static void average_power(vector<float>& power,
+        const DSPCOMPLEX *fft_out, size_t T_u)
+{
+    if (power.size() != T_u) {
+        power.resize(T_u);
+        for (size_t i = 0; i < T_u; i++) {
+            power[i] = norm(fft_out[i]);
         }
-        buf[i] = v;
+        return;
     }
 
-    {
-        lock_guard<mutex> lock(fib_mut);
-        fib_blocks.push_back(move(buf));
-
-        if (fib_blocks.size() > 3*250) { // six seconds
-            fib_blocks.pop_front();
-        }
+    for (size_t i = 0; i < T_u; i++) {
+        power[i] += SPECTRUM_AVERAGING * (norm(fft_out[i]) - power[i]);
     }
+}
 
-    new_fib_block_available.notify_one();
+// Magnitude of the averaged spectrum, with DC in the middle
+static HttpConnection::chunk_t fft_plot(const vector<float>& power)
+{
+    const size_t T_u = power.size();
+    auto plot = make_shared<vector<uint8_t> >(T_u * sizeof(float));
+    float *spectrum = reinterpret_cast<float*>(plot->data());
+
+    const size_t half_Tu = T_u / 2;
+    for (size_t i = 0; i < half_Tu; i++) {
+        spectrum[i] = sqrt(power[i + half_Tu]);
+    }
+    for (size_t i = half_Tu; i < T_u; i++) {
+        spectrum[i] = sqrt(power[i - half_Tu]);
+    }
+    return plot;
 }
 
 void WebRadioInterface::onNewImpulseResponse(std::vector<float>&& data)
 {
+    HttpConnection::chunk_t plot;
+    if (plots_wanted()) {
+        auto cir_db = make_shared<vector<uint8_t> >(data.size() * sizeof(float));
+        std::transform(data.begin(), data.end(),
+                reinterpret_cast<float*>(cir_db->data()),
+                [](float y) { return 10.0f * log10(y); });
+        plot = move(cir_db);
+    }
+
     lock_guard<mutex> lock(plotdata_mut);
     last_CIR = move(data);
+    if (plot) {
+        plot_impulseresponse = move(plot);
+    }
 }
 
 void WebRadioInterface::onNewNullSymbol(std::vector<DSPCOMPLEX>&& data)
 {
+    // The NULL symbol marks the end of every frame, which makes it the
+    // place to also refresh the spectrum of the input signal
+    if (not plots_wanted()) {
+        // Do not average over the gap until the next client comes
+        spectrum_power.clear();
+        null_spectrum_power.clear();
+        return;
+    }
+
+    const size_t T_u = dabparams.T_u;
+    DSPCOMPLEX* spectrumBuffer = spectrum_fft_handler.getVector();
+
+    HttpConnection::chunk_t spectrum;
+    auto samples = input.getSpectrumSamples(T_u);
+    if (samples.size() == T_u) {
+        std::copy(samples.begin(), samples.end(), spectrumBuffer);
+        spectrum_fft_handler.do_FFT();
+        average_power(spectrum_power, spectrumBuffer, T_u);
+        spectrum = fft_plot(spectrum_power);
+    }
+
+    HttpConnection::chunk_t null_spectrum;
+    if (data.size() == (size_t)dabparams.T_null) {
+        std::copy(data.begin(), data.begin() + T_u, spectrumBuffer);
+        spectrum_fft_handler.do_FFT();
+        average_power(null_spectrum_power, spectrumBuffer, T_u);
+        null_spectrum = fft_plot(null_spectrum_power);
+    }
+    else {
+        cerr << "Invalid NULL size " << data.size() << endl;
+    }
+
     lock_guard<mutex> lock(plotdata_mut);
-    last_NULL = move(data);
+    if (spectrum) {
+        plot_spectrum = move(spectrum);
+    }
+    if (null_spectrum) {
+        plot_null_spectrum = move(null_spectrum);
+    }
 }
 
 void WebRadioInterface::onConstellationPoints(std::vector<DSPCOMPLEX>&& data)
 {
+    const size_t decim = OfdmDecoder::constellationDecimation;
+    const size_t num_iqpoints = (dabparams.L-1) * dabparams.K / decim;
+
+    if (data.size() != num_iqpoints or not plots_wanted()) {
+        return;
+    }
+
+    auto plot = make_shared<vector<uint8_t> >(num_iqpoints * sizeof(float));
+    float *phases = reinterpret_cast<float*>(plot->data());
+    for (size_t i = 0; i < num_iqpoints; i++) {
+        phases[i] = 180.0f / (float)M_PI * std::arg(data[i]);
+    }
+
     lock_guard<mutex> lock(plotdata_mut);
-    last_constellation = move(data);
+    plot_constellation = move(plot);
 }
 
 void WebRadioInterface::onMessage(message_level_t level, const std::string& text, const std::string& text2)
@@ -39,9 +39,12 @@
 #include <cstdint>
 #include <cstddef>
 #include "backend/dab-constants.h"
+#include "backend/ensemble-database.h"
 #include "backend/radio-controller.h"
 #include "various/fft.h"
-#include "various/Socket.h"
+#include "welle-cli/httpserver.h"
+#include "welle-cli/jsonconvert.h"
+#include "welle-cli/streamring.h"
 #include "various/channels.h"
 #include "webprogrammehandler.h"
 #include "radio-receiver-options.h"
@@ -63,13 +66,24 @@ class WebRadioInterface : public RadioControllerInterface {
 
             /* Decode all services one by one, switch when
              * DLS and slide were decoded, stay at most 80s on one service.  */
-            CarouselPAD
+            CarouselPAD,
+
+            /* Decode the PAD of all services simultaneously, and the audio
+             * only of the services somebody listens to */
+            AllPAD
         };
 
         struct DecodeSettings {
             DecodeStrategy strategy = DecodeStrategy::OnDemand;
             int num_decoders_in_carousel = 0;
             OutputCodec outputCodec;
+
+            // Retention of the time-shift buffer, per service
+            int timeshift_minutes = 30;
+            // Directory for the time-shift segment files, empty for $TMPDIR
+            std::string timeshift_directory;
+            // Directory of the ensemble database, empty to disable it
+            std::string ensemble_directory;
         };
 
         WebRadioInterface(
@@ -103,75 +117,122 @@ class WebRadioInterface : public RadioControllerInterface {
         std::mutex retune_mut;
         void retune(const std::string& channel);
 
-        bool dispatch_client(Socket&& client);
+        // Exchange the ensemble of the current channel with the
+        // ensemble database. Call with rx_mut held.
+        void load_ensemble();
+        void save_ensemble();
+
+        bool dispatch_client(
+                const std::shared_ptr<HttpConnection>& connection,
+                const HttpRequest& req);
         // Send a file
-        bool send_file(Socket& s,
+        bool send_file(HttpConnection& s,
                 const std::string& filename,
                 const std::string& content_type);
 
+        // Gather the state of the receiver. The pending messages are only
+        // included and cleared if take_messages is set.
+        MuxJson collect_mux_json(bool take_messages);
+
         // Generate and send the mux.json
-        bool send_mux_json(Socket& s);
+        bool send_mux_json(HttpConnection& s);
+
+        // Send the mux.json as a stream of server-sent events: a snapshot
+        // first, and then every EVENT_INTERVAL a JSON Patch with what
+        // changed
+        bool send_events(HttpConnection& s);
+#if defined(WITH_PROFILING)
+        bool send_profiling_json(HttpConnection& s);
+#endif
 
         // Generate and send a m3u playlist with all services
-        bool send_mux_playlist(Socket& s);
+        bool send_mux_playlist(HttpConnection& s);
 
         // Send a stream containing the selected programme.
         // stream is a service id, either in hex with 0x prefix or
         // in decimal
-        bool send_stream(Socket& s, const std::string& stream);
+        bool send_stream(HttpConnection& s, const std::string& stream);
+
+        // Send the audio of the programme as broadcast, without decoding
+        // it. extension is "mp2" for DAB or "aac" for DAB+ programmes.
+        bool send_passthrough_stream(HttpConnection& s,
+                const std::string& stream, const std::string& extension);
 
-        bool send_buffered_stream(Socket& s, const std::string& stream, const std::string& offsetMsStr);
+        bool send_buffered_stream(HttpConnection& s, const std::string& stream, const std::string& offsetMsStr);
 
         // Send the slide for the selected programme.
         // stream is a service id, either in hex with 0x prefix or
         // in decimal
-        bool send_slide(Socket& s, const std::string& stream);
-        bool send_buffered_slide(Socket& s, const std::string& stream, const std::string& timestamp);
+        bool send_slide(HttpConnection& s, const std::string& stream);
+        bool send_buffered_slide(HttpConnection& s, const std::string& stream, const std::string& timestamp);
 
         // Send the Fast Information Channel as a stream.
         // Every FIB is 32 bytes long, there three FIBs per 24ms interval,
         // which gives 32000 bits/s
-        bool send_fic(Socket& s);
+        bool send_fic(HttpConnection& s);
 
-        bool send_buffered_dls(Socket& s, const std::string& stream, const std::string& timestamp);
+        bool send_buffered_dls(HttpConnection& s, const std::string& stream, const std::string& timestamp);
 
         // Send the impulse response, in dB, as a sequence of float values.
-        bool send_impulseresponse(Socket& s);
+        bool send_impulseresponse(HttpConnection& s);
 
         // Send the signal spectrum, in dB, as a sequence of float values.
-        bool send_spectrum(Socket& s);
-        bool send_null_spectrum(Socket& s);
+        bool send_spectrum(HttpConnection& s);
+        bool send_null_spectrum(HttpConnection& s);
 
         // Send the constellation points, a sequence of phases between -180 and 180 .
-        bool send_constellation(Socket& s);
+        bool send_constellation(HttpConnection& s);
+
+        // Send one of the plots above as computed by the last frame, or
+        // 503 if no frame computed it yet
+        bool send_plot(HttpConnection& s, const HttpConnection::chunk_t& plot);
+
+        // Tell if a client asked for the plots recently, so that the next
+        // frame should compute them
+        bool plots_wanted() const;
 
         // Send the currently tuned channel
-        bool send_channel(Socket& s);
+        bool send_channel(HttpConnection& s);
 
-        bool send_buffered_audio_size(Socket& s, const std::string& stream);
+        bool send_buffered_audio_size(HttpConnection& s, const std::string& stream);
 
-        bool send_cached_dls_data(Socket& s, const std::string& stationId, std::chrono::time_point<std::chrono::system_clock>);
+        bool send_cached_dls_data(HttpConnection& s, const std::string& stationId, std::chrono::time_point<std::chrono::system_clock>);
 
         // Handle a POSTs
-        bool handle_fft_window_placement_post(Socket& s, const std::string& request);
-        bool handle_coarse_corrector_post(Socket& s, const std::string& request);
+        bool handle_fft_window_placement_post(HttpConnection& s, const std::string& request);
+        bool handle_coarse_corrector_post(HttpConnection& s, const std::string& request);
 
         // Handle a POST to /channel that will tune the receiver
-        bool handle_channel_post(Socket& s, const std::string& request);
+        bool handle_channel_post(HttpConnection& s, const std::string& request);
 
         void cache_dls_data();
 
+        // Unregister the sender from its programme once the client leaves
+        void remove_sender_on_close(HttpConnection& s, uint32_t sid,
+                std::shared_ptr<ProgrammeSender> sender);
+
         void handle_phs();
         void check_decoders_required();
         std::list<tii_measurement_t> getTiiStats();
 
+        // Publish the changes of the mux.json to the event stream clients
+        void push_events();
+        void publish_mux_patch(const MuxJson& mux);
+
         std::thread programme_handler_thread;
+        std::thread events_thread;
         std::atomic<bool> running = ATOMIC_VAR_INIT(true);
+        // Separate from running, which a retune clears while it rebuilds rx
+        std::atomic<bool> events_running = ATOMIC_VAR_INIT(true);
 
         Channels channels;
         DABParams dabparams;
         CVirtualInput& input;
+
+        // Only used from onNewNullSymbol, i.e. by the OFDM processor thread
         fft::Forward spectrum_fft_handler;
+        std::vector<float> spectrum_power;
+        std::vector<float> null_spectrum_power;
 
         RadioReceiverOptions rro;
         DecodeSettings decode_settings;
@@ -193,25 +254,43 @@ class WebRadioInterface : public RadioControllerInterface {
 
         mutable std::mutex plotdata_mut;
         std::vector<float> last_CIR;
-        std::vector<DSPCOMPLEX> last_NULL;
-        std::vector<DSPCOMPLEX> last_constellation;
+
+        // The plots are computed by the backend callbacks, once per frame,
+        // and sent to every client as they are. The spectra are averaged
+        // over the last frames. Nothing gets computed while no client
+        // polls them.
+        HttpConnection::chunk_t plot_impulseresponse;
+        HttpConnection::chunk_t plot_spectrum;
+        HttpConnection::chunk_t plot_null_spectrum;
+        HttpConnection::chunk_t plot_constellation;
+        std::chrono::time_point<std::chrono::steady_clock> time_plots_requested;
 
         mutable std::mutex fib_mut;
         size_t num_fic_crc_errors = 0;
-        std::condition_variable new_fib_block_available;
-        std::deque<std::vector<uint8_t> > fib_blocks;
+        std::shared_ptr<StreamRing> fic_stream;
+
+        // Patches for the /events clients, and the state they apply to.
+        // Taken before the locks collect_mux_json() takes.
+        std::mutex events_mut;
+        MuxJsonTracker mux_tracker;
+        std::shared_ptr<StreamRing> events_stream;
+        std::atomic<size_t> num_event_clients = ATOMIC_VAR_INIT(0);
 
         using comb_pattern_t = std::pair<int, int>;
 
         std::chrono::time_point<std::chrono::steady_clock> time_last_tiis_clean;
         std::map<comb_pattern_t, std::list<tii_measurement_t> > tiis;
 
-        Socket serverSocket;
+        std::unique_ptr<HttpServer> server;
+        std::function<void()> notify_sources;
 
         mutable std::mutex rx_mut;
         std::chrono::time_point<std::chrono::system_clock> time_rx_created;
         std::unique_ptr<RadioReceiver> rx;
 
+        std::unique_ptr<EnsembleDatabase> ensemble_database;
+        std::chrono::time_point<std::chrono::steady_clock> time_ensemble_saved;
+
         using SId_t = uint32_t;
         std::map<SId_t, WebProgrammeHandler> phs;
         std::map<SId_t, bool> programmes_being_decoded;
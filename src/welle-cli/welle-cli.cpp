@@ -33,7 +33,9 @@
 #include <algorithm>
 #include <condition_variable>
 #include <deque>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -54,6 +56,8 @@
 #include "input/input_factory.h"
 #include "input/raw_file.h"
 #include "various/channels.h"
+#include "various/fft.h"
+#include "various/profiling.h"
 #include "libs/json.hpp"
 extern "C" {
 #include "various/wavfile.h"
@@ -213,24 +217,18 @@ class RadioInterface : public RadioControllerInterface {
         }
 
         virtual void onFIBDecodeSuccess(bool crcCheckOk, const uint8_t* fib) override {
+            {
+                lock_guard<mutex> lock(progress_mutex);
+                num_fibs++;
+            }
+            progress_changed.notify_all();
+
             if (fic_fd) {
                 if (not crcCheckOk) {
                     return;
                 }
 
-                // convert bitvector to byte vector
-                vector<uint8_t> buf(32);
-                for (size_t i = 0; i < buf.size(); i++) {
-                    uint8_t v = 0;
-                    for (int j = 0; j < 8; j++) {
-                        if (fib[8*i+j]) {
-                            v |= 1 << (7-j);
-                        }
-                    }
-                    buf[i] = v;
-                }
-
-                fwrite(buf.data(), buf.size(), sizeof(buf[0]), fic_fd);
+                fwrite(fib, 32, 1, fic_fd);
             }
         }
         virtual void onNewImpulseResponse(std::vector<float>&& data) override { (void)data; }
@@ -267,9 +265,41 @@ class RadioInterface : public RadioControllerInterface {
             cout << j << endl;
         }
 
+        virtual void onInputFailure() override
+        {
+            {
+                lock_guard<mutex> lock(progress_mutex);
+                input_ended = true;
+            }
+            progress_changed.notify_all();
+        }
+
+        // Wait until the receiver decoded the given number of FIBs, which
+        // measures progress in the recording instead of on the clock.
+        // Returns false if the input ended before.
+        bool wait_for_fibs(size_t num)
+        {
+            unique_lock<mutex> lock(progress_mutex);
+            progress_changed.wait(lock,
+                    [&]{ return num_fibs >= num or input_ended; });
+            return num_fibs >= num;
+        }
+
+        void wait_for_input_end()
+        {
+            unique_lock<mutex> lock(progress_mutex);
+            progress_changed.wait(lock, [&]{ return input_ended; });
+        }
+
         json last_date_time;
         bool synced = false;
         FILE* fic_fd = nullptr;
+
+    private:
+        mutex progress_mutex;
+        condition_variable progress_changed;
+        size_t num_fibs = 0;
+        bool input_ended = false;
 };
 
 struct options_t {
@@ -283,11 +313,18 @@ struct options_t {
     string frontend_args = "";
     bool dump_programme = false;
     bool decode_all_programmes = false;
+    bool batch = false;
     int num_decoders_in_carousel = 0;
     bool carousel_pad = false;
     int web_port = -1; // positive value means enable
     list<int> tests;
     string outputcodec = "";
+    int timeshift_minutes = 30;
+    string timeshift_directory = "";
+    string trace_file = "";
+    int trace_seconds = 0; // 0 means until exit
+    string fftw_wisdom = "";
+    string ensemble_directory = "";
 
     RadioReceiverOptions rro;
 };
@@ -311,6 +348,10 @@ static void usage()
     "                  This generates: dump.fic; <programme_name.msc> files;" << endl <<
     "                  <programme_name.wav> files." << endl <<
     "    -d            Dump programme to <programme_name.msc> file." << endl <<
+    "    -x            Batch mode: decode the IQ file given with -f as fast as" << endl <<
+    "                  possible, write programme <programme> (or all programmes" << endl <<
+    "                  with -D) to <programme_name.wav>, then print the decoding" << endl <<
+    "                  speed and exit." << endl <<
     endl <<
     "Web server mode:" << endl <<
     "    -w port       Enable web server on port <port>." << endl <<
@@ -322,7 +363,17 @@ static void usage()
     "    -P            Without the -P option, welle-cli will switch every 10 seconds." << endl <<
     "                  With the -P option, welle-cli will switch once DLS and a" << endl <<
     "                  slide were decoded, staying at most 80 seconds on a given" << endl <<
-    "                  programme." << endl <<
+    "                  programme. Without -C, welle-cli decodes DLS and slides of" << endl <<
+    "                  all programmes simultaneously." << endl <<
+    "                  Either way, the audio of a programme only gets decoded" << endl <<
+    "                  while somebody listens to it." << endl <<
+    "    -b minutes    Keep <minutes> of audio per programme for time-shifted" << endl <<
+    "                  playback (default 30)." << endl <<
+    "    -B directory  Create the time-shift segment files in <directory>" << endl <<
+    "                  (default $TMPDIR or /tmp). The files are unlinked right" << endl <<
+    "                  after creation." << endl <<
+    "    -E directory  Remember the service list of every channel in <directory>," << endl <<
+    "                  and show it right after tuning to a channel again." << endl <<
     endl <<
     "Backend and input options:" << endl <<
     "    -f file       Read an IQ file <file> and play with ALSA." << endl <<
@@ -340,9 +391,16 @@ static void usage()
     "    -s args       SoapySDR Driver arguments." << endl <<
     "    -A antenna    Set input antenna to ANT (for SoapySDR input only)." << endl <<
     "    -T            Disable TII decoding to reduce CPU usage." << endl <<
+    "    -j threads    Demodulate the OFDM symbols on <threads> threads (default: 1)." << endl <<
+    "    -W file       Search for the fastest FFT plans and keep them in <file>, so" << endl <<
+    "                  that only the first start takes longer (FFTW builds only)." << endl <<
     "    -O            Output Codec for web streaming : mp3 (default), flac (lossless)" << endl <<
     endl <<
     "Other options:" << endl <<
+    "    -R file       Write a trace of the decoder to <file>, to be loaded into" << endl <<
+    "                  chrome://tracing or https://ui.perfetto.dev. Needs a build" << endl <<
+    "                  with profiling enabled." << endl <<
+    "    -r seconds    Stop the trace after <seconds> (default: on exit)." << endl <<
     "    -t test_id    Run test <test_id>." << endl <<
     "                  To understand what the tests do, please see source code." << endl <<
     "    -h            Display this help and exit." << endl <<
@@ -356,6 +414,12 @@ static void usage()
     "welle-cli -f ./ofdm.iq -p GRRIF" << endl <<
     "    Read IQ file './ofdm.iq' (in u8 format) and play programme 'GRIFF' with ALSA." << endl <<
     endl <<
+    "welle-cli -f ./ofdm.iq -D -x" << endl <<
+    "    Decode all programmes of IQ file './ofdm.iq' to files, faster than real time." << endl <<
+    endl <<
+    "welle-cli -c 10B -p GRRIF -R trace.json -r 60" << endl <<
+    "    Receive 'GRRIF' on channel '10B' and write a 60 second decoder trace." << endl <<
+    endl <<
     "welle-cli -f ./ofdm.iq -t 1" << endl <<
     "    Read IQ file './ofdm.iq' (in u8 format), and run test 1." << endl <<
     endl <<
@@ -382,6 +446,10 @@ static void usage()
     "    on channel 10B; welle-cli will switch once DLS and a slide were decoded," << endl <<
     "    staying at most 80 seconds on a given programme." << endl <<
     endl <<
+    "welle-cli -c 10B -P -w 8000" << endl <<
+    "    Enable web server on port 8000, decode DLS and slides of all programmes" << endl <<
+    "    on channel 10B, and the audio of a programme only when it is played." << endl <<
+    endl <<
     "Report bugs to: <https://github.com/AlbrechtL/welle.io/issues>" << endl;
 }
 
@@ -409,13 +477,16 @@ options_t parse_cmdline(int argc, char **argv)
     options.rro.decodeTII = true;
 
     int opt;
-    while ((opt = getopt(argc, argv, "A:c:C:dDf:F:g:hp:O:Ps:Tt:uvw:b:")) != -1) {
+    while ((opt = getopt(argc, argv, "A:b:B:c:C:dDE:f:F:g:hj:p:O:Pr:R:s:Tt:uvw:W:x")) != -1) {
         switch (opt) {
             case 'A':
                 options.antenna = optarg;
                 break;
             case 'b':
-                options.rro.audioBufferSeconds = std::atoi(optarg);
+                options.timeshift_minutes = std::atoi(optarg);
+                break;
+            case 'B':
+                options.timeshift_directory = optarg;
                 break;
             case 'c':
                 options.channel = optarg;
@@ -429,6 +500,9 @@ options_t parse_cmdline(int argc, char **argv)
             case 'D':
                 options.decode_all_programmes = true;
                 break;
+            case 'E':
+                options.ensemble_directory = optarg;
+                break;
             case 'f':
                 options.iqsource = optarg;
                 break;
@@ -438,6 +512,9 @@ options_t parse_cmdline(int argc, char **argv)
             case 'g':
                 options.gain = std::atoi(optarg);
                 break;
+            case 'j':
+                options.rro.demodulatorThreads = std::max(std::atoi(optarg), 1);
+                break;
             case 'p':
                 options.programme = optarg;
                 break;
@@ -450,6 +527,12 @@ options_t parse_cmdline(int argc, char **argv)
             case 'h':
                 usage();
                 exit(1);
+            case 'r':
+                options.trace_seconds = std::atoi(optarg);
+                break;
+            case 'R':
+                options.trace_file = optarg;
+                break;
             case 's':
                 options.soapySDRDriverArgs = optarg;
                 break;
@@ -467,9 +550,15 @@ options_t parse_cmdline(int argc, char **argv)
             case 'w':
                 options.web_port = std::atoi(optarg);
                 break;
+            case 'W':
+                options.fftw_wisdom = optarg;
+                break;
             case 'u':
                 options.rro.disableCoarseCorrector = true;
                 break;
+            case 'x':
+                options.batch = true;
+                break;
             default:
                 cerr << "Unknown option. Use -h for help" << endl;
                 exit(1);
@@ -489,6 +578,10 @@ options_t parse_cmdline(int argc, char **argv)
         cerr << "Cannot select both -C and -D" << endl;
         exit(1);
     }
+    if (options.batch and options.iqsource.empty()) {
+        cerr << "Batch mode needs an IQ file given with -f" << endl;
+        exit(1);
+    }
 
     return options;
 }
@@ -498,6 +591,25 @@ int main(int argc, char **argv)
     auto options = parse_cmdline(argc, argv);
     version();
 
+    if (not options.fftw_wisdom.empty() and
+            not fft::configurePlanning(options.fftw_wisdom,
+                fft::PlanningEffort::Measure)) {
+        cerr << "Ignoring FFTW wisdom in " << options.fftw_wisdom << endl;
+    }
+
+    if (not options.trace_file.empty()) {
+#if defined(WITH_PROFILING)
+        if (not get_profiler().start_trace(options.trace_file,
+                    chrono::seconds(options.trace_seconds))) {
+            cerr << "Could not open trace file " << options.trace_file << endl;
+            return 1;
+        }
+#else
+        cerr << "Tracing needs a build with profiling enabled" << endl;
+        return 1;
+#endif
+    }
+
     RadioInterface ri;
 
     Channels channels;
@@ -513,10 +625,11 @@ int main(int argc, char **argv)
         }
     }
     else {
-        // Run the tests without input throttling for max speed
-        const bool throttle = options.tests.empty();
-        const bool rewind = options.tests.empty();
-        auto in_file = make_unique<CRAWFile>(ri, throttle, rewind);
+        // Run the tests without input throttling for max speed, and let
+        // the batch mode read the file from the OFDM processor thread
+        const bool throttle = options.tests.empty() and not options.batch;
+        const bool rewind = options.tests.empty() and not options.batch;
+        auto in_file = make_unique<CRAWFile>(ri, throttle, rewind, options.batch);
         if (not in_file) {
             cerr << "Could not prepare CRAWFile" << endl;
             return 1;
@@ -588,6 +701,12 @@ int main(int argc, char **argv)
             }
             ds.num_decoders_in_carousel = options.num_decoders_in_carousel;
         }
+        else if (options.carousel_pad) {
+            ds.strategy = DS::AllPAD;
+        }
+        ds.timeshift_minutes = options.timeshift_minutes;
+        ds.timeshift_directory = options.timeshift_directory;
+        ds.ensemble_directory = options.ensemble_directory;
         if (options.outputcodec == "" || options.outputcodec == "mp3")
         {
             ds.outputCodec = OutputCodec::MP3;
@@ -611,6 +730,73 @@ int main(int argc, char **argv)
         WebRadioInterface wri(*in, options.web_port, ds, options.rro);
         wri.serve();
     }
+    else if (options.batch) {
+        using SId_t = uint32_t;
+        map<SId_t, WavProgrammeHandler> phs;
+
+        RadioReceiver rx(ri, *in, options.rro);
+        if (options.decode_all_programmes) {
+            FILE* fic_fd = fopen("dump.fic", "w");
+
+            if (fic_fd) {
+                ri.fic_fd = fic_fd;
+            }
+        }
+
+        const auto start_time = chrono::steady_clock::now();
+        rx.restart(false);
+
+        // Give the receiver the same time to complete the service list as
+        // in interactive mode, but counted in the recording. There are 125
+        // FIBs per second in all transmission modes.
+        constexpr size_t fibs_per_second = 125;
+        cerr << "Wait for service list" << endl;
+        if (not ri.wait_for_fibs(4 * fibs_per_second)) {
+            cerr << "End of file reached before the service list was complete" << endl;
+        }
+
+        for (const auto& s : rx.getServiceList()) {
+            string label = s.serviceLabel.utf8_label();
+            label.erase(std::find_if(label.rbegin(), label.rend(),
+                        [](int ch) { return !std::isspace(ch); }).base(), label.end());
+
+            if (not options.decode_all_programmes and
+                    label.find(service_to_tune) == string::npos) {
+                continue;
+            }
+
+            cerr << "Decode [0x" << std::hex << s.serviceId << std::dec << "] " <<
+                label << endl;
+
+            WavProgrammeHandler ph(s.serviceId, label);
+            phs.emplace(std::make_pair(s.serviceId, move(ph)));
+
+            string dumpFileName;
+            if (options.decode_all_programmes or options.dump_programme) {
+                dumpFileName = label + ".msc";
+            }
+
+            if (rx.addServiceToDecode(phs.at(s.serviceId), dumpFileName, s) == false) {
+                cerr << "Tune to " << label << " failed" << endl;
+            }
+        }
+
+        if (phs.empty()) {
+            cerr << "Could not find programme " << service_to_tune << endl;
+        }
+
+        ri.wait_for_input_end();
+
+        const chrono::duration<double> elapsed =
+            chrono::steady_clock::now() - start_time;
+        const double recording_duration =
+            dynamic_cast<CRAWFile&>(*in).getSamplesRead() / (double)INPUT_RATE;
+
+        cerr << fixed << setprecision(1) <<
+            "Decoded " << recording_duration << " s of recording in " <<
+            elapsed.count() << " s, " <<
+            recording_duration / elapsed.count() << "x real time" << endl;
+    }
     else {
         RadioReceiver rx(ri, *in, options.rro);
         if (options.decode_all_programmes) {
@@ -7,6 +7,9 @@ CONFIG += console
 HEADERS += \
     alsa-output.h  \
     webprogrammehandler.h \
+    timeshiftstore.h \
+    httpserver.h \
+    streamring.h \
     webradiointerface.h \
     jsonconvert.h
 
@@ -14,6 +17,9 @@ SOURCES += \
     alsa-output.cpp \
     tests.cpp \
     webprogrammehandler.cpp \
+    timeshiftstore.cpp \
+    httpserver.cpp \
+    streamring.cpp \
     webradiointerface.cpp \
     jsonconvert.cpp \
     welle-cli.cpp
@@ -45,6 +45,7 @@
 #include "gui_helper.h"
 #include "debug_output.h"
 #include "waterfallitem.h"
+#include "fft.h"
 
 int main(int argc, char** argv)
 {
@@ -100,6 +101,11 @@ int main(int argc, char** argv)
         QCoreApplication::translate("main", "File name"));
     optionParser.addOption(LogFileName);
 
+    QCommandLineOption fftwWisdomFileName("fftw-wisdom",
+        QCoreApplication::translate("main", "Searches for the fastest FFT plans and keeps them in a file, so that only the first start takes longer."),
+        QCoreApplication::translate("main", "File name"));
+    optionParser.addOption(fftwWisdomFileName);
+
     //	Process the actual command line arguments given by the user
     optionParser.process(app);
 
@@ -111,6 +117,13 @@ int main(int argc, char** argv)
         qDebug() << "main: Version:" << Version;
     }
 
+    // Plans are shared by all receivers, so this has to come first
+    QString fftwWisdomFileNameValue = optionParser.value(fftwWisdomFileName);
+    if (fftwWisdomFileNameValue != "")
+    {
+        fft::configurePlanning(fftwWisdomFileNameValue.toStdString(), fft::PlanningEffort::Measure);
+    }
+
     QVariantMap commandLineOptions;
     commandLineOptions["dumpFileName"] = optionParser.value(dumpFileName);
 
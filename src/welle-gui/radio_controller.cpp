@@ -32,6 +32,7 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QDir>
 #include <QSettings>
 #include <QStandardPaths>
 #include <stdexcept>
@@ -88,6 +89,11 @@ CRadioController::CRadioController(QVariantMap& commandLineOptions, QObject *par
     connect(&stationTimer, &QTimer::timeout, this, &CRadioController::stationTimerTimeout);
     connect(&channelTimer, &QTimer::timeout, this, &CRadioController::channelTimerTimeout);
 
+    // Remember the service list of every channel, to show it right after tuning
+    const QString ensembleDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/ensembles";
+    if (QDir().mkpath(ensembleDirectory))
+        ensembleDatabase = std::make_unique<EnsembleDatabase>(ensembleDirectory.toStdString());
+
     // Use the signal slot mechanism is necessary because the backend runs in a different thread
     connect(this, &CRadioController::switchToNextChannel,
             this, &CRadioController::nextChannel);
@@ -117,6 +123,7 @@ void CRadioController::closeDevice()
 {
     qDebug() << "RadioController:" << "Close device";
 
+    saveEnsemble();
     radioReceiver.reset();
     device.reset();
     audio.reset();
@@ -334,6 +341,7 @@ void CRadioController::setChannel(QString Channel, bool isScan, bool Force)
             currentFrequency = 0;
         }
         else { // A real device
+            saveEnsemble();
             if(radioReceiver)
                 radioReceiver->stop(); // Stop the demodulator in order to avoid working with old data
             currentChannel = Channel;
@@ -357,6 +365,14 @@ void CRadioController::setChannel(QString Channel, bool isScan, bool Force)
             radioReceiver = std::make_unique<RadioReceiver>(*this, *device, rro, 1);
             radioReceiver->setReceiverOptions(rro);
             radioReceiver->restart(isScan);
+
+            // Show the services found during the last visit of the channel
+            // until the new ones got received. Not while scanning, which
+            // counts only what is on air.
+            EnsembleConfiguration config;
+            if (ensembleDatabase && !isScan && currentFrequency != 0 &&
+                    ensembleDatabase->load(currentChannel.toStdString(), config))
+                radioReceiver->loadEnsemble(config);
         }
 
         emit channelChanged();
@@ -367,6 +383,20 @@ void CRadioController::setChannel(QString Channel, bool isScan, bool Force)
     }
 }
 
+void CRadioController::saveEnsemble()
+{
+    if (!ensembleDatabase || !radioReceiver || currentFrequency == 0)
+        return;
+
+    if (device && device->getID() == CDeviceID::RAWFILE)
+        return;
+
+    const auto config = radioReceiver->getEnsembleConfiguration();
+    if (!config.services.empty() &&
+            !ensembleDatabase->save(currentChannel.toStdString(), config))
+        qDebug() << "RadioController: Could not save the ensemble of channel" << currentChannel;
+}
+
 void CRadioController::setManualChannel(QString Channel)
 {
     // Otherwise tune to channel and play first found station
@@ -920,7 +950,7 @@ void CRadioController::nextChannel(bool isWait)
  *********************/
 void CRadioController::onServiceDetected(uint32_t sId)
 {
-    // you may not call radioReceiver->getService() because it internally holds the FIG mutex.
+    // radioReceiver->getService() would not find the service yet, it gets published once the whole FIB is processed.
     emit serviceDetected(sId);
 }
 
@@ -163,6 +163,7 @@ private:
     void initialise(void);
     void resetTechnicalData(void);
     bool deviceRestart(void);
+    void saveEnsemble(void);
 
     std::shared_ptr<CVirtualInput> device;
     QVariantMap commandLineOptions;
@@ -172,6 +173,7 @@ private:
     RadioReceiverOptions rro;
 
     std::unique_ptr<RadioReceiver> radioReceiver;
+    std::unique_ptr<EnsembleDatabase> ensembleDatabase;
     RingBuffer<int16_t> audioBuffer;
     CAudio audio;
     std::mutex impulseResponseBufferMutex;